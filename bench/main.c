@@ -0,0 +1,518 @@
+#if !defined(_WIN32)
+ #define _POSIX_C_SOURCE 200809L // clock_gettime
+#endif
+
+#include <lext/lext.h> // lxt_compile_length, lxt_compile_generator, lxt_gen_compiled, lxt_measure, lxt_*
+
+#include <stdio.h> // printf, fprintf, vsnprintf
+#include <stdlib.h> // realloc, free, strtod
+#include <stddef.h> // size_t, NULL
+#include <stdbool.h> // bool
+#include <stdint.h> // int32_t, uint32_t, uint64_t
+#include <stdarg.h> // va_list, va_start, va_end
+#include <string.h> // strcmp, strlen
+#include <time.h> // clock_gettime, clock
+
+/**
+ * Represents a growable string used for building synthetic patterns.
+ */
+struct text {
+    char * data;
+    size_t length;
+    size_t capacity;
+};
+
+/**
+ * Represents the measurements of a single benchmark.
+ */
+struct result {
+    char const * axis;
+    uint64_t value;
+    size_t pattern_length;
+    double parse_ns;
+    double parse_bytes_per_second;
+    double generate_ns;
+    double output_bytes_per_second;
+    double allocations_per_compile;
+    double allocations_per_generate;
+};
+
+enum format {
+    FORMAT_JSON,
+    FORMAT_CSV
+};
+
+#if defined(LXT_BENCH_ALLOCATIONS)
+// every allocation made by the library goes through these wrappers, as the
+// benchmark is linked with --wrap for each allocator function
+static size_t allocations = 0;
+
+void * __real_malloc(size_t);
+void * __real_calloc(size_t, size_t);
+void * __real_realloc(void *, size_t);
+
+void *
+__wrap_malloc(size_t const size)
+{
+    allocations += 1;
+    
+    return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t const count, size_t const size)
+{
+    allocations += 1;
+    
+    return __real_calloc(count, size);
+}
+
+void *
+__wrap_realloc(void * const memory, size_t const size)
+{
+    allocations += 1;
+    
+    return __real_realloc(memory, size);
+}
+
+static
+size_t
+count_allocations(void)
+{
+    return allocations;
+}
+#else
+static
+size_t
+count_allocations(void)
+{
+    // not supported on this platform
+    return 0;
+}
+#endif
+
+static
+uint64_t
+now(void)
+{
+#if defined(_WIN32)
+    return (uint64_t)clock() * (1000000000ULL / CLOCKS_PER_SEC);
+#else
+    struct timespec time;
+    
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    
+    return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+#endif
+}
+
+static
+void
+append(struct text * const text, char const * const format, ...)
+{
+    va_list arguments;
+    
+    va_start(arguments, format);
+    
+    int const length = vsnprintf(NULL, 0, format, arguments);
+    
+    va_end(arguments);
+    
+    if (length < 0) {
+        return;
+    }
+    
+    if (text->length + (size_t)length + 1 > text->capacity) {
+        size_t capacity = text->capacity == 0 ? 4096 : text->capacity;
+        
+        while (text->length + (size_t)length + 1 > capacity) {
+            capacity *= 2;
+        }
+        
+        char * const data = realloc(text->data, capacity);
+        
+        if (data == NULL) {
+            fprintf(stderr, "Could not build pattern\n");
+            
+            exit(-1);
+        }
+        
+        text->data = data;
+        text->capacity = capacity;
+    }
+    
+    va_start(arguments, format);
+    
+    vsnprintf(text->data + text->length, (size_t)length + 1, format, arguments);
+    
+    va_end(arguments);
+    
+    text->length += (size_t)length;
+}
+
+/**
+ * Build a pattern of a number of containers, and a generator that refers
+ * to some of them.
+ */
+static
+void
+build_containers(struct text * const text, uint64_t const count)
+{
+    for (uint64_t i = 0; i < count; i++) {
+        append(text, "c%llu (alpha, beta, gamma, delta)\n",
+               (unsigned long long)i);
+    }
+    
+    append(text, "g <");
+    
+    uint64_t const step = count > 16 ? count / 16 : 1;
+    
+    for (uint64_t i = 0; i < count; i += step) {
+        append(text, "@c%llu ", (unsigned long long)i);
+    }
+    
+    append(text, ">\n");
+}
+
+/**
+ * Build a pattern of a single container with a number of entries.
+ */
+static
+void
+build_entries(struct text * const text, uint64_t const count)
+{
+    append(text, "c (");
+    
+    for (uint64_t i = 0; i < count; i++) {
+        append(text, i == 0 ? "e%llu" : ", e%llu", (unsigned long long)i);
+    }
+    
+    append(text, ")\ng <@c @c @c @c>\n");
+}
+
+/**
+ * Build a pattern of a generator with a number of variables.
+ */
+static
+void
+build_sequence(struct text * const text, uint64_t const count)
+{
+    append(text, "c (alpha, beta, gamma, delta)\ng <");
+    
+    for (uint64_t i = 0; i < count; i++) {
+        append(text, "@c-");
+    }
+    
+    append(text, ">\n");
+}
+
+/**
+ * Build a pattern of a chain of generators, each resolving the next.
+ */
+static
+void
+build_depth(struct text * const text, uint64_t const depth)
+{
+    append(text, "c (alpha, beta, gamma, delta)\n");
+    
+    for (uint64_t i = 0; i < depth; i++) {
+        append(text, "g%llu <x@g%llu>\n",
+               (unsigned long long)i,
+               (unsigned long long)(i + 1));
+    }
+    
+    append(text, "g%llu <@c>\n", (unsigned long long)depth);
+}
+
+/**
+ * Build a pattern of roughly a given size, in bytes.
+ */
+static
+void
+build_size(struct text * const text, uint64_t const size)
+{
+    for (uint64_t i = 0; text->length < size; i++) {
+        append(text,
+               "# block %llu\n"
+               "c%llu (alpha, beta, gamma, delta, epsilon, zeta)\n"
+               "g%llu <the @c%llu and the @c%llu>\n",
+               (unsigned long long)i,
+               (unsigned long long)i,
+               (unsigned long long)i,
+               (unsigned long long)i,
+               (unsigned long long)i);
+    }
+}
+
+/**
+ * Compile a pattern, or only the parts of it that a generator uses.
+ */
+static
+enum lxt_error
+compile(struct lxt_template ** const template,
+        char const * const pattern,
+        size_t const length,
+        char const * const generator,
+        bool const pruned)
+{
+    if (pruned) {
+        return lxt_compile_generator(template, pattern, length, NULL,
+                                     generator);
+    }
+    
+    return lxt_compile_length(template, pattern, length);
+}
+
+static
+int32_t
+run(struct result * const result,
+    char const * const pattern,
+    size_t const length,
+    char const * const generator,
+    bool const pruned,
+    double const seconds)
+{
+    uint64_t const budget = (uint64_t)(seconds * 1e9);
+    
+    struct lxt_template * template = NULL;
+    
+    result->pattern_length = length;
+    
+    // compile
+    size_t const allocations_before_compile = count_allocations();
+    
+    if (compile(&template, pattern, length,
+                generator, pruned) != LXT_ERROR_NONE) {
+        return -1;
+    }
+    
+    result->allocations_per_compile =
+        (double)(count_allocations() - allocations_before_compile);
+    
+    lxt_free(template);
+    
+    uint64_t compiles = 0;
+    uint64_t start = now();
+    uint64_t elapsed = 0;
+    
+    while (elapsed < budget || compiles == 0) {
+        compile(&template, pattern, length, generator, pruned);
+        lxt_free(template);
+        
+        compiles += 1;
+        
+        elapsed = now() - start;
+    }
+    
+    result->parse_ns = (double)elapsed / (double)compiles;
+    result->parse_bytes_per_second =
+        (double)length * (double)compiles / ((double)elapsed / 1e9);
+    
+    // generate
+    if (compile(&template, pattern, length,
+                generator, pruned) != LXT_ERROR_NONE) {
+        return -1;
+    }
+    
+    struct lxt_bounds bounds;
+    
+    lxt_measure(&bounds, template, generator);
+    
+    size_t buffer_length = 1024 * 1024;
+    
+    if (bounds.max < buffer_length) {
+        buffer_length = (size_t)bounds.max + 1;
+    }
+    
+    char * const buffer = malloc(buffer_length);
+    
+    if (buffer == NULL) {
+        lxt_free(template);
+        
+        return -1;
+    }
+    
+    struct lxt_rng rng;
+    
+    lxt_rng_init(&rng, 42, 0);
+    
+    struct lxt_opts const options = {
+        .generator = generator,
+        .seed = NULL,
+        .rng = &rng
+    };
+    
+    size_t const allocations_before_generate = count_allocations();
+    
+    lxt_gen_compiled(buffer, buffer_length, template, options);
+    
+    result->allocations_per_generate =
+        (double)(count_allocations() - allocations_before_generate);
+    
+    uint64_t generations = 0;
+    uint64_t output_length = 0;
+    
+    start = now();
+    elapsed = 0;
+    
+    while (elapsed < budget || generations == 0) {
+        // check the time only every so often, as generating is quick
+        for (uint32_t i = 0; i < 64; i++) {
+            lxt_gen_compiled(buffer, buffer_length, template, options);
+            
+            output_length += strlen(buffer);
+        }
+        
+        generations += 64;
+        
+        elapsed = now() - start;
+    }
+    
+    result->generate_ns = (double)elapsed / (double)generations;
+    result->output_bytes_per_second =
+        (double)output_length / ((double)elapsed / 1e9);
+    
+    free(buffer);
+    
+    lxt_free(template);
+    
+    return 0;
+}
+
+static
+void
+print_result(struct result const * const result,
+             enum format const format,
+             bool const first)
+{
+    if (format == FORMAT_CSV) {
+        printf("%s,%llu,%zu,%.1f,%.0f,%.1f,%.0f,%.1f,%.1f\n",
+               result->axis,
+               (unsigned long long)result->value,
+               result->pattern_length,
+               result->parse_ns,
+               result->parse_bytes_per_second,
+               result->generate_ns,
+               result->output_bytes_per_second,
+               result->allocations_per_compile,
+               result->allocations_per_generate);
+        
+        return;
+    }
+    
+    printf("%s    {\"axis\": \"%s\", \"value\": %llu, "
+           "\"pattern_bytes\": %zu, "
+           "\"parse_ns\": %.1f, \"parse_bytes_per_second\": %.0f, "
+           "\"generate_ns\": %.1f, \"output_bytes_per_second\": %.0f, "
+           "\"allocations_per_compile\": %.1f, "
+           "\"allocations_per_generate\": %.1f}",
+           first ? "" : ",\n",
+           result->axis,
+           (unsigned long long)result->value,
+           result->pattern_length,
+           result->parse_ns,
+           result->parse_bytes_per_second,
+           result->generate_ns,
+           result->output_bytes_per_second,
+           result->allocations_per_compile,
+           result->allocations_per_generate);
+}
+
+int32_t
+main(int32_t const argc, char ** const argv)
+{
+    enum format format = FORMAT_JSON;
+    
+    double seconds = 0.25;
+    
+    for (int32_t i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            format = FORMAT_CSV;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            format = FORMAT_JSON;
+        } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            seconds = strtod(argv[++i], NULL);
+        } else {
+            printf("Usage:\n"
+                   "  lext_bench [--json | --csv] [--time <seconds>]\n");
+            
+            return -1;
+        }
+    }
+    
+    struct axis {
+        char const * name;
+        void (* build)(struct text *, uint64_t);
+        /**
+         * The generator to generate from, or NULL for any generator.
+         */
+        char const * generator;
+        /**
+         * Whether only the parts of the pattern that the generator uses
+         * are compiled.
+         */
+        bool pruned;
+        uint64_t values[4];
+    };
+    
+    struct axis const axes[] = {
+        { "containers", build_containers, "g", false, { 1, 16, 256, 4096 } },
+        { "entries", build_entries, "g", false, { 2, 16, 256, 4096 } },
+        { "sequence", build_sequence, "g", false, { 1, 16, 256, 4096 } },
+        { "depth", build_depth, "g0", false, { 1, 16, 256, 1024 } },
+        { "size", build_size, NULL, false,
+            { 1024, 65536, 1048576, 16777216 } },
+        { "reached", build_size, "g0", true,
+            { 1024, 65536, 1048576, 16777216 } }
+    };
+    
+    if (format == FORMAT_CSV) {
+        printf("axis,value,pattern_bytes,parse_ns,parse_bytes_per_second,"
+               "generate_ns,output_bytes_per_second,"
+               "allocations_per_compile,allocations_per_generate\n");
+    } else {
+        printf("{\n  \"version\": \"%d.%d.%d\",\n  \"results\": [\n",
+               LXT_VERSION_MAJOR,
+               LXT_VERSION_MINOR,
+               LXT_VERSION_PATCH);
+    }
+    
+    bool first = true;
+    
+    for (size_t i = 0; i < sizeof(axes) / sizeof(axes[0]); i++) {
+        struct axis const * const axis = &axes[i];
+        
+        for (size_t k = 0; k < sizeof(axis->values) / sizeof(uint64_t); k++) {
+            struct text text = { NULL, 0, 0 };
+            
+            axis->build(&text, axis->values[k]);
+            
+            struct result result;
+            
+            result.axis = axis->name;
+            result.value = axis->values[k];
+            
+            if (run(&result, text.data, text.length,
+                    axis->generator, axis->pruned, seconds) != 0) {
+                fprintf(stderr, "Could not run benchmark '%s' (%llu)\n",
+                        axis->name, (unsigned long long)axis->values[k]);
+                
+                free(text.data);
+                
+                return -1;
+            }
+            
+            print_result(&result, format, first);
+            
+            first = false;
+            
+            free(text.data);
+        }
+    }
+    
+    if (format == FORMAT_JSON) {
+        printf("\n  ]\n}\n");
+    }
+    
+    return 0;
+}
@@ -1,34 +1,325 @@
-#include <lext/lext.h> // lxt_gen, lxt_opts, LXT_VERSION_*
+#if !defined(_WIN32)
+ #define _POSIX_C_SOURCE 200809L // mmap, fstat
+#endif
 
-#include <stdio.h> // printf, fprintf, fopen, fclose, fread, FILE, SEEK_*
-#include <stdlib.h> // malloc, free
+#include <lext/lext.h> // lxt_gen_batch_parallel, lxt_gen_unique, lxt_compile_length, lxt_compile_library, lxt_load_file, lxt_save, lxt_measure, lxt_count_exact, lxt_library_*, LXT_VERSION_*
+
+#include <stdio.h> // printf, fprintf, fwrite, fflush, fopen, fclose, fread, feof, ferror, FILE
+#include <stdlib.h> // malloc, realloc, free, strtoull
 #include <stddef.h> // size_t, NULL
 #include <stdbool.h> // bool
-#include <stdint.h> // int32_t
-#include <string.h> // strcmp
+#include <stdint.h> // int32_t, uint32_t, uint64_t, UINT32_MAX, UINT64_MAX
+#include <string.h> // strcmp, strncmp, strlen, strrchr, memcpy
+#include <errno.h> // errno
 #include <time.h> // time
 
+#if !defined(_WIN32)
+ #include <sys/mman.h> // mmap, munmap
+ #include <sys/stat.h> // fstat, stat, S_ISREG
+ #include <fcntl.h> // open, O_RDONLY
+ #include <unistd.h> // close
+#endif
+
+// the number of results to generate at a time
+#define BATCH_SIZE (65536)
+
+/**
+ * Represents the options for generating results.
+ */
+struct options {
+    char const * generator;
+    uint32_t seed;
+    /**
+     * The number of threads to generate results with; 0 for one thread
+     * per available processor.
+     */
+    uint32_t jobs;
+    /**
+     * Whether to generate distinct results only.
+     */
+    bool unique;
+};
+
+/**
+ * Write each result of a batch, separated by newlines, in one chunk.
+ */
 static
-void
-generate(char const * const pattern, uint32_t amount)
+int32_t
+write_batch(struct lxt_batch const * const batch,
+            struct lxt_buffer * const output)
+{
+    size_t const length = (size_t)batch->offsets[batch->count] + batch->count;
+    
+    if (length > output->capacity) {
+        char * const data = realloc(output->data, length);
+        
+        if (data == NULL) {
+            return -1;
+        }
+        
+        output->data = data;
+        output->capacity = length;
+    }
+    
+    output->length = 0;
+    
+    for (size_t i = 0; i < batch->count; i++) {
+        size_t const result_length = (size_t)(batch->offsets[i + 1] -
+                                              batch->offsets[i]);
+        
+        memcpy(output->data + output->length,
+               batch->data + batch->offsets[i],
+               result_length);
+        
+        output->length += result_length;
+        output->data[output->length++] = '\n';
+    }
+    
+    if (fwrite(output->data, 1, output->length, stdout) != output->length) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+static
+int32_t
+generate(struct lxt_template const * const template,
+         uint64_t const amount,
+         struct options const * const options)
+{
+    uint32_t seed = options->seed;
+    
+    struct lxt_batch batch = LXT_BATCH_EMPTY;
+    struct lxt_buffer output = LXT_BUFFER_EMPTY;
+    
+    int32_t result = 0;
+    
+    for (uint64_t first = 0; first < amount; first += BATCH_SIZE) {
+        size_t const count = amount - first < BATCH_SIZE ?
+            (size_t)(amount - first) : BATCH_SIZE;
+        
+        lxt_batch_clear(&batch);
+        
+        struct lxt_opts const opts = {
+            .generator = options->generator,
+            .seed = &seed,
+            .rng = NULL
+        };
+        
+        // every result is generated from its index, such that results are
+        // the same no matter the number of jobs
+        enum lxt_error const error = options->unique ?
+            lxt_gen_unique(&batch, first, count, template, opts) :
+            lxt_gen_batch_parallel(&batch, first, count, template, opts,
+                                   options->jobs);
+        
+        if (error != LXT_ERROR_NONE) {
+            fprintf(stderr, error == LXT_ERROR_UNSUPPORTED ?
+                    "Could not generate distinct results from a recursive "
+                    "generator\n" :
+                    "Could not generate results\n");
+            
+            result = -1;
+            
+            break;
+        }
+        
+        if (write_batch(&batch, &output) != 0) {
+            fprintf(stderr, "Could not write results\n");
+            
+            result = -1;
+            
+            break;
+        }
+        
+        if (batch.count < count) {
+            // ran out of distinct results
+            break;
+        }
+    }
+    
+    if (fflush(stdout) != 0) {
+        result = -1;
+    }
+    
+    lxt_buffer_free(&output);
+    lxt_batch_free(&batch);
+    
+    return result;
+}
+
+/**
+ * Determine whether a template has a generator of a given name.
+ */
+static
+bool
+has_generator(struct lxt_template const * const template,
+              char const * const name)
 {
-    uint32_t seed = (uint32_t)time(NULL);
+    uint32_t const count = lxt_generator_count(template);
     
-    for (uint32_t i = 0; i < amount; i++) {
-        char buffer[256];
+    for (uint32_t i = 0; i < count; i++) {
+        struct lxt_generator_info info;
+        
+        lxt_generator_at(&info, template, i);
         
-        lxt_gen(buffer, sizeof(buffer), pattern, (struct lxt_opts) {
-            .generator = NULL,
-            .seed = &seed
-        });
+        if (info.name_length == strlen(name) &&
+            strncmp(info.name, name, info.name_length) == 0) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/**
+ * Add a pattern file, or a file of lines, to a library of imports, creating
+ * the library first.
+ *
+ * The module, or container, is named after the file, without any directory
+ * or extension; for example, "names" for "data/names.lxt".
+ */
+static
+int32_t
+add_import(struct lxt_library ** const library,
+           char const * const filename,
+           bool const lines)
+{
+    if (*library == NULL &&
+        lxt_library_create(library) != LXT_ERROR_NONE) {
+        return -1;
+    }
+    
+    char const * const slash = strrchr(filename, '/');
+    char const * const start = slash != NULL ? slash + 1 : filename;
+    char const * const dot = strrchr(start, '.');
+    
+    size_t const length = dot != NULL && dot != start ?
+        (size_t)(dot - start) : strlen(start);
+    
+    char * const name = malloc(length + 1);
+    
+    if (name == NULL) {
+        return -1;
+    }
+    
+    memcpy(name, start, length);
+    
+    name[length] = '\0';
+    
+    // the file is not read until the module, or container, is used
+    enum lxt_error const error = lines ?
+        lxt_library_add_lines(*library, name, filename) :
+        lxt_library_add_file(*library, name, filename);
+    
+    free(name);
+    
+    return error == LXT_ERROR_NONE ? 0 : -1;
+}
+
+/**
+ * Parse a non-negative number from a parameter.
+ */
+static
+int32_t
+parse_number(uint64_t * const number,
+             char const * const param,
+             uint64_t const max)
+{
+    char * end = NULL;
+    
+    errno = 0;
+    
+    unsigned long long const value = strtoull(param, &end, 10);
+    
+    if (errno != 0 || end == param || *end != '\0' ||
+        param[0] == '-' || value > max) {
+        fprintf(stderr, "Invalid number '%s'\n", param);
         
-        printf("%s\n", buffer);
+        return -1;
     }
+    
+    *number = (uint64_t)value;
+    
+    return 0;
 }
 
 static
 int32_t
-read_file(char ** const buffer, char const * const filename)
+measure(struct lxt_template const * const template)
+{
+    uint32_t const count = lxt_generator_count(template);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        struct lxt_generator_info info;
+        
+        lxt_generator_at(&info, template, i);
+        
+        printf("%.*s\t%llu\t", (int)info.name_length, info.name,
+               (unsigned long long)info.bounds.min);
+        
+        if (info.bounds.max == LXT_LENGTH_UNBOUNDED) {
+            printf("unbounded\t");
+        } else {
+            printf("%llu\t", (unsigned long long)info.bounds.max);
+        }
+        
+        if (info.combinations == 0) {
+            // recursive; combinations can not be counted
+            printf("unbounded\n");
+            
+            continue;
+        }
+        
+        if (info.combinations < UINT64_MAX) {
+            printf("%llu\n", (unsigned long long)info.combinations);
+            
+            continue;
+        }
+        
+        // too many to count in 64 bits; count exactly instead
+        char * const name = malloc(info.name_length + 1);
+        
+        if (name == NULL) {
+            return -1;
+        }
+        
+        memcpy(name, info.name, info.name_length);
+        
+        name[info.name_length] = '\0';
+        
+        struct lxt_buffer exact = LXT_BUFFER_EMPTY;
+        
+        if (lxt_count_exact(&exact, template, name) == LXT_ERROR_NONE) {
+            printf("%.*s\n", (int)exact.length, exact.data);
+        } else {
+            printf("unbounded\n");
+        }
+        
+        lxt_buffer_free(&exact);
+        
+        free(name);
+    }
+    
+    return 0;
+}
+
+/**
+ * Represents the contents of a file in memory.
+ *
+ * The contents are mapped directly from the file where possible, and are
+ * not null-terminated.
+ */
+struct file {
+    char * data;
+    size_t length;
+    bool mapped;
+};
+
+static
+int32_t
+read_file(struct file * const contents, char const * const filename)
 {
     FILE * const file = fopen(filename, "rb");
     
@@ -38,23 +329,45 @@ read_file(char ** const buffer, char const * const filename)
         return -1;
     }
     
-    // move to end of file
-    fseek(file, 0, SEEK_END);
-    // determine total length
-    size_t const length = ftell(file);
-    // move to beginning of file
-    fseek(file, 0, SEEK_SET);
-    // allocate enough memory to buffer entire file
-    *buffer = malloc(length + 1);
-    // read entire file as one chunk
-    fread(*buffer, length, 1, file);
-    // null-terminate the buffer for good measure
-    buffer[length] = 0;
+    contents->data = NULL;
+    contents->length = 0;
+    contents->mapped = false;
+    
+    int32_t result = 0;
     
-    if (fclose(file) != 0) {
-        free(*buffer);
+    size_t capacity = 0;
+    
+    // read in growing chunks until the end, as the size of a stream (like
+    // a pipe) can not be determined up front
+    while (!feof(file) && !ferror(file)) {
+        if (contents->length == capacity) {
+            capacity = capacity == 0 ? 4096 : capacity * 2;
+            
+            char * const data = realloc(contents->data, capacity);
+            
+            if (data == NULL) {
+                result = -1;
+                
+                break;
+            }
+            
+            contents->data = data;
+        }
         
-        fprintf(stderr, "Could not close file '%s'\n", filename);
+        contents->length += fread(contents->data + contents->length, 1,
+                                  capacity - contents->length, file);
+    }
+    
+    if (ferror(file)) {
+        result = -1;
+    }
+    
+    if (result != 0) {
+        free(contents->data);
+    }
+    
+    if (fclose(file) != 0 || result != 0) {
+        fprintf(stderr, "Could not read file '%s'\n", filename);
         
         return -1;
     }
@@ -62,6 +375,118 @@ read_file(char ** const buffer, char const * const filename)
     return 0;
 }
 
+static
+int32_t
+map_file(struct file * const contents, char const * const filename)
+{
+#if defined(_WIN32)
+    return read_file(contents, filename);
+#else
+    int const fd = open(filename, O_RDONLY);
+    
+    if (fd < 0) {
+        fprintf(stderr, "Could not open file '%s'\n", filename);
+        
+        return -1;
+    }
+    
+    struct stat status;
+    
+    if (fstat(fd, &status) != 0 || status.st_size <= 0 ||
+        !S_ISREG(status.st_mode)) {
+        // nothing to map; read as a stream instead
+        close(fd);
+        
+        return read_file(contents, filename);
+    }
+    
+    void * const data = mmap(NULL, (size_t)status.st_size,
+                             PROT_READ, MAP_PRIVATE, fd, 0);
+    
+    // the mapping stays valid after closing the file
+    close(fd);
+    
+    if (data == MAP_FAILED) {
+        return read_file(contents, filename);
+    }
+    
+    contents->data = data;
+    contents->length = (size_t)status.st_size;
+    contents->mapped = true;
+    
+    return 0;
+#endif
+}
+
+static
+void
+unmap_file(struct file * const contents)
+{
+#if !defined(_WIN32)
+    if (contents->mapped) {
+        munmap(contents->data, contents->length);
+        
+        return;
+    }
+#endif
+    
+    free(contents->data);
+}
+
+static
+int32_t
+compile(char const * const filename, char const * const output)
+{
+    struct file input;
+    
+    if (map_file(&input, filename) != 0) {
+        return -1;
+    }
+    
+    struct lxt_template * template = NULL;
+    
+    if (lxt_compile_length(&template, input.data,
+                           input.length) != LXT_ERROR_NONE) {
+        fprintf(stderr, "Could not compile template\n");
+        
+        unmap_file(&input);
+        
+        return -1;
+    }
+    
+    int32_t result = 0;
+    
+    FILE * const file = fopen(output, "wb");
+    
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file '%s'\n", output);
+        
+        result = -1;
+    } else {
+        struct lxt_sink sink;
+        
+        lxt_sink_file(&sink, file);
+        
+        if (lxt_save(template, &sink) != LXT_ERROR_NONE) {
+            result = -1;
+        }
+        
+        if (fclose(file) != 0) {
+            result = -1;
+        }
+        
+        if (result != 0) {
+            fprintf(stderr, "Could not write file '%s'\n", output);
+        }
+    }
+    
+    lxt_free(template);
+    
+    unmap_file(&input);
+    
+    return result;
+}
+
 int32_t
 main(int32_t const argc, char ** const argv)
 {
@@ -81,12 +506,30 @@ main(int32_t const argc, char ** const argv)
         }
     }
     
-    if (argc != 4) {
+    if (argc == 5 &&
+        strcmp(argv[1], "compile") == 0 &&
+        strcmp(argv[3], "-o") == 0) {
+        return compile(argv[2], argv[4]);
+    }
+    
+    if (argc < 4) {
         printf("Usage:\n"
-               "  lext <amount> -f <file>\n"
-               "  lext <amount> -p <pattern>\n"
+               "  lext <amount> -f <file> [options]\n"
+               "  lext <amount> -p <pattern> [options]\n"
+               "  lext <amount> -c <image> [options]\n"
+               "  lext -m -f <file>\n"
+               "  lext -m -p <pattern>\n"
+               "  lext compile <file> -o <output>\n"
                "  lext -v | --version\n"
-               "  lext -h | --help\n");
+               "  lext -h | --help\n"
+               "\n"
+               "Options:\n"
+               "  -j, --jobs <amount>     Number of threads (default: all)\n"
+               "  -s, --seed <seed>       Seed (default: current time)\n"
+               "  -g, --generator <name>  Generator (default: any)\n"
+               "  -u, --unique            Generate distinct results only\n"
+               "  -i, --import <file>     Pattern file to import from\n"
+               "  -l, --lines <file>      File of lines to import\n");
         
         return -1;
     }
@@ -95,35 +538,149 @@ main(int32_t const argc, char ** const argv)
     char * const param_input_type = argv[2];
     char * const param_input = argv[3];
     
-    int32_t amount = atoi(param_amount);
+    // measure the length of results instead of generating any
+    bool const measuring = strcmp(param_amount, "-m") == 0 ||
+                           strcmp(param_amount, "--measure") == 0;
+    
+    uint64_t amount = 0;
     
-    if (amount < 0) {
-        amount = 0;
+    if (!measuring && parse_number(&amount, param_amount, UINT64_MAX) != 0) {
+        return -1;
     }
     
-    char * pattern = NULL;
+    struct options options;
+    
+    options.generator = NULL;
+    options.seed = (uint32_t)time(NULL);
+    options.jobs = 0;
+    options.unique = false;
     
-    bool buffer_allocated = false;
+    struct lxt_library * library = NULL;
     
-    if (strcmp(param_input_type, "-p") == 0) {
+    for (int32_t i = 4; i < argc; i += 2) {
+        char const * const option = argv[i];
+        
+        if (strcmp(option, "-u") == 0 || strcmp(option, "--unique") == 0) {
+            options.unique = true;
+            
+            // flag takes no value
+            i -= 1;
+            
+            continue;
+        }
+        
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for option '%s'\n", option);
+            
+            return -1;
+        }
+        
+        char const * const value = argv[i + 1];
+        
+        uint64_t number = 0;
+        
+        if (strcmp(option, "-j") == 0 || strcmp(option, "--jobs") == 0) {
+            if (parse_number(&number, value, UINT32_MAX) != 0) {
+                return -1;
+            }
+            
+            options.jobs = (uint32_t)number;
+        } else if (strcmp(option, "-s") == 0 ||
+                   strcmp(option, "--seed") == 0) {
+            if (parse_number(&number, value, UINT32_MAX) != 0) {
+                return -1;
+            }
+            
+            options.seed = (uint32_t)number;
+        } else if (strcmp(option, "-g") == 0 ||
+                   strcmp(option, "--generator") == 0) {
+            options.generator = value;
+        } else if (strcmp(option, "-i") == 0 ||
+                   strcmp(option, "--import") == 0) {
+            if (add_import(&library, value, false) != 0) {
+                fprintf(stderr, "Could not import '%s'\n", value);
+                
+                return -1;
+            }
+        } else if (strcmp(option, "-l") == 0 ||
+                   strcmp(option, "--lines") == 0) {
+            if (add_import(&library, value, true) != 0) {
+                fprintf(stderr, "Could not import '%s'\n", value);
+                
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "Unknown option '%s'\n", option);
+            
+            return -1;
+        }
+    }
+    
+    struct lxt_template * template = NULL;
+    
+    struct file input;
+    
+    bool file_mapped = false;
+    
+    if (strcmp(param_input_type, "-c") == 0) {
+        // input is a precompiled template
+        if (lxt_load_file(&template, param_input) != LXT_ERROR_NONE) {
+            fprintf(stderr, "Could not load template '%s'\n", param_input);
+            
+            return -1;
+        }
+    } else if (strcmp(param_input_type, "-p") == 0) {
         // input is a pattern
-        pattern = param_input;
+        input.data = param_input;
+        input.length = strlen(param_input);
     } else if (strcmp(param_input_type, "-f") == 0) {
         // input is a file
         char const * const filename = param_input;
         
-        if (read_file(&pattern, filename) != 0) {
+        if (map_file(&input, filename) != 0) {
             return -1;
         }
         
-        buffer_allocated = true;
+        file_mapped = true;
+    } else {
+        fprintf(stderr, "Unknown input '%s'\n", param_input_type);
+        
+        return -1;
+    }
+    
+    if (template == NULL &&
+        lxt_compile_library(&template, input.data, input.length,
+                            library) != LXT_ERROR_NONE) {
+        fprintf(stderr, "Could not compile template\n");
+        
+        lxt_library_free(library);
+        
+        if (file_mapped) {
+            unmap_file(&input);
+        }
+        
+        return -1;
     }
     
-    generate(pattern, (uint32_t)amount);
+    int32_t result = 0;
     
-    if (buffer_allocated) {
-        free(pattern);
+    if (options.generator != NULL &&
+        !has_generator(template, options.generator)) {
+        fprintf(stderr, "Generator '%s' not found\n", options.generator);
+        
+        result = -1;
+    } else {
+        result = measuring ?
+            measure(template) : generate(template, amount, &options);
     }
     
-    return 0;
+    // the template refers to the pattern and its imports; release it first
+    lxt_free(template);
+    lxt_library_free(library);
+    
+    if (file_mapped) {
+        unmap_file(&input);
+    }
+    
+    return result;
 }
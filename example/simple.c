@@ -24,6 +24,16 @@ main(void)
     // null-terminate the string
     string[length] = '\0';
     
+    // compile the template once to generate many results from it
+    struct lxt_template * template = NULL;
+    
+    if (lxt_compile(&template, string) != LXT_ERROR_NONE) {
+        fclose(file);
+        free(string);
+        
+        return -1;
+    }
+    
     uint32_t seed = 2147483647;
     
     for (int32_t i = 0; i < 5; i++) {
@@ -32,7 +42,8 @@ main(void)
         
         enum lxt_error error;
         
-        error = lxt_gen(result, sizeof(result), string, (struct lxt_opts) {
+        error = lxt_gen_compiled(result, sizeof(result), template,
+                                 (struct lxt_opts) {
             .generator = NULL,
             .seed = &seed
         });
@@ -43,6 +54,7 @@ main(void)
     }
     
     // clean up
+    lxt_free(template);
     fclose(file);
     free(string);
     
@@ -1,12 +1,122 @@
 #pragma once
 
 #include <stddef.h> // size_t
-#include <stdint.h> // uint32_t
+#include <stdint.h> // uint32_t, int32_t, int64_t, uint64_t
+#include <stdio.h> // FILE
 
 #define LXT_VERSION_MAJOR (0)
 #define LXT_VERSION_MINOR (2)
 #define LXT_VERSION_PATCH (0)
 
+/**
+ * Represents a result code, indicating success or not.
+ */
+enum lxt_error {
+    LXT_ERROR_NONE,
+    LXT_ERROR_INVALID_TEMPLATE,
+    LXT_ERROR_GENERATOR_NOT_FOUND,
+    LXT_ERROR_OUT_OF_MEMORY,
+    LXT_ERROR_UNSUPPORTED,
+    LXT_ERROR_WRITE_FAILED,
+    LXT_ERROR_READ_FAILED,
+    LXT_ERROR_INVALID_IMAGE,
+    LXT_ERROR_OUT_OF_RANGE
+};
+
+/**
+ * Represents the kind of a random number generator.
+ */
+enum lxt_rng_kind {
+    /**
+     * PCG32 (XSH-RR); a small, fast generator with 64 bits of state and
+     * 2^63 selectable streams. This is the default generator.
+     */
+    LXT_RNG_PCG32,
+    /**
+     * The 32-bit xorshift generator of LEXT 0.2 and earlier.
+     *
+     * Use this generator to reproduce results of seeds from earlier versions.
+     */
+    LXT_RNG_XORSHIFT32,
+    /**
+     * A generator provided by a function.
+     */
+    LXT_RNG_CUSTOM
+};
+
+/**
+ * Represents a random number generator and its state.
+ *
+ * Initialize a generator using any of the `lxt_rng_init*` functions.
+ */
+struct lxt_rng {
+    enum lxt_rng_kind kind;
+    uint64_t state;
+    uint64_t increment;
+    /**
+     * Get the next random number of a custom generator.
+     */
+    uint32_t (* next)(void * context);
+    void * context;
+};
+
+/**
+ * Initialize a PCG32 generator from a seed and a stream.
+ *
+ * Generators initialized with the same seed, but different streams,
+ * produce different sequences of numbers.
+ */
+void lxt_rng_init(struct lxt_rng *,
+                  uint64_t seed,
+                  uint64_t stream);
+/**
+ * Initialize a xorshift32 generator from a seed.
+ *
+ * Using this generator, results are identical to those generated by
+ * LEXT 0.2 and earlier for the same seed.
+ */
+void lxt_rng_init_xorshift32(struct lxt_rng *,
+                             uint32_t seed);
+/**
+ * Initialize a custom generator from a function.
+ *
+ * A custom generator can not be split, and is advanced one number at a time.
+ */
+void lxt_rng_init_custom(struct lxt_rng *,
+                         uint32_t (* next)(void * context),
+                         void * context);
+/**
+ * Initialize a generator as an independent stream of another generator.
+ *
+ * The resulting generator only depends on the state of the other generator
+ * and the stream, which is left unchanged. This allows, for example,
+ * giving each of a number of tasks its own generator.
+ *
+ * Returns LXT_ERROR_UNSUPPORTED for custom generators.
+ */
+enum lxt_error lxt_rng_split(struct lxt_rng *,
+                             struct lxt_rng const * other,
+                             uint64_t stream);
+/**
+ * Advance a generator as if a number of random numbers were drawn from it.
+ *
+ * This takes O(log n) steps for PCG32 generators and O(n) steps for others.
+ */
+void lxt_rng_advance(struct lxt_rng *,
+                     uint64_t count);
+/**
+ * Get the next random number of a generator.
+ */
+uint32_t lxt_rng_next(struct lxt_rng *);
+/**
+ * Get a random number in the range [0, bound) from a generator.
+ *
+ * Numbers are drawn without bias, and usually without any division, for all
+ * but xorshift32 generators; these reduce by modulo, as in earlier versions.
+ */
+uint32_t lxt_rng_bounded(struct lxt_rng *,
+                         uint32_t bound);
+
 /**
  * Represents optional settings that affect a generated result.
  */
@@ -17,24 +127,648 @@ struct lxt_opts {
     char const * generator;
     /**
      * Specifies the randomization seed.
+     *
+     * The seed is used with a xorshift32 generator, such that seeds
+     * reproduce results of earlier versions, and is advanced by every
+     * generated result.
      */
     uint32_t * seed;
+    /**
+     * Specifies the random number generator to use instead of a seed.
+     *
+     * The generator is advanced by every generated result. If neither a seed
+     * nor a generator is specified, a PCG32 generator with a fixed seed
+     * is used.
+     */
+    struct lxt_rng * rng;
+    /**
+     * Specifies how deeply generators may resolve other generators.
+     *
+     * Resolving stops short of generators beyond this depth. If zero,
+     * LXT_DEPTH_DEFAULT is used.
+     */
+    uint32_t max_depth;
 };
 
+#define LXT_DEPTH_DEFAULT (4096)
+
 extern struct lxt_opts const LXT_OPTS_NONE;
 
 /**
- * Represents a result code, indicating success or not.
+ * Represents a compiled template pattern.
+ *
+ * A compiled template is immutable and can be shared freely between threads.
  */
-enum lxt_error {
-    LXT_ERROR_NONE,
-    LXT_ERROR_INVALID_TEMPLATE,
-    LXT_ERROR_GENERATOR_NOT_FOUND
+struct lxt_template;
+
+/**
+ * Compile a template pattern for repeated generation.
+ *
+ * The compiled template refers to the pattern and is only valid for as long
+ * as the pattern is. Release the template using `lxt_free`.
+ *
+ * A pattern can never read files by itself; LXT_ERROR_UNSUPPORTED is
+ * returned if it uses a container declared by a `#lines` directive. See
+ * `lxt_library_add_lines`.
+ */
+enum lxt_error lxt_compile(struct lxt_template **,
+                           char const * pattern);
+/**
+ * Compile a template pattern of a given length for repeated generation.
+ *
+ * Unlike `lxt_compile`, the pattern does not have to be null-terminated;
+ * it can be any slice of memory, like a read-only mapping of a file.
+ */
+enum lxt_error lxt_compile_length(struct lxt_template **,
+                                  char const * pattern,
+                                  size_t length);
+/**
+ * Release a compiled template.
+ */
+void lxt_free(struct lxt_template *);
+
+/**
+ * Represents a library of named patterns (modules) that templates can
+ * import containers from.
+ *
+ * A pattern imports a module using an `#import` directive, followed by the
+ * name of the module; every container of the module can then be used as if
+ * defined in the pattern itself, unless the pattern defines a container or
+ * generator of the same name. Modules only provide containers; generators of
+ * a module are never imported.
+ *
+ * A module is compiled once, the first time a template uses any of its
+ * containers, and is then shared by every template that imports it; imported
+ * containers are never copied. Templates compiled against a library are
+ * only valid for as long as the library is.
+ *
+ * A library can also hold files of lines, each read as a container whose
+ * entries are the lines of the file. A pattern declares such a container
+ * using a `#lines` directive, followed by the name of the file in the
+ * library; only files added to the library can ever be read this way.
+ *
+ * Compiling templates against the same library is not thread-safe, but
+ * generating from them is.
+ */
+struct lxt_library;
+
+enum lxt_error lxt_library_create(struct lxt_library **);
+/**
+ * Add a module to a library.
+ *
+ * The pattern is not compiled until first imported, and must be valid for
+ * as long as the library is. If more than one module has the same name,
+ * the first one is imported.
+ */
+enum lxt_error lxt_library_add(struct lxt_library *,
+                               char const * name,
+                               char const * pattern,
+                               size_t length);
+/**
+ * Add a module to a library, reading its pattern from a file.
+ *
+ * The file is not read until the module is first imported.
+ */
+enum lxt_error lxt_library_add_file(struct lxt_library *,
+                                    char const * name,
+                                    char const * filename);
+/**
+ * Add a file of lines to a library.
+ *
+ * The file is not read until a template first uses it. It is then mapped
+ * where possible, and shared by every template using it; the file must not
+ * change for as long as the library exists. Relative filenames are relative
+ * to the working directory, as with `lxt_library_add_file`.
+ *
+ * Using a container of lines that is not in the library returns
+ * LXT_ERROR_UNSUPPORTED; LXT_ERROR_READ_FAILED is returned if the file can
+ * not be read.
+ */
+enum lxt_error lxt_library_add_lines(struct lxt_library *,
+                                     char const * name,
+                                     char const * filename);
+/**
+ * Release a library and every module compiled from it.
+ */
+void lxt_library_free(struct lxt_library *);
+
+/**
+ * Compile a template pattern of a given length, importing from a library.
+ *
+ * Unlike `lxt_compile_length`, containers can be imported from modules of
+ * the library. The template is invalid if it uses a container that is
+ * neither defined nor imported, or if it uses a module that is not in the
+ * library; a module that fails to compile fails every template using it.
+ *
+ * A template that imports containers can not be saved as an image.
+ */
+enum lxt_error lxt_compile_library(struct lxt_template **,
+                                   char const * pattern,
+                                   size_t length,
+                                   struct lxt_library *);
+/**
+ * Compile only the parts of a template pattern that a generator uses,
+ * importing from a library if any.
+ *
+ * The pattern is first indexed by the names of its containers and
+ * generators, skipping over their entries and sequences; only the named
+ * generator, and the containers and generators that it uses, directly or
+ * through others, are then parsed and compiled. Parts that are not used
+ * are never validated, and modules are only compiled if used.
+ *
+ * The template holds no other generators; generating from it without
+ * naming the generator picks from those it holds. If the pattern does not
+ * define the generator, the whole pattern is compiled, as with
+ * `lxt_compile_library`.
+ *
+ * Returns LXT_ERROR_GENERATOR_NOT_FOUND if no generator is named.
+ */
+enum lxt_error lxt_compile_generator(struct lxt_template **,
+                                     char const * pattern,
+                                     size_t length,
+                                     struct lxt_library *,
+                                     char const * generator);
+
+/**
+ * The maximum length of results that are not bounded by any length.
+ */
+#define LXT_LENGTH_UNBOUNDED (UINT64_MAX)
+
+/**
+ * Represents the minimum and maximum length of results of a generator.
+ *
+ * Lengths do not include a null-terminator.
+ */
+struct lxt_bounds {
+    uint64_t min;
+    /**
+     * The maximum length of results, or LXT_LENGTH_UNBOUNDED if the
+     * generator is recursive.
+     */
+    uint64_t max;
+};
+
+/**
+ * Represents a generator of a compiled template.
+ */
+struct lxt_generator_info {
+    /**
+     * The name of the generator; not null-terminated.
+     */
+    char const * name;
+    size_t name_length;
+    struct lxt_bounds bounds;
+    /**
+     * The number of distinct combinations of the generator, as given by
+     * `lxt_count`; 0 if the generator is recursive.
+     */
+    uint64_t combinations;
+};
+
+/**
+ * Get the bounds of the length of results of a generator.
+ *
+ * If the generator is NULL, or not found, the bounds cover every generator
+ * of the template; as any of these could then be picked.
+ *
+ * A result of the generator never fits a buffer shorter than the minimum
+ * length, and always fits a buffer of the maximum length; plus 1 for the
+ * null-terminator.
+ */
+enum lxt_error lxt_measure(struct lxt_bounds *,
+                           struct lxt_template const *,
+                           char const * generator);
+/**
+ * Get the number of generators of a compiled template.
+ */
+uint32_t lxt_generator_count(struct lxt_template const *);
+/**
+ * Get the name and bounds of the generator at an index of a template.
+ *
+ * Returns LXT_ERROR_GENERATOR_NOT_FOUND if the index is out of range.
+ */
+enum lxt_error lxt_generator_at(struct lxt_generator_info *,
+                                struct lxt_template const *,
+                                uint32_t index);
+
+/**
+ * Generate a random result into buffer given a compiled template.
+ *
+ * The result is truncated if it exceeds the specified length.
+ */
+enum lxt_error lxt_gen_compiled(char * buffer,
+                                size_t length,
+                                struct lxt_template const *,
+                                struct lxt_opts);
+/**
+ * Generate the result at an index into buffer given a compiled template.
+ *
+ * Every index below the count of `lxt_count` is a distinct combination of
+ * entries of the generator of the options (or of every generator, one
+ * after another, if none is specified), and always results in the same
+ * combination; the random number generator or seed of the options is not
+ * used. Each entry of a combination is picked by a digit of the index,
+ * such that generating a result takes time proportional to its length.
+ *
+ * The result is truncated if it exceeds the specified length.
+ *
+ * Returns LXT_ERROR_OUT_OF_RANGE if the index is not below the count, or
+ * LXT_ERROR_UNSUPPORTED if the generator is recursive.
+ */
+enum lxt_error lxt_gen_at(char * buffer,
+                          size_t length,
+                          uint64_t index,
+                          struct lxt_template const *,
+                          struct lxt_opts);
+
+/**
+ * Represents a destination that results can be written to.
+ *
+ * Results are buffered internally and passed to the write function in
+ * blocks, such that small writes are batched. The write function returns
+ * 0 on success, or -1 on failure.
+ *
+ * Initialize a sink using any of the `lxt_sink_*` functions, or by
+ * specifying a write function directly.
+ */
+struct lxt_sink {
+    int32_t (* write)(void * context, char const * data, size_t length);
+    void * context;
+};
+
+/**
+ * Represents a buffer that grows as data is written to it.
+ *
+ * The data is not null-terminated. A buffer must be initialized to
+ * LXT_BUFFER_EMPTY before first use, and released using `lxt_buffer_free`.
+ */
+struct lxt_buffer {
+    char * data;
+    size_t length;
+    size_t capacity;
 };
 
+extern struct lxt_buffer const LXT_BUFFER_EMPTY;
+
+/**
+ * Initialize a sink that writes to a file stream.
+ */
+void lxt_sink_file(struct lxt_sink *, FILE *);
+/**
+ * Initialize a sink that writes to a file descriptor.
+ */
+void lxt_sink_fd(struct lxt_sink *, int fd);
+/**
+ * Initialize a sink that appends to a growable buffer.
+ */
+void lxt_sink_buffer(struct lxt_sink *, struct lxt_buffer *);
+/**
+ * Release the data of a growable buffer.
+ */
+void lxt_buffer_free(struct lxt_buffer *);
+
+/**
+ * The largest number of decimal digits that `lxt_count_exact` counts to.
+ */
+#define LXT_COUNT_MAX_DIGITS (100000)
+
+/**
+ * Count the distinct combinations of entries that results of a generator
+ * are made from.
+ *
+ * If the generator is NULL, the combinations of every generator of the
+ * template are counted together. The count saturates at UINT64_MAX; see
+ * `lxt_count_exact` for counts of any size.
+ *
+ * Returns LXT_ERROR_UNSUPPORTED if the generator is recursive, as its
+ * combinations can not be counted.
+ */
+enum lxt_error lxt_count(uint64_t *,
+                         struct lxt_template const *,
+                         char const * generator);
+/**
+ * Count the distinct combinations of entries that results of a generator
+ * are made from, exactly, and append the count to a buffer in decimal.
+ *
+ * Returns LXT_ERROR_UNSUPPORTED if the generator is recursive, or if the
+ * count has more than LXT_COUNT_MAX_DIGITS digits.
+ */
+enum lxt_error lxt_count_exact(struct lxt_buffer *,
+                               struct lxt_template const *,
+                               char const * generator);
+
+/**
+ * Generate a random result into a sink given a compiled template.
+ *
+ * Unlike `lxt_gen_compiled`, the result is never truncated; it is written
+ * to the sink in blocks as it is generated, such that results of any size
+ * can be generated using a bounded amount of memory.
+ *
+ * Returns LXT_ERROR_WRITE_FAILED if the sink fails to write.
+ */
+enum lxt_error lxt_gen_sink(struct lxt_sink const *,
+                            struct lxt_template const *,
+                            struct lxt_opts);
+
+/**
+ * Represents a set of named templates, each compiled from a pattern file and
+ * recompiled whenever its file changes.
+ *
+ * Reloading never blocks threads generating from a registry. A recompiled
+ * template replaces the previous version atomically; the previous version is
+ * released once no reader can be using it anymore. Templates that fail to
+ * compile are not published, keeping the previous version instead.
+ *
+ * Requires atomic operations (GCC or Clang); otherwise every registry
+ * function returns LXT_ERROR_UNSUPPORTED.
+ */
+struct lxt_registry;
+/**
+ * Represents a thread reading templates from a registry.
+ *
+ * Each thread generating from a registry needs a reader of its own.
+ */
+struct lxt_reader;
+
+enum lxt_error lxt_registry_create(struct lxt_registry **);
+/**
+ * Add a template to a registry, compiling it from a pattern file.
+ *
+ * If more than one template has the same name, the first one is used.
+ */
+enum lxt_error lxt_registry_add(struct lxt_registry *,
+                                char const * name,
+                                char const * filename);
+/**
+ * Add a file of lines that templates of a registry can declare using a
+ * `#lines` directive; see `lxt_library_add_lines`.
+ *
+ * Unlike files of a library, each template reads a copy of the files that
+ * it uses, and is recompiled whenever any of them changes. Add files before
+ * the templates that use them.
+ */
+enum lxt_error lxt_registry_add_lines(struct lxt_registry *,
+                                      char const * name,
+                                      char const * filename);
+/**
+ * Recompile the template of every file that has changed since it was last
+ * compiled, and publish the new versions.
+ *
+ * Returns the first error of any file that could not be recompiled; every
+ * other file is still reloaded.
+ */
+enum lxt_error lxt_registry_poll(struct lxt_registry *);
+/**
+ * Poll a registry in the background at an interval, in milliseconds, until
+ * the registry is released. Watching again changes the interval.
+ *
+ * Returns LXT_ERROR_OUT_OF_RANGE if the interval is zero, or
+ * LXT_ERROR_UNSUPPORTED if threads are not available.
+ */
+enum lxt_error lxt_registry_watch(struct lxt_registry *,
+                                  uint32_t interval);
+/**
+ * Release a registry and every template of it.
+ *
+ * Every reader must be released first.
+ */
+void lxt_registry_free(struct lxt_registry *);
+
+enum lxt_error lxt_reader_create(struct lxt_reader **,
+                                 struct lxt_registry *);
+/**
+ * Get the current version of a template of a registry by name.
+ *
+ * The template stays valid, even if reloaded, until the reader is released
+ * using `lxt_reader_release`. Acquiring never takes a lock.
+ *
+ * Returns NULL if the registry has no such template.
+ */
+struct lxt_template const * lxt_reader_acquire(struct lxt_reader *,
+                                               char const * name);
+/**
+ * Release every template acquired by a reader.
+ */
+void lxt_reader_release(struct lxt_reader *);
+void lxt_reader_free(struct lxt_reader *);
+
+/**
+ * Write a compiled template to a sink as a precompiled image.
+ *
+ * An image holds the pattern and compiled template in a versioned binary
+ * layout without any pointers, such that it can be loaded again without
+ * parsing; see `lxt_load`.
+ *
+ * Returns LXT_ERROR_UNSUPPORTED if the template imports any containers.
+ */
+enum lxt_error lxt_save(struct lxt_template const *,
+                        struct lxt_sink const *);
+/**
+ * Load a compiled template from a precompiled image in memory.
+ *
+ * The template points directly into the image, which must be aligned to
+ * 8 bytes and be valid for as long as the template is. Release the template
+ * using `lxt_free`.
+ *
+ * Returns LXT_ERROR_INVALID_IMAGE if the image is damaged, or was saved by
+ * an incompatible version or platform.
+ */
+enum lxt_error lxt_load(struct lxt_template **,
+                        void const * image,
+                        size_t length);
+/**
+ * Load a compiled template from a precompiled image file.
+ *
+ * The file is mapped into memory read-only where possible, such that any
+ * processes loading the same file share the same pages.
+ */
+enum lxt_error lxt_load_file(struct lxt_template **,
+                             char const * filename);
+
+/**
+ * Represents a batch of generated results.
+ *
+ * Results are stored back to back in a single buffer, without
+ * null-terminators. The result at index i spans the bytes from offsets[i]
+ * up to offsets[i + 1]; the same layout as a string column in Apache Arrow
+ * (with 64-bit offsets).
+ *
+ * For example:
+ *
+ *     [axesword]    (data)
+ *     [0, 3, 8]     (offsets, count = 2)
+ *
+ * A batch must be initialized to LXT_BATCH_EMPTY before first use, and
+ * released using `lxt_batch_free`.
+ */
+struct lxt_batch {
+    char * data;
+    int64_t * offsets;
+    /**
+     * The number of results in the batch.
+     */
+    size_t count;
+    /**
+     * The number of bytes allocated for data.
+     */
+    size_t capacity;
+    /**
+     * The number of results that offsets are allocated for.
+     */
+    size_t max_count;
+};
+
+extern struct lxt_batch const LXT_BATCH_EMPTY;
+
+/**
+ * Generate a number of random results into a batch given a compiled template.
+ *
+ * Results are appended to any results already in the batch. The batch grows
+ * as needed, such that results are never truncated.
+ *
+ * Generating a batch of results is equivalent to generating each result in
+ * turn using the same options.
+ */
+enum lxt_error lxt_gen_batch(struct lxt_batch *,
+                             size_t count,
+                             struct lxt_template const *,
+                             struct lxt_opts);
+/**
+ * Generate a number of random results into a batch, in parallel, given a
+ * compiled template.
+ *
+ * Unlike `lxt_gen_batch`, each result is generated independently from a
+ * generator split from the generator (or seed) of the options by the index
+ * of the result, starting from the first index. Neither the generator nor
+ * the seed of the options is advanced.
+ *
+ * Results are therefore identical no matter the number of jobs, and any
+ * range of results can be generated separately; for example, generating
+ * results 0-99 and 100-199 produces the same results as generating 0-199.
+ *
+ * Results are generated using up to the specified number of threads (jobs).
+ * If jobs is 0, one thread per available processor is used.
+ *
+ * Returns LXT_ERROR_UNSUPPORTED for custom generators, as these can not
+ * be split.
+ */
+enum lxt_error lxt_gen_batch_parallel(struct lxt_batch *,
+                                      uint64_t first,
+                                      size_t count,
+                                      struct lxt_template const *,
+                                      struct lxt_opts,
+                                      uint32_t jobs);
+/**
+ * Generate a number of distinct results into a batch given a compiled
+ * template.
+ *
+ * Results are the combinations of entries of the generator of the options
+ * (or of every generator, if none is specified), taken in the order of a
+ * pseudo-random permutation keyed by the generator (or seed) of the options,
+ * starting from the first index. Neither the generator nor the seed of the
+ * options is advanced.
+ *
+ * No combination is ever generated twice for the same options, such that
+ * consecutive ranges of results can be generated separately; for example,
+ * generating results 0-99 and then 100-199. Each result takes constant time,
+ * no matter how many results were generated before it, and memory does not
+ * depend on the number of results. Weights are ignored; each combination is
+ * generated exactly once. Note that different combinations can still spell
+ * out the same text.
+ *
+ * Fewer results are generated once combinations run out; compare the count
+ * of the batch to determine how many were generated.
+ *
+ * Returns LXT_ERROR_UNSUPPORTED if a generator is recursive, or for custom
+ * generators, as the combinations of neither can be enumerated.
+ */
+enum lxt_error lxt_gen_unique(struct lxt_batch *,
+                              uint64_t first,
+                              size_t count,
+                              struct lxt_template const *,
+                              struct lxt_opts);
+/**
+ * Make room in a batch for a total number of results and bytes of data.
+ *
+ * Reserving up front avoids growing a batch repeatedly while generating.
+ */
+enum lxt_error lxt_batch_reserve(struct lxt_batch *,
+                                 size_t count,
+                                 size_t capacity);
+/**
+ * Remove all results from a batch, keeping its memory for reuse.
+ */
+void lxt_batch_clear(struct lxt_batch *);
+void lxt_batch_free(struct lxt_batch *);
+
+/**
+ * Represents the state of generating results on a single thread; a random
+ * number generator and the memory that results are generated with.
+ *
+ * Generating using a context avoids setting up, and growing, that memory
+ * for every result. A context must only be used by one thread at a time;
+ * use one context per thread to generate from a shared template.
+ */
+struct lxt_ctx;
+
+/**
+ * Create a context for generating results, using a copy of the given
+ * random number generator.
+ *
+ * If the generator is NULL, a PCG32 generator with a fixed seed is used.
+ * Release the context using `lxt_ctx_free`.
+ */
+enum lxt_error lxt_ctx_create(struct lxt_ctx **,
+                              struct lxt_rng const *);
+/**
+ * Release a context.
+ */
+void lxt_ctx_free(struct lxt_ctx *);
+/**
+ * Get the random number generator of a context, for example to re-seed it.
+ */
+struct lxt_rng * lxt_ctx_rng(struct lxt_ctx *);
+/**
+ * Generate a random result into buffer given a compiled template, using a
+ * context.
+ *
+ * Equivalent to `lxt_gen_compiled`, except that the generator and seed of
+ * the options are ignored in favor of the generator of the context, which
+ * is advanced by each result.
+ */
+enum lxt_error lxt_gen_ctx(struct lxt_ctx *,
+                           char * buffer,
+                           size_t length,
+                           struct lxt_template const *,
+                           struct lxt_opts);
+/**
+ * Generate a random result into a sink given a compiled template, using a
+ * context.
+ *
+ * Equivalent to `lxt_gen_sink`; see `lxt_gen_ctx`.
+ */
+enum lxt_error lxt_gen_sink_ctx(struct lxt_ctx *,
+                                struct lxt_sink const *,
+                                struct lxt_template const *,
+                                struct lxt_opts);
+/**
+ * Generate a number of random results into a batch given a compiled
+ * template, using a context.
+ *
+ * Equivalent to `lxt_gen_batch`; see `lxt_gen_ctx`.
+ */
+enum lxt_error lxt_gen_batch_ctx(struct lxt_ctx *,
+                                 struct lxt_batch *,
+                                 size_t count,
+                                 struct lxt_template const *,
+                                 struct lxt_opts);
+
 /**
  * Generate a random result into buffer given a template pattern.
  *
+ * This is a convenience for compiling, generating and releasing a template
+ * in one go. Prefer `lxt_compile` when generating more than once.
+ *
  * The result is truncated if it exceeds the specified length.
  */
 enum lxt_error lxt_gen(char * buffer,
@@ -0,0 +1,88 @@
+#include "arena.h" // lxt_arena, lxt_list, lxt_arena_*, lxt_list_*
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // int32_t
+#include <stdlib.h> // malloc, realloc, free
+#include <string.h> // memset, memcpy
+
+#define ARENA_ALIGNMENT (8)
+
+#define LIST_INITIAL_CAPACITY (16)
+
+size_t
+lxt_arena_size(size_t const size)
+{
+    return (size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+int32_t
+lxt_arena_create(struct lxt_arena * const arena,
+                 size_t const capacity)
+{
+    arena->memory = malloc(capacity > 0 ? capacity : 1);
+    arena->capacity = capacity;
+    arena->offset = 0;
+    
+    if (arena->memory == NULL) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+void *
+lxt_arena_alloc(struct lxt_arena * const arena,
+                size_t const size)
+{
+    size_t const aligned_size = lxt_arena_size(size);
+    
+    if (aligned_size > arena->capacity - arena->offset) {
+        return NULL;
+    }
+    
+    void * const memory = arena->memory + arena->offset;
+    
+    memset(memory, 0, aligned_size);
+    
+    arena->offset += aligned_size;
+    
+    return memory;
+}
+
+void *
+lxt_list_push(struct lxt_list * const list,
+              void const * const item,
+              size_t const item_size)
+{
+    if (list->count == list->capacity) {
+        size_t const capacity = list->capacity == 0 ?
+            LIST_INITIAL_CAPACITY : list->capacity * 2;
+        
+        char * const items = realloc(list->items, capacity * item_size);
+        
+        if (items == NULL) {
+            return NULL;
+        }
+        
+        list->items = items;
+        list->capacity = capacity;
+    }
+    
+    void * const slot = list->items + (list->count * item_size);
+    
+    memcpy(slot, item, item_size);
+    
+    list->count += 1;
+    
+    return slot;
+}
+
+void
+lxt_list_free(struct lxt_list * const list)
+{
+    free(list->items);
+    
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <stdint.h> // int32_t
+
+/**
+ * Represents a single block of memory that allocations are carved from.
+ *
+ * An arena is allocated once, with the combined size of everything that
+ * goes in it, and is released all at once. Allocations are made in sequence
+ * and are aligned so that any kind of struct can be placed in the arena.
+ *
+ * For example:
+ *
+ *     [•••••••••••••••••••••••]    (capacity = 23)
+ *      |---A---|---B---|^          (offset = 16)
+ *
+ */
+struct lxt_arena {
+    char * memory;
+    size_t capacity;
+    size_t offset;
+};
+
+/**
+ * Represents a growable array of items of the same size.
+ *
+ * Lists are used for staging items while their total count is still unknown;
+ * typically before moving them into an arena.
+ */
+struct lxt_list {
+    char * items;
+    size_t count;
+    size_t capacity;
+};
+
+/**
+ * Get the size that an allocation of a given size occupies in an arena.
+ */
+size_t lxt_arena_size(size_t size);
+
+int32_t lxt_arena_create(struct lxt_arena *, size_t capacity);
+/**
+ * Allocate zeroed memory from an arena.
+ *
+ * Returns NULL if the arena does not have enough remaining capacity.
+ */
+void * lxt_arena_alloc(struct lxt_arena *, size_t size);
+
+/**
+ * Append an item to a list and get a pointer to it in the list.
+ *
+ * Returns NULL if the list could not grow.
+ */
+void * lxt_list_push(struct lxt_list *,
+                     void const * item,
+                     size_t item_size);
+void lxt_list_free(struct lxt_list *);
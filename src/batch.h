@@ -0,0 +1,20 @@
+#pragma once
+
+#include <lext/lext.h> // lxt_batch, lxt_rng, lxt_template, lxt_opts, lxt_error
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+/**
+ * Generate a number of random results into a batch, each from a generator
+ * split from a base generator by the index of the result.
+ *
+ * Results are appended to any results already in the batch. Any seed or
+ * random number generator of the options is ignored.
+ */
+enum lxt_error lxt_gen_batch_split(struct lxt_batch *,
+                                   struct lxt_rng const *,
+                                   uint64_t first,
+                                   size_t count,
+                                   struct lxt_template const *,
+                                   struct lxt_opts);
@@ -0,0 +1,471 @@
+#include <lext/lext.h> // lxt_count, lxt_count_exact, lxt_buffer, lxt_error
+
+#include "template.h" // lxt_template, lxt_generator, lxt_op, lxt_*
+#include "token.h" // lxt_token, lxt_token_hash
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint64_t, uint8_t, UINT32_MAX, UINT64_MAX
+#include <stdlib.h> // calloc, realloc, free
+#include <string.h> // strlen
+#include <stdio.h> // snprintf
+
+// the base of each limb of a big number; a power of 10, such that each
+// limb converts to exactly LIMB_DIGITS decimal digits
+#define LIMB_BASE (1000000000U)
+#define LIMB_DIGITS (9)
+
+/**
+ * Represents an arbitrarily large natural number.
+ *
+ * The number is stored as limbs of base LIMB_BASE, least significant first.
+ */
+struct lxt_big {
+    uint32_t * limbs;
+    size_t count;
+    size_t capacity;
+};
+
+/**
+ * Find the generator to count, or every generator if name is NULL.
+ */
+static enum lxt_error lxt_count_find(struct lxt_generator const **,
+                                     struct lxt_template const *,
+                                     char const * name);
+/**
+ * Count the combinations of a generator exactly.
+ *
+ * Each generator is resolved some number of times by a result of the
+ * counted generator, picking from each container some number of times; the
+ * count is the product of the number of entries of each pick.
+ */
+static enum lxt_error lxt_count_generator(struct lxt_big *,
+                                          struct lxt_template const *,
+                                          uint32_t generator_index);
+
+static int32_t lxt_big_set(struct lxt_big *, uint32_t value);
+static int32_t lxt_big_multiply(struct lxt_big *, uint32_t factor);
+static int32_t lxt_big_add(struct lxt_big *, struct lxt_big const *);
+static void lxt_big_free(struct lxt_big *);
+
+/**
+ * Add two counts of resolves, saturating at UINT64_MAX.
+ */
+static uint64_t lxt_add_count(uint64_t, uint64_t);
+
+enum lxt_error
+lxt_count(uint64_t * const count,
+          struct lxt_template const * const template,
+          char const * const name)
+{
+    *count = 0;
+    
+    struct lxt_generator const * generator = NULL;
+    
+    enum lxt_error const error = lxt_count_find(&generator, template, name);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    if (generator != NULL) {
+        *count = generator->combinations;
+    } else {
+        for (uint32_t i = 0; i < template->generator_count; i++) {
+            uint64_t const combinations =
+                template->generators[i].combinations;
+            
+            if (combinations == 0) {
+                *count = 0;
+                
+                break;
+            }
+            
+            *count = lxt_add_count(*count, combinations);
+        }
+    }
+    
+    if (*count == 0) {
+        // recursive generators have no countable combinations
+        return LXT_ERROR_UNSUPPORTED;
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_count_exact(struct lxt_buffer * const buffer,
+                struct lxt_template const * const template,
+                char const * const name)
+{
+    uint64_t saturated = 0;
+    
+    // rule out recursive generators up front
+    enum lxt_error error = lxt_count(&saturated, template, name);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    struct lxt_generator const * generator = NULL;
+    
+    lxt_count_find(&generator, template, name);
+    
+    struct lxt_big total = { NULL, 0, 0 };
+    struct lxt_big count = { NULL, 0, 0 };
+    
+    if (lxt_big_set(&total, 0) != 0) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    for (uint32_t i = 0; i < template->generator_count; i++) {
+        if (generator != NULL && generator != &template->generators[i]) {
+            continue;
+        }
+        
+        error = lxt_count_generator(&count, template, i);
+        
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+        
+        if (lxt_big_add(&total, &count) != 0) {
+            error = LXT_ERROR_OUT_OF_MEMORY;
+            
+            break;
+        }
+    }
+    
+    if (error == LXT_ERROR_NONE) {
+        struct lxt_sink sink;
+        
+        lxt_sink_buffer(&sink, buffer);
+        
+        // the most significant limb is written without leading zeros
+        for (size_t i = total.count; i > 0; i--) {
+            char digits[LIMB_DIGITS + 1];
+            
+            int const length = snprintf(digits, sizeof(digits),
+                                        i == total.count ? "%u" : "%09u",
+                                        (unsigned)total.limbs[i - 1]);
+            
+            if (sink.write(sink.context, digits, (size_t)length) != 0) {
+                error = LXT_ERROR_OUT_OF_MEMORY;
+                
+                break;
+            }
+        }
+    }
+    
+    lxt_big_free(&count);
+    lxt_big_free(&total);
+    
+    return error;
+}
+
+static
+enum lxt_error
+lxt_count_find(struct lxt_generator const ** const generator,
+               struct lxt_template const * const template,
+               char const * const name)
+{
+    *generator = NULL;
+    
+    if (template->generator_count == 0) {
+        return LXT_ERROR_GENERATOR_NOT_FOUND;
+    }
+    
+    if (name == NULL) {
+        return LXT_ERROR_NONE;
+    }
+    
+    struct lxt_token token;
+    
+    token.start = name;
+    token.length = strlen(name);
+    
+    if (!lxt_find_generator(generator, token, lxt_token_hash(token),
+                            template)) {
+        return LXT_ERROR_GENERATOR_NOT_FOUND;
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+static
+enum lxt_error
+lxt_count_generator(struct lxt_big * const count,
+                    struct lxt_template const * const template,
+                    uint32_t const generator_index)
+{
+    struct lxt_frame {
+        uint32_t generator;
+        uint32_t op;
+    };
+    
+    uint32_t const generator_count = template->generator_count;
+    
+    struct lxt_frame * const stack =
+        calloc(generator_count, sizeof(struct lxt_frame));
+    uint8_t * const visited = calloc(generator_count, sizeof(uint8_t));
+    // generators in the order that they finished being visited; every
+    // generator comes after the generators it resolves
+    uint32_t * const order = calloc(generator_count, sizeof(uint32_t));
+    uint64_t * const resolves = calloc(generator_count, sizeof(uint64_t));
+    // picks of imported containers come after those of the template
+    uint32_t const container_count =
+        template->container_count + template->import_count;
+    
+    uint64_t * const picks = calloc(container_count + 1, sizeof(uint64_t));
+    
+    enum lxt_error error = LXT_ERROR_NONE;
+    
+    if (stack == NULL || visited == NULL || order == NULL ||
+        resolves == NULL || picks == NULL ||
+        lxt_big_set(count, 1) != 0) {
+        error = LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    uint32_t order_count = 0;
+    uint32_t depth = 0;
+    
+    if (error == LXT_ERROR_NONE) {
+        stack[depth++] = (struct lxt_frame) {
+            .generator = generator_index,
+            .op = 0
+        };
+        
+        visited[generator_index] = 1;
+    }
+    
+    while (depth > 0) {
+        struct lxt_frame * const frame = &stack[depth - 1];
+        struct lxt_generator const * const generator =
+            &template->generators[frame->generator];
+        
+        if (frame->op == generator->op_count) {
+            order[order_count++] = frame->generator;
+            
+            depth -= 1;
+            
+            continue;
+        }
+        
+        struct lxt_op const * const op =
+            &template->ops[generator->op_index + frame->op];
+        
+        frame->op += 1;
+        
+        if (op->kind == LXT_OP_GENERATOR && !visited[op->index]) {
+            // the generator is not recursive, so the depth never exceeds
+            // the number of generators
+            stack[depth++] = (struct lxt_frame) {
+                .generator = op->index,
+                .op = 0
+            };
+            
+            visited[op->index] = 1;
+        }
+    }
+    
+    if (error == LXT_ERROR_NONE) {
+        resolves[generator_index] = 1;
+    }
+    
+    // callers come before the generators they resolve in reverse order
+    for (uint32_t i = order_count; i > 0; i--) {
+        struct lxt_generator const * const generator =
+            &template->generators[order[i - 1]];
+        
+        uint64_t const times = resolves[order[i - 1]];
+        
+        for (uint32_t k = 0; k < generator->op_count; k++) {
+            struct lxt_op const * const op =
+                &template->ops[generator->op_index + k];
+            
+            if (op->kind == LXT_OP_GENERATOR) {
+                resolves[op->index] =
+                    lxt_add_count(resolves[op->index], times);
+            } else if (op->kind == LXT_OP_CONTAINER) {
+                picks[op->index] = lxt_add_count(picks[op->index], times);
+            } else if (op->kind == LXT_OP_IMPORT) {
+                uint32_t const pick = template->container_count + op->index;
+                
+                picks[pick] = lxt_add_count(picks[pick], times);
+            }
+        }
+    }
+    
+    // multiply by as many entry counts at a time as fit in a factor
+    uint64_t factor = 1;
+    
+    for (uint32_t i = 0; i < container_count; i++) {
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+        
+        struct lxt_container const * const container =
+            i < template->container_count ? &template->containers[i] :
+            template->imports[i - template->container_count].container;
+        
+        uint32_t const entries = container->entry_count;
+        
+        if (entries < 2) {
+            continue;
+        }
+        
+        for (uint64_t k = 0; k < picks[i]; k++) {
+            if (factor * entries > UINT32_MAX) {
+                if (lxt_big_multiply(count, (uint32_t)factor) != 0) {
+                    error = LXT_ERROR_OUT_OF_MEMORY;
+                    
+                    break;
+                }
+                
+                factor = 1;
+            }
+            
+            factor *= entries;
+            
+            if (count->count > LXT_COUNT_MAX_DIGITS / LIMB_DIGITS) {
+                error = LXT_ERROR_UNSUPPORTED;
+                
+                break;
+            }
+        }
+    }
+    
+    if (error == LXT_ERROR_NONE &&
+        lxt_big_multiply(count, (uint32_t)factor) != 0) {
+        error = LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    free(stack);
+    free(visited);
+    free(order);
+    free(resolves);
+    free(picks);
+    
+    return error;
+}
+
+static
+int32_t
+lxt_big_set(struct lxt_big * const big,
+            uint32_t const value)
+{
+    if (big->capacity == 0) {
+        uint32_t * const limbs = realloc(big->limbs, 16 * sizeof(uint32_t));
+        
+        if (limbs == NULL) {
+            return -1;
+        }
+        
+        big->limbs = limbs;
+        big->capacity = 16;
+    }
+    
+    big->limbs[0] = value;
+    big->count = 1;
+    
+    return 0;
+}
+
+static
+int32_t
+lxt_big_multiply(struct lxt_big * const big,
+                 uint32_t const factor)
+{
+    uint64_t carry = 0;
+    
+    for (size_t i = 0; i < big->count; i++) {
+        uint64_t const product = (uint64_t)big->limbs[i] * factor + carry;
+        
+        big->limbs[i] = (uint32_t)(product % LIMB_BASE);
+        
+        carry = product / LIMB_BASE;
+    }
+    
+    while (carry > 0) {
+        if (big->count == big->capacity) {
+            uint32_t * const limbs =
+                realloc(big->limbs, big->capacity * 2 * sizeof(uint32_t));
+            
+            if (limbs == NULL) {
+                return -1;
+            }
+            
+            big->limbs = limbs;
+            big->capacity *= 2;
+        }
+        
+        big->limbs[big->count++] = (uint32_t)(carry % LIMB_BASE);
+        
+        carry /= LIMB_BASE;
+    }
+    
+    return 0;
+}
+
+static
+int32_t
+lxt_big_add(struct lxt_big * const big,
+            struct lxt_big const * const other)
+{
+    size_t const count = (big->count > other->count ?
+                          big->count : other->count) + 1;
+    
+    if (count > big->capacity) {
+        uint32_t * const limbs = realloc(big->limbs, count * sizeof(uint32_t));
+        
+        if (limbs == NULL) {
+            return -1;
+        }
+        
+        big->limbs = limbs;
+        big->capacity = count;
+    }
+    
+    uint32_t carry = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        uint32_t const a = i < big->count ? big->limbs[i] : 0;
+        uint32_t const b = i < other->count ? other->limbs[i] : 0;
+        uint32_t const sum = a + b + carry;
+        
+        big->limbs[i] = sum % LIMB_BASE;
+        
+        carry = sum / LIMB_BASE;
+    }
+    
+    big->count = count;
+    
+    // drop the leading zero limb, unless the number is zero
+    while (big->count > 1 && big->limbs[big->count - 1] == 0) {
+        big->count -= 1;
+    }
+    
+    return 0;
+}
+
+static
+void
+lxt_big_free(struct lxt_big * const big)
+{
+    free(big->limbs);
+    
+    big->limbs = NULL;
+    big->count = 0;
+    big->capacity = 0;
+}
+
+static
+uint64_t
+lxt_add_count(uint64_t const a,
+              uint64_t const b)
+{
+    if (a > UINT64_MAX - b) {
+        return UINT64_MAX;
+    }
+    
+    return a + b;
+}
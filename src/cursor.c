@@ -1,10 +1,30 @@
 #include "cursor.h" // lxt_cursor, lxt_cursor_*, lxt_cursor_direction
 #include "token.h" // lxt_token
+#include "scan.h" // lxt_class_is, LXT_CLASS_SPACE
+
+#include <lext/lext.h> // lxt_sink
 
 #include <stdint.h> // int32_t
+#include <stdbool.h> // true, false
 #include <string.h> // memcpy
 
-#include <ctype.h> // isspace
+/**
+ * Write a token through the buffer of a cursor to its sink.
+ */
+static int32_t lxt_cursor_stream(struct lxt_cursor *, struct lxt_token);
+
+void
+lxt_cursor_init(struct lxt_cursor * const cursor,
+                char * const buffer,
+                size_t const length,
+                struct lxt_sink const * const sink)
+{
+    cursor->buffer = buffer;
+    cursor->offset = 0;
+    cursor->length = length;
+    cursor->sink = sink;
+    cursor->failed = false;
+}
 
 int32_t
 lxt_cursor_write(struct lxt_cursor * const cursor,
@@ -14,6 +34,10 @@ lxt_cursor_write(struct lxt_cursor * const cursor,
         return -1;
     }
     
+    if (cursor->sink != NULL) {
+        return lxt_cursor_stream(cursor, token);
+    }
+    
     if (cursor->offset >= cursor->length) {
         return -1;
     }
@@ -33,18 +57,72 @@ lxt_cursor_write(struct lxt_cursor * const cursor,
     return 0;
 }
 
+int32_t
+lxt_cursor_flush(struct lxt_cursor * const cursor)
+{
+    if (cursor->sink == NULL || cursor->offset == 0) {
+        return 0;
+    }
+    
+    struct lxt_sink const * const sink = cursor->sink;
+    
+    if (sink->write(sink->context, cursor->buffer, cursor->offset) != 0) {
+        cursor->failed = true;
+        
+        return -1;
+    }
+    
+    cursor->offset = 0;
+    
+    return 0;
+}
+
 size_t
 lxt_cursor_spaces(char const * text,
+                  size_t const length,
                   enum lxt_cursor_direction const direction)
 {
-    size_t length = 0;
+    size_t spaces = 0;
     int32_t offset = direction == LXT_CURSOR_DIRECTION_REVERSE ? -1 : 1;
     
-    while (*text && isspace(*text)) {
-        length += 1;
+    while (spaces < length && lxt_class_is(*text, LXT_CLASS_SPACE)) {
+        spaces += 1;
         
         text += offset;
     }
     
-    return length;
+    return spaces;
+}
+
+static
+int32_t
+lxt_cursor_stream(struct lxt_cursor * const cursor,
+                  struct lxt_token const token)
+{
+    if (token.length > cursor->length - cursor->offset) {
+        if (lxt_cursor_flush(cursor) != 0) {
+            return -1;
+        }
+        
+        if (token.length > cursor->length) {
+            // too large to buffer; write it through directly
+            struct lxt_sink const * const sink = cursor->sink;
+            
+            if (sink->write(sink->context, token.start, token.length) != 0) {
+                cursor->failed = true;
+                
+                return -1;
+            }
+            
+            return 0;
+        }
+    }
+    
+    memcpy(cursor->buffer + cursor->offset,
+           token.start,
+           token.length);
+    
+    cursor->offset += token.length;
+    
+    return 0;
 }
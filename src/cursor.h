@@ -2,8 +2,10 @@
 
 #include <stddef.h> // size_t
 #include <stdint.h> // int32_t
+#include <stdbool.h> // bool
 
 struct lxt_token;
+struct lxt_sink;
 
 /**
  * Represents a cursor in a writable buffer.
@@ -19,11 +21,18 @@ struct lxt_token;
  *     [•••••]    (buffer)
  *      ^         (offset = 0)
  *
+ * If the cursor has a sink, the buffer is flushed to the sink whenever it
+ * fills up, such that writes are never truncated.
  */
 struct lxt_cursor {
     char * buffer;
     size_t offset;
     size_t length;
+    struct lxt_sink const * sink;
+    /**
+     * Determines whether the sink of the cursor has failed to write.
+     */
+    bool failed;
 };
 
 enum lxt_cursor_direction {
@@ -31,11 +40,28 @@ enum lxt_cursor_direction {
     LXT_CURSOR_DIRECTION_REVERSE
 };
 
+/**
+ * Initialize a cursor in a buffer.
+ *
+ * If sink is NULL, writes beyond the length of the buffer are truncated.
+ */
+void lxt_cursor_init(struct lxt_cursor *,
+                     char * buffer,
+                     size_t length,
+                     struct lxt_sink const * sink);
+
 int32_t lxt_cursor_write(struct lxt_cursor *, struct lxt_token);
+/**
+ * Write any buffered data to the sink of a cursor.
+ */
+int32_t lxt_cursor_flush(struct lxt_cursor *);
 
 /**
  * Count the amount of whitespace to the left or right of a pointed string.
  *
+ * At most length characters are counted, such that the count never goes
+ * beyond the bounds of the string.
+ *
  * Examples:
  *
  *      ↓
@@ -56,4 +82,6 @@ int32_t lxt_cursor_write(struct lxt_cursor *, struct lxt_token);
  *     [••abc•••]    (reverse, spaces = 2)
  *
  */
-size_t lxt_cursor_spaces(char const * text, enum lxt_cursor_direction);
+size_t lxt_cursor_spaces(char const * text,
+                         size_t length,
+                         enum lxt_cursor_direction);
@@ -0,0 +1,848 @@
+#if !defined(_WIN32)
+ #define _POSIX_C_SOURCE 200809L // mmap, fstat
+#endif
+
+#include <lext/lext.h> // lxt_save, lxt_load, lxt_sink, lxt_error
+
+#include "template.h" // lxt_template, lxt_container, lxt_generator, lxt_*
+#include "arena.h" // lxt_arena_size
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint64_t, uint8_t, uintptr_t
+#include <stdbool.h> // bool, true, false
+#include <stdlib.h> // malloc, calloc, realloc, free
+#include <string.h> // memcmp, memset
+#include <stdio.h> // FILE, fopen, fread, fclose
+
+#if !defined(_WIN32)
+ #include <sys/mman.h> // mmap, munmap
+ #include <sys/stat.h> // fstat, stat, S_ISREG
+ #include <fcntl.h> // open, O_RDONLY
+ #include <unistd.h> // close
+#endif
+
+#define IMAGE_MAGIC "LXTC"
+/**
+ * The version of the image layout.
+ *
+ * Increment this whenever the layout of the header, or any of the
+ * structures stored in an image, changes.
+ */
+#define IMAGE_VERSION (5)
+/**
+ * A marker for determining whether an image was saved on a platform with
+ * the same byte order.
+ */
+#define IMAGE_BYTE_ORDER (0x01020304)
+
+/**
+ * Represents the header of a precompiled template image.
+ *
+ * An image is laid out as the header followed by each of the arrays of
+ * a template, with every section aligned to 8 bytes:
+ *
+ *     [header|pattern|literals|containers|generators|entries|ops|weights|
+ *      symbols]
+ *
+ * Sections are located by their offset from the beginning of the image,
+ * so that an image can be used from wherever it is loaded in memory.
+ */
+struct lxt_image_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t container_count;
+    uint32_t generator_count;
+    uint32_t entry_count;
+    uint32_t op_count;
+    uint32_t container_capacity;
+    uint32_t generator_capacity;
+    uint32_t weight_count;
+    uint32_t generator_weight_total;
+    uint32_t reserved;
+    uint64_t pattern_length;
+    uint64_t pattern_offset;
+    uint64_t literal_length;
+    uint64_t literals_offset;
+    uint64_t containers_offset;
+    uint64_t generators_offset;
+    uint64_t entries_offset;
+    uint64_t ops_offset;
+    uint64_t weights_offset;
+    uint64_t container_symbols_offset;
+    uint64_t generator_symbols_offset;
+    uint64_t length;
+};
+
+/**
+ * Write a section of an image, padded to the alignment of sections.
+ */
+static int32_t lxt_image_write(struct lxt_sink const *,
+                               void const * data,
+                               size_t length);
+/**
+ * Get a pointer to a section of an image.
+ *
+ * Returns NULL if the section does not fit within the image.
+ */
+static void const * lxt_image_section(void const * image,
+                                      size_t length,
+                                      uint64_t offset,
+                                      uint64_t count,
+                                      size_t size);
+/**
+ * Determine whether every span, index and symbol of a template is within
+ * bounds, such that generating from it is safe.
+ */
+static bool lxt_image_validates(struct lxt_template const *,
+                                uint64_t pattern_length);
+static bool lxt_span_validates(struct lxt_span, uint64_t pattern_length);
+/**
+ * Determine whether resolving any generator of a template comes to an end.
+ *
+ * Only recursion operations are checked for cycles while resolving; every
+ * other operation that resolves a generator must not lead back to it.
+ *
+ * Returns LXT_ERROR_INVALID_IMAGE if any generator resolves itself without
+ * a recursion operation, or if any generator that can resolve a recursion
+ * operation has countable combinations.
+ */
+static enum lxt_error lxt_generators_validate(struct lxt_template const *);
+/**
+ * Determine whether the text of an operation is within bounds; either of
+ * the pattern or of the literals.
+ */
+static bool lxt_text_validates(struct lxt_span,
+                               struct lxt_template const *,
+                               uint64_t pattern_length);
+static bool lxt_weights_validate(struct lxt_template const *,
+                                 uint32_t index,
+                                 uint32_t count,
+                                 uint32_t total);
+static bool lxt_symbols_validate(struct lxt_symbols,
+                                 uint32_t capacity,
+                                 uint32_t count,
+                                 uint64_t pattern_length);
+
+enum lxt_error
+lxt_save(struct lxt_template const * const template,
+         struct lxt_sink const * const sink)
+{
+    if (template->import_count > 0) {
+        // imported containers belong to other templates, which can not be
+        // part of the image
+        return LXT_ERROR_UNSUPPORTED;
+    }
+    
+    struct lxt_image_header header;
+    
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    
+    header.version = IMAGE_VERSION;
+    header.byte_order = IMAGE_BYTE_ORDER;
+    header.container_count = template->container_count;
+    header.generator_count = template->generator_count;
+    header.entry_count = template->entry_count;
+    header.op_count = template->op_count;
+    header.weight_count = template->weight_count;
+    header.generator_weight_total = template->generator_weight_total;
+    header.container_capacity = template->container_symbols.mask + 1;
+    header.generator_capacity = template->generator_symbols.mask + 1;
+    
+    // the pattern only needs to extend to the end of its last span; any
+    // trailing comments or whitespace are left out
+    uint64_t pattern_length = 0;
+    
+    for (uint32_t i = 0; i < template->container_count; i++) {
+        struct lxt_span const span = template->containers[i].entry;
+        
+        if (span.offset + (uint64_t)span.length > pattern_length) {
+            pattern_length = span.offset + (uint64_t)span.length;
+        }
+    }
+    
+    for (uint32_t i = 0; i < template->generator_count; i++) {
+        struct lxt_generator const * const generator =
+            &template->generators[i];
+        
+        uint64_t const end = generator->sequence.length > 0 ?
+            generator->sequence.offset + (uint64_t)generator->sequence.length :
+            generator->entry.offset + (uint64_t)generator->entry.length;
+        
+        if (end > pattern_length) {
+            pattern_length = end;
+        }
+    }
+    
+    for (uint32_t i = 0; i < template->entry_count; i++) {
+        struct lxt_span const span = template->entries[i];
+        
+        if (span.offset + (uint64_t)span.length > pattern_length) {
+            pattern_length = span.offset + (uint64_t)span.length;
+        }
+    }
+    
+    size_t const sizes[] = {
+        sizeof(header),
+        (size_t)pattern_length,
+        template->literal_length,
+        template->container_count * sizeof(struct lxt_container),
+        template->generator_count * sizeof(struct lxt_generator),
+        template->entry_count * sizeof(struct lxt_span),
+        template->op_count * sizeof(struct lxt_op),
+        template->weight_count * sizeof(struct lxt_weight),
+        header.container_capacity * sizeof(struct lxt_symbol),
+        header.generator_capacity * sizeof(struct lxt_symbol)
+    };
+    
+    uint64_t * const offsets[] = {
+        NULL,
+        &header.pattern_offset,
+        &header.literals_offset,
+        &header.containers_offset,
+        &header.generators_offset,
+        &header.entries_offset,
+        &header.ops_offset,
+        &header.weights_offset,
+        &header.container_symbols_offset,
+        &header.generator_symbols_offset
+    };
+    
+    void const * const sections[] = {
+        &header,
+        template->pattern,
+        template->literals,
+        template->containers,
+        template->generators,
+        template->entries,
+        template->ops,
+        template->weights,
+        template->container_symbols.slots,
+        template->generator_symbols.slots
+    };
+    
+    size_t const section_count = sizeof(sizes) / sizeof(sizes[0]);
+    
+    uint64_t offset = 0;
+    
+    for (size_t i = 0; i < section_count; i++) {
+        if (offsets[i] != NULL) {
+            *offsets[i] = offset;
+        }
+        
+        offset += lxt_arena_size(sizes[i]);
+    }
+    
+    header.pattern_length = pattern_length;
+    header.literal_length = template->literal_length;
+    header.length = offset;
+    
+    for (size_t i = 0; i < section_count; i++) {
+        if (lxt_image_write(sink, sections[i], sizes[i]) != 0) {
+            return LXT_ERROR_WRITE_FAILED;
+        }
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_load(struct lxt_template ** const template,
+         void const * const image,
+         size_t const length)
+{
+    *template = NULL;
+    
+    struct lxt_image_header const * const header = image;
+    
+    if (image == NULL || length < sizeof(*header) ||
+        ((uintptr_t)image & 7) != 0) {
+        return LXT_ERROR_INVALID_IMAGE;
+    }
+    
+    if (memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != IMAGE_VERSION ||
+        header->byte_order != IMAGE_BYTE_ORDER ||
+        header->length > length) {
+        return LXT_ERROR_INVALID_IMAGE;
+    }
+    
+    if (header->container_capacity == 0 ||
+        header->generator_capacity == 0 ||
+        (header->container_capacity & (header->container_capacity - 1)) ||
+        (header->generator_capacity & (header->generator_capacity - 1))) {
+        // symbol tables must be a power of two in size
+        return LXT_ERROR_INVALID_IMAGE;
+    }
+    
+    struct lxt_template loaded;
+    
+    memset(&loaded, 0, sizeof(loaded));
+    
+    loaded.pattern =
+        lxt_image_section(image, length, header->pattern_offset,
+                          header->pattern_length, sizeof(char));
+    loaded.literals =
+        lxt_image_section(image, length, header->literals_offset,
+                          header->literal_length, sizeof(char));
+    loaded.containers =
+        lxt_image_section(image, length, header->containers_offset,
+                          header->container_count,
+                          sizeof(struct lxt_container));
+    loaded.generators =
+        lxt_image_section(image, length, header->generators_offset,
+                          header->generator_count,
+                          sizeof(struct lxt_generator));
+    loaded.entries =
+        lxt_image_section(image, length, header->entries_offset,
+                          header->entry_count,
+                          sizeof(struct lxt_span));
+    loaded.ops =
+        lxt_image_section(image, length, header->ops_offset,
+                          header->op_count,
+                          sizeof(struct lxt_op));
+    loaded.weights =
+        lxt_image_section(image, length, header->weights_offset,
+                          header->weight_count,
+                          sizeof(struct lxt_weight));
+    loaded.container_symbols.slots =
+        lxt_image_section(image, length, header->container_symbols_offset,
+                          header->container_capacity,
+                          sizeof(struct lxt_symbol));
+    loaded.generator_symbols.slots =
+        lxt_image_section(image, length, header->generator_symbols_offset,
+                          header->generator_capacity,
+                          sizeof(struct lxt_symbol));
+    
+    if (loaded.pattern == NULL ||
+        loaded.literals == NULL ||
+        header->literal_length > LXT_SPAN_LITERAL ||
+        loaded.containers == NULL ||
+        loaded.generators == NULL ||
+        loaded.entries == NULL ||
+        loaded.ops == NULL ||
+        loaded.weights == NULL ||
+        loaded.container_symbols.slots == NULL ||
+        loaded.generator_symbols.slots == NULL) {
+        return LXT_ERROR_INVALID_IMAGE;
+    }
+    
+    loaded.container_symbols.mask = header->container_capacity - 1;
+    loaded.generator_symbols.mask = header->generator_capacity - 1;
+    loaded.container_count = header->container_count;
+    loaded.generator_count = header->generator_count;
+    loaded.entry_count = header->entry_count;
+    loaded.op_count = header->op_count;
+    loaded.weight_count = header->weight_count;
+    loaded.literal_length = (uint32_t)header->literal_length;
+    loaded.generator_weight_total = header->generator_weight_total;
+    
+    if (!lxt_image_validates(&loaded, header->pattern_length)) {
+        return LXT_ERROR_INVALID_IMAGE;
+    }
+    
+    enum lxt_error const error = lxt_generators_validate(&loaded);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    *template = malloc(sizeof(struct lxt_template));
+    
+    if (*template == NULL) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    **template = loaded;
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_load_file(struct lxt_template ** const template,
+              char const * const filename)
+{
+    *template = NULL;
+    
+    struct lxt_template image;
+    
+    enum lxt_error error = lxt_read_image(&image, filename, true);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    error = lxt_load(template, image.image, image.image_length);
+    
+    if (error != LXT_ERROR_NONE) {
+        lxt_release_image(&image);
+        
+        return error;
+    }
+    
+    (*template)->image = image.image;
+    (*template)->image_length = image.image_length;
+    (*template)->image_mapped = image.image_mapped;
+    
+    return LXT_ERROR_NONE;
+}
+
+void
+lxt_release_image(struct lxt_template * const template)
+{
+    if (template->image == NULL) {
+        return;
+    }
+
+#if !defined(_WIN32)
+    if (template->image_mapped) {
+        munmap(template->image, template->image_length);
+        
+        template->image = NULL;
+        
+        return;
+    }
+#endif
+    
+    free(template->image);
+    
+    template->image = NULL;
+}
+
+enum lxt_error
+lxt_read_image(struct lxt_template * const image,
+               char const * const filename,
+               bool const map)
+{
+    image->image = NULL;
+    image->image_length = 0;
+    image->image_mapped = false;
+
+#if !defined(_WIN32)
+    if (map) {
+        int const fd = open(filename, O_RDONLY);
+        
+        if (fd < 0) {
+            return LXT_ERROR_READ_FAILED;
+        }
+        
+        struct stat status;
+        
+        if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) &&
+            status.st_size > 0) {
+            void * const data = mmap(NULL, (size_t)status.st_size,
+                                     PROT_READ, MAP_SHARED, fd, 0);
+            
+            if (data != MAP_FAILED) {
+                close(fd);
+                
+                image->image = data;
+                image->image_length = (size_t)status.st_size;
+                image->image_mapped = true;
+                
+                return LXT_ERROR_NONE;
+            }
+        }
+        
+        close(fd);
+    }
+#else
+    (void)map;
+#endif
+    
+    // could not map the file; read it into memory instead
+    FILE * const file = fopen(filename, "rb");
+    
+    if (file == NULL) {
+        return LXT_ERROR_READ_FAILED;
+    }
+    
+    size_t capacity = 0;
+    
+    enum lxt_error error = LXT_ERROR_NONE;
+    
+    while (!feof(file) && !ferror(file)) {
+        if (image->image_length == capacity) {
+            capacity = capacity == 0 ? 4096 : capacity * 2;
+            
+            // memory from malloc is aligned for any structure
+            char * const data = realloc(image->image, capacity);
+            
+            if (data == NULL) {
+                error = LXT_ERROR_OUT_OF_MEMORY;
+                
+                break;
+            }
+            
+            image->image = data;
+        }
+        
+        image->image_length += fread((char *)image->image +
+                                     image->image_length, 1,
+                                     capacity - image->image_length, file);
+    }
+    
+    if (error == LXT_ERROR_NONE && ferror(file)) {
+        error = LXT_ERROR_READ_FAILED;
+    }
+    
+    fclose(file);
+    
+    if (error != LXT_ERROR_NONE) {
+        lxt_release_image(image);
+    }
+    
+    return error;
+}
+
+static
+int32_t
+lxt_image_write(struct lxt_sink const * const sink,
+                void const * const data,
+                size_t const length)
+{
+    static char const padding[8] = { 0 };
+    
+    if (length > 0 && sink->write(sink->context, data, length) != 0) {
+        return -1;
+    }
+    
+    size_t const padded_length = lxt_arena_size(length) - length;
+    
+    if (padded_length > 0 &&
+        sink->write(sink->context, padding, padded_length) != 0) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+static
+void const *
+lxt_image_section(void const * const image,
+                  size_t const length,
+                  uint64_t const offset,
+                  uint64_t const count,
+                  size_t const size)
+{
+    if ((offset & 7) != 0 || offset > length) {
+        return NULL;
+    }
+    
+    if (count > (length - offset) / size) {
+        return NULL;
+    }
+    
+    return (char const *)image + offset;
+}
+
+static
+bool
+lxt_image_validates(struct lxt_template const * const template,
+                    uint64_t const pattern_length)
+{
+    for (uint32_t i = 0; i < template->container_count; i++) {
+        struct lxt_container const * const container =
+            &template->containers[i];
+        
+        if (!lxt_span_validates(container->entry, pattern_length) ||
+            container->entry_index > template->entry_count ||
+            container->entry_count >
+                template->entry_count - container->entry_index) {
+            return false;
+        }
+        
+        if (container->weight_total != 0 &&
+            !lxt_weights_validate(template, container->weight_index,
+                                  container->entry_count,
+                                  container->weight_total)) {
+            return false;
+        }
+    }
+    
+    if (template->generator_weight_total != 0 &&
+        !lxt_weights_validate(template, 0, template->generator_count,
+                              template->generator_weight_total)) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < template->generator_count; i++) {
+        struct lxt_generator const * const generator =
+            &template->generators[i];
+        
+        if (!lxt_span_validates(generator->entry, pattern_length) ||
+            !lxt_span_validates(generator->sequence, pattern_length) ||
+            generator->op_index > template->op_count ||
+            generator->op_count > template->op_count - generator->op_index) {
+            return false;
+        }
+    }
+    
+    for (uint32_t i = 0; i < template->entry_count; i++) {
+        if (!lxt_span_validates(template->entries[i], pattern_length)) {
+            return false;
+        }
+    }
+    
+    for (uint32_t i = 0; i < template->op_count; i++) {
+        struct lxt_op const * const op = &template->ops[i];
+        
+        bool valid = false;
+        
+        switch (op->kind) {
+            case LXT_OP_TEXT:
+                // every folded pick draws another random number
+                valid = op->index <= MAX_PICKS &&
+                    lxt_text_validates(op->text, template, pattern_length);
+                break;
+            
+            case LXT_OP_ENTRY:
+                valid = op->index == 0 &&
+                    lxt_text_validates(op->text, template, pattern_length);
+                break;
+            
+            case LXT_OP_CONTAINER:
+                valid = op->index < template->container_count;
+                break;
+            
+            case LXT_OP_GENERATOR:
+            case LXT_OP_RECURSION:
+                valid = op->index < template->generator_count;
+                break;
+            
+            case LXT_OP_INLINE: {
+                if (op->index >= template->generator_count) {
+                    break;
+                }
+                
+                // the inlined operation is validated on its own
+                struct lxt_generator const * const inlined =
+                    &template->generators[op->index];
+                
+                valid = inlined->op_count == 1 &&
+                    (template->ops[inlined->op_index].kind == LXT_OP_TEXT ||
+                     template->ops[inlined->op_index].kind == LXT_OP_ENTRY);
+            } break;
+            
+            default:
+                // variables are always linked in a compiled template
+                break;
+        }
+        
+        if (!valid) {
+            return false;
+        }
+    }
+    
+    return lxt_symbols_validate(template->container_symbols,
+                                template->container_symbols.mask + 1,
+                                template->container_count,
+                                pattern_length) &&
+           lxt_symbols_validate(template->generator_symbols,
+                                template->generator_symbols.mask + 1,
+                                template->generator_count,
+                                pattern_length);
+}
+
+static
+enum lxt_error
+lxt_generators_validate(struct lxt_template const * const template)
+{
+    struct lxt_frame {
+        uint32_t generator;
+        uint32_t op;
+    };
+    
+    enum {
+        UNVISITED = 0,
+        RESOLVING,
+        RESOLVED
+    };
+    
+    uint32_t const count = template->generator_count;
+    
+    if (count == 0) {
+        return LXT_ERROR_NONE;
+    }
+    
+    struct lxt_frame * const stack = calloc(count, sizeof(struct lxt_frame));
+    uint8_t * const states = calloc(count, sizeof(uint8_t));
+    bool * const recursive = calloc(count, sizeof(bool));
+    
+    if (stack == NULL || states == NULL || recursive == NULL) {
+        free(stack);
+        free(states);
+        free(recursive);
+        
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    enum lxt_error error = LXT_ERROR_NONE;
+    
+    for (uint32_t root = 0; root < count; root++) {
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+        
+        if (states[root] != UNVISITED) {
+            continue;
+        }
+        
+        uint32_t depth = 0;
+        
+        stack[depth++] = (struct lxt_frame) { .generator = root, .op = 0 };
+        states[root] = RESOLVING;
+        
+        while (depth > 0) {
+            struct lxt_frame * const frame = &stack[depth - 1];
+            struct lxt_generator const * const generator =
+                &template->generators[frame->generator];
+            
+            if (frame->op == generator->op_count) {
+                if (recursive[frame->generator] &&
+                    generator->combinations != 0) {
+                    // combinations are resolved without checking for
+                    // recursion, and only count generators that have none
+                    error = LXT_ERROR_INVALID_IMAGE;
+                    
+                    break;
+                }
+                
+                states[frame->generator] = RESOLVED;
+                
+                depth -= 1;
+                
+                if (depth > 0) {
+                    recursive[stack[depth - 1].generator] |=
+                        recursive[frame->generator];
+                }
+                
+                continue;
+            }
+            
+            struct lxt_op const * const op =
+                &template->ops[generator->op_index + frame->op];
+            
+            frame->op += 1;
+            
+            if (op->kind == LXT_OP_RECURSION) {
+                recursive[frame->generator] = true;
+                
+                continue;
+            }
+            
+            if (op->kind != LXT_OP_GENERATOR && op->kind != LXT_OP_INLINE) {
+                continue;
+            }
+            
+            if (states[op->index] == RESOLVING) {
+                // would resolve forever, or as deep as allowed, growing
+                // exponentially
+                error = LXT_ERROR_INVALID_IMAGE;
+                
+                break;
+            }
+            
+            if (states[op->index] == RESOLVED) {
+                recursive[frame->generator] |= recursive[op->index];
+            } else {
+                // a generator can only be on the stack once
+                stack[depth++] = (struct lxt_frame) {
+                    .generator = op->index,
+                    .op = 0
+                };
+                
+                states[op->index] = RESOLVING;
+            }
+        }
+    }
+    
+    free(stack);
+    free(states);
+    free(recursive);
+    
+    return error;
+}
+
+static
+bool
+lxt_span_validates(struct lxt_span const span,
+                   uint64_t const pattern_length)
+{
+    return (span.offset & LXT_SPAN_LITERAL) == 0 &&
+        span.offset + (uint64_t)span.length <= pattern_length;
+}
+
+static
+bool
+lxt_text_validates(struct lxt_span const span,
+                   struct lxt_template const * const template,
+                   uint64_t const pattern_length)
+{
+    if ((span.offset & LXT_SPAN_LITERAL) == 0) {
+        return lxt_span_validates(span, pattern_length);
+    }
+    
+    return (span.offset & ~LXT_SPAN_LITERAL) + (uint64_t)span.length <=
+        template->literal_length;
+}
+
+static
+bool
+lxt_weights_validate(struct lxt_template const * const template,
+                     uint32_t const index,
+                     uint32_t const count,
+                     uint32_t const total)
+{
+    if (count == 0 || index > template->weight_count ||
+        count > template->weight_count - index) {
+        return false;
+    }
+    
+    struct lxt_weight const * const weights = &template->weights[index];
+    
+    uint32_t cumulative = 0;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        // cumulative weights must strictly increase up to the total, or
+        // picking by cumulative weight could run past the last choice
+        if (weights[i].cumulative <= cumulative ||
+            weights[i].alias >= count) {
+            return false;
+        }
+        
+        cumulative = weights[i].cumulative;
+    }
+    
+    return cumulative == total;
+}
+
+static
+bool
+lxt_symbols_validate(struct lxt_symbols const symbols,
+                     uint32_t const capacity,
+                     uint32_t const count,
+                     uint64_t const pattern_length)
+{
+    uint32_t used = 0;
+    
+    for (uint32_t i = 0; i < capacity; i++) {
+        struct lxt_symbol const * const symbol = &symbols.slots[i];
+        
+        if (symbol->index == SYMBOL_NONE) {
+            continue;
+        }
+        
+        if (symbol->index >= count ||
+            !lxt_span_validates(symbol->name, pattern_length)) {
+            return false;
+        }
+        
+        used += 1;
+    }
+    
+    // at least one slot must be unused, or probing for a missing symbol
+    // would never terminate
+    return used < capacity;
+}
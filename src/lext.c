@@ -1,21 +1,28 @@
-#include <lext/lext.h> // lxt_opts, lxt_gen
+#include <lext/lext.h> // lxt_opts, lxt_error, lxt_batch, lxt_gen, lxt_*
 
-#include "template.h" // lxt_template, lxt_container, lxt_generator
+#include "template.h" // lxt_template, lxt_builder, lxt_container, lxt_*
 #include "token.h" // lxt_token, lxt_kind, lxt_token_*
 #include "cursor.h" // lxt_cursor, lxt_cursor_*
-#include "rand.h" // lxt_rand32
+#include "rand.h" // lxt_rand_next, lxt_permutation, lxt_permute
+#include "scan.h" // lxt_scan, lxt_class, lxt_class_is
+#include "batch.h" // lxt_gen_batch_split
 
-#include <string.h> // memset
+#include <stdlib.h> // malloc, realloc, free
+#include <string.h> // memset, memcpy, memcmp, memchr, strlen
 #include <stddef.h> // size_t, NULL
 #include <stdint.h> // int32_t, uint32_t
+#include <stdbool.h> // bool
 
-extern inline uint32_t lxt_rand32(uint32_t * seed);
 
 /**
- * Parse a LEXT pattern into a template.
+ * Parse a LEXT pattern into a template builder.
+ *
+ * Directives are skipped unless directives is set.
  */
-static int32_t lxt_parse(struct lxt_template *,
-                         char const * pattern);
+static int32_t lxt_parse(struct lxt_builder *,
+                         char const * pattern,
+                         char const * end,
+                         bool directives);
 /**
  * Parse the current token and return a pointer to the next.
  *
@@ -35,16 +42,17 @@ static int32_t lxt_parse(struct lxt_template *,
  */
 static char const * lxt_parse_token(struct lxt_token *,
                                     enum lxt_kind *,
-                                    char const * pattern);
+                                    char const * pattern,
+                                    char const * end);
 /**
  * Parse the current sequence token and return a pointer to the next.
  *
  * Unlike `lxt_parse_token`, this function reads bytes and implicitly consider
- * each byte read a text token.
+ * all bytes read a text token.
  *
  * This is the case until a variable keyword character is encountered (or
  * end of sequence), at which point any following bytes read, until reaching a
- * whitespace character, are considered part of a variable token.
+ * non-identifier character, are considered part of a variable token.
  */
 static char const * lxt_parse_sequence(struct lxt_token *,
                                        enum lxt_kind *,
@@ -57,339 +65,1687 @@ static char const * lxt_parse_sequence(struct lxt_token *,
  */
 static char const * lxt_read_token(struct lxt_token * token,
                                    enum lxt_kind kind,
-                                   char const * pattern);
+                                   char const * pattern,
+                                   char const * end);
 /**
- * Read bytes from the start of a token up to, but not including, any specified
- * delimiting character.
+ * Read bytes from the start of a token up to, but not including, any
+ * delimiting character of the specified class.
  */
 static char const * lxt_read_up_to(struct lxt_token *,
-                                   char const delimiters[],
-                                   size_t delimiter_count);
+                                   char const * end,
+                                   enum lxt_class delimiters);
+
+/**
+ * Determine whether a comment is a given directive, and if so, get the name
+ * that follows it.
+ *
+ * A directive is written as `#import` followed by whitespace and the name
+ * of the imported module, or `#lines` followed by whitespace and the name
+ * of a lines file of the library; for example, `#import names`.
+ */
+static bool lxt_parse_directive(struct lxt_token * name,
+                                struct lxt_token comment,
+                                char const * directive);
+/**
+ * Add the module imported, or the container declared, by a directive to a
+ * builder; comments that are not directives are ignored.
+ */
+static int32_t lxt_process_directive(struct lxt_builder *,
+                                     struct lxt_token comment);
 
-static int32_t lxt_process_token(struct lxt_template *,
+/**
+ * Add a parsed token to a builder.
+ *
+ * The weight only applies to container entries and generators.
+ */
+static int32_t lxt_process_token(struct lxt_builder *,
                                  struct lxt_token,
-                                 enum lxt_kind);
+                                 enum lxt_kind,
+                                 uint32_t weight);
+
+/**
+ * Compile the sequence of a generator into operations.
+ */
+static int32_t lxt_compile_sequence(struct lxt_builder *,
+                                    size_t generator_index);
+/**
+ * Build, and optimize, a template from a builder whose sequences are
+ * compiled.
+ */
+static enum lxt_error lxt_compile_builder(struct lxt_template **,
+                                          struct lxt_builder *);
+
+/**
+ * Represents a container or generator found by indexing a pattern.
+ *
+ * The definition spans from its name up to the next definition, covering
+ * every entry or sequence that belongs to it.
+ */
+struct lxt_definition {
+    struct lxt_token name;
+    char const * start;
+    char const * end;
+    uint32_t hash;
+    enum lxt_kind kind;
+    bool reached;
+};
+
+#define DEFINITION_NONE (UINT32_MAX)
+
+/**
+ * Represents the definitions of a pattern, by name.
+ *
+ * Only the first definition of each name and kind can be found, exactly
+ * like the symbols of a template.
+ */
+struct lxt_index {
+    struct lxt_list definitions;
+    /**
+     * An open-addressed hash table of definitions; each slot holds the
+     * index of a definition plus one, or 0 if unused.
+     */
+    uint32_t * slots;
+    uint32_t mask;
+    /**
+     * Whether the pattern has entries or sequences that do not belong to
+     * the definition they are in, or directives that are invalid.
+     *
+     * Such patterns are always parsed in whole.
+     */
+    bool irregular;
+};
+
+/**
+ * Index the definitions of a pattern, adding any directives to a builder.
+ *
+ * Nothing but the names of definitions is parsed; entries and sequences are
+ * only skipped over.
+ */
+static int32_t lxt_index_pattern(struct lxt_index *,
+                                 struct lxt_builder *,
+                                 char const * pattern,
+                                 char const * end);
+/**
+ * Find the first definition of a name and kind.
+ *
+ * Returns DEFINITION_NONE if there is none.
+ */
+static uint32_t lxt_index_find(struct lxt_index const *,
+                               struct lxt_token name,
+                               uint32_t hash,
+                               enum lxt_kind);
+static void lxt_index_free(struct lxt_index *);
+/**
+ * Parse and compile the generator of a definition, along with every
+ * definition that it uses, directly or through other generators.
+ */
+static int32_t lxt_parse_reachable(struct lxt_builder *,
+                                   struct lxt_index *,
+                                   uint32_t definition);
+
+// the size of the block that results are buffered in before being
+// written to a sink
+#define BLOCK_SIZE (4096)
+// the largest capacity that a batch is sized to up front, in bytes
+#define MAX_ESTIMATE (64 * 1024 * 1024)
+
+// the number of frames that generators are resolved in before the stack
+// of frames is moved to the heap
+#define FRAME_COUNT (256)
+
+/**
+ * Represents a generator that is being resolved.
+ */
+struct lxt_frame {
+    struct lxt_generator const * generator;
+    /**
+     * Index of the next operation of the generator to run.
+     */
+    uint32_t op;
+};
+
+/**
+ * Represents the working memory that results are generated with.
+ *
+ * A context keeps its scratch between calls, such that it is set up, and
+ * grown, only once; other calls set up scratch on the stack for each call.
+ */
+struct lxt_scratch {
+    /**
+     * The stack of frames that generators are resolved in.
+     */
+    struct lxt_frame * frames;
+    uint32_t frame_count;
+    /**
+     * Whether the frames were moved to the heap, rather than given.
+     */
+    bool frames_allocated;
+    /**
+     * The block that results are buffered in before being written to a
+     * sink; BLOCK_SIZE bytes.
+     */
+    char * block;
+};
+
+// the size of a cache line on most processors
+#define CACHE_LINE (64)
+
+/**
+ * Represents the state of generating results on a single thread.
+ *
+ * The state is padded by a cache line in front, and by its block behind,
+ * such that contexts of different threads never share a cache line.
+ */
+struct lxt_ctx {
+    char padding[CACHE_LINE];
+    struct lxt_rng rng;
+    struct lxt_scratch scratch;
+    struct lxt_frame frames[FRAME_COUNT];
+    char block[BLOCK_SIZE];
+};
+
+/**
+ * Represents the state of a sink that appends to the last result of a batch.
+ */
+struct lxt_batch_writer {
+    struct lxt_batch * batch;
+    /**
+     * The number of bytes written to the result so far.
+     */
+    size_t length;
+    enum lxt_error error;
+};
+
+/**
+ * Represents a specific combination of entries of a generator.
+ *
+ * The index of a combination is a mixed-radix number, where each digit picks
+ * an entry of a container in the order that containers are resolved.
+ */
+struct lxt_combination {
+    struct lxt_generator const * generator;
+    uint64_t index;
+};
+
+/**
+ * Generate a result and append it to a batch.
+ *
+ * The offsets of the batch must have room for one more result. If a
+ * combination is given, the result is that combination rather than random.
+ */
+static enum lxt_error lxt_batch_append(struct lxt_batch *,
+                                       struct lxt_template const *,
+                                       struct lxt_opts const *,
+                                       struct lxt_rng *,
+                                       struct lxt_combination const *,
+                                       struct lxt_scratch *);
+/**
+ * Append data to the last result of a batch, growing the batch as needed.
+ */
+static int32_t lxt_batch_write(void * writer,
+                               char const * data,
+                               size_t length);
+
+/**
+ * Estimate the capacity that a batch needs for a number of more results.
+ *
+ * If the results are bounded, and all of them fit within a reasonable size,
+ * the estimate is exact; otherwise it is a lower bound.
+ */
+static size_t lxt_batch_estimate(struct lxt_batch const *,
+                                 size_t count,
+                                 struct lxt_template const *,
+                                 struct lxt_opts);
+
+/**
+ * Initialize scratch using memory of a caller; FRAME_COUNT frames and a
+ * block of BLOCK_SIZE bytes.
+ */
+static void lxt_scratch_init(struct lxt_scratch *,
+                             struct lxt_frame * frames,
+                             char * block);
+/**
+ * Release any memory that scratch has moved to the heap.
+ */
+static void lxt_scratch_release(struct lxt_scratch *);
+/**
+ * Generate a random result into a sink using scratch.
+ */
+static enum lxt_error lxt_gen_scratch(struct lxt_scratch *,
+                                      struct lxt_sink const *,
+                                      struct lxt_template const *,
+                                      struct lxt_opts const *,
+                                      struct lxt_rng *);
+
+/**
+ * Get the random number generator to use for a set of options.
+ *
+ * If the options specify neither a generator nor a seed, the fallback is
+ * initialized with a default seed and used instead. If the options only
+ * specify a seed, the fallback is initialized as a compatible xorshift32
+ * generator from that seed.
+ */
+static struct lxt_rng * lxt_opts_rng(struct lxt_rng * fallback,
+                                     struct lxt_opts const *);
+/**
+ * Write the state of a fallback generator back to the seed of the options.
+ */
+static void lxt_opts_rng_return(struct lxt_rng const * fallback,
+                                struct lxt_opts const *);
+
+/**
+ * Generate a random result into a cursor.
+ *
+ * The random number generator of the options is ignored in favor of the
+ * given generator. If a combination is given, the result is that
+ * combination instead, and neither the options nor the generator are used.
+ */
+static enum lxt_error lxt_generate(struct lxt_cursor *,
+                                   struct lxt_template const *,
+                                   struct lxt_opts const *,
+                                   struct lxt_rng *,
+                                   struct lxt_combination const *,
+                                   struct lxt_scratch *);
 
-static int32_t lxt_resolve_generator(struct lxt_cursor *,
-                                     struct lxt_generator const *,
-                                     struct lxt_template const *);
-static int32_t lxt_resolve_variable(struct lxt_cursor *,
-                                    struct lxt_token,
-                                    struct lxt_template const *);
+/**
+ * Resolve a generator into a cursor.
+ *
+ * Generators are resolved using an explicit stack of frames rather than
+ * by recursion, such that deeply nested generators can not overflow the
+ * call stack. Generators beyond the maximum depth are skipped, as are
+ * recursion operations of generators that are already being resolved.
+ *
+ * The frames of the scratch are grown as needed, and kept grown.
+ */
+static enum lxt_error lxt_resolve_generator(struct lxt_cursor *,
+                                            struct lxt_generator const *,
+                                            struct lxt_template const *,
+                                            uint32_t max_depth,
+                                            struct lxt_rng *,
+                                            uint64_t * combination,
+                                            struct lxt_scratch *);
+/**
+ * Resolve a container into a cursor.
+ *
+ * If a combination is given, the entry is picked by its lowest digit,
+ * which is then removed; otherwise the entry is picked at random.
+ */
+static int32_t lxt_resolve_container(struct lxt_cursor *,
+                                     struct lxt_container const *,
+                                     struct lxt_template const *,
+                                     struct lxt_rng *,
+                                     uint64_t * combination);
 
 struct lxt_opts const LXT_OPTS_NONE = {
     .generator = NULL,
-    .seed = NULL
+    .seed = NULL,
+    .rng = NULL,
+    .max_depth = 0
+};
+
+struct lxt_batch const LXT_BATCH_EMPTY = {
+    .data = NULL,
+    .offsets = NULL,
+    .count = 0,
+    .capacity = 0,
+    .max_count = 0
 };
 
 enum lxt_error
-lxt_gen(char * const buffer,
-        size_t const length,
-        char const * const pattern,
-        struct lxt_opts options)
+lxt_compile(struct lxt_template ** const template,
+            char const * const pattern)
+{
+    return lxt_compile_length(template, pattern, strlen(pattern));
+}
+
+enum lxt_error
+lxt_compile_length(struct lxt_template ** const template,
+                   char const * const pattern,
+                   size_t const length)
+{
+    return lxt_compile_library(template, pattern, length, NULL);
+}
+
+enum lxt_error
+lxt_compile_library(struct lxt_template ** const template,
+                    char const * const pattern,
+                    size_t const length,
+                    struct lxt_library * const library)
 {
-    struct lxt_template template;
+    *template = NULL;
     
-    memset(&template, 0, sizeof(template));
+    struct lxt_builder builder;
     
-    if (lxt_parse(&template, pattern) != 0) {
-        return LXT_ERROR_INVALID_TEMPLATE;
-    }
+    memset(&builder, 0, sizeof(builder));
     
-    uint32_t default_seed = 2147483647;
+    builder.pattern = pattern;
+    builder.library = library;
     
-    template.seed = &default_seed;
+    enum lxt_error error = LXT_ERROR_NONE;
     
-    if (options.seed != NULL) {
-        template.seed = options.seed;
+    if (lxt_parse(&builder, pattern, pattern + length, true) != 0) {
+        error = LXT_ERROR_INVALID_TEMPLATE;
     }
     
-    struct lxt_generator const * generator = NULL;
+    for (size_t i = 0; i < builder.generators.count; i++) {
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+        
+        if (lxt_compile_sequence(&builder, i) != 0) {
+            error = LXT_ERROR_INVALID_TEMPLATE;
+        }
+    }
     
-    lxt_get_generator(&generator, &template, options.generator);
+    if (error == LXT_ERROR_NONE) {
+        error = lxt_compile_builder(template, &builder);
+    }
+    
+    lxt_builder_free(&builder);
+    
+    return error;
+}
+
+enum lxt_error
+lxt_compile_generator(struct lxt_template ** const template,
+                      char const * const pattern,
+                      size_t const length,
+                      struct lxt_library * const library,
+                      char const * const generator)
+{
+    *template = NULL;
     
     if (generator == NULL) {
         return LXT_ERROR_GENERATOR_NOT_FOUND;
     }
     
-    struct lxt_cursor cursor;
+    struct lxt_builder builder;
+    struct lxt_index index;
     
-    cursor.buffer = buffer;
-    cursor.length = length - 1; // leave 1 byte for the null-terminator
-    cursor.offset = 0;
+    memset(&builder, 0, sizeof(builder));
+    memset(&index, 0, sizeof(index));
     
-    if (lxt_resolve_generator(&cursor, generator, &template) != 0) {
-        // something went wrong
+    builder.pattern = pattern;
+    builder.library = library;
+    
+    if (lxt_index_pattern(&index, &builder, pattern,
+                          pattern + length) != 0) {
+        lxt_index_free(&index);
+        lxt_builder_free(&builder);
+        
+        return LXT_ERROR_OUT_OF_MEMORY;
     }
     
-    // null-terminate the resulting buffer
-    memset(buffer + cursor.offset, '\0', 1);
+    struct lxt_token name;
     
-    return LXT_ERROR_NONE;
-}
-
-static
-int32_t
-lxt_parse(struct lxt_template * const template,
-          char const * pattern)
-{
-    while (*pattern) {
-        struct lxt_token token;
-        enum lxt_kind kind;
-
-        pattern = lxt_parse_token(&token, &kind, pattern);
-        
-        if (kind != LXT_KIND_NONE &&
-            kind != LXT_KIND_COMMENT) {
-            lxt_token_trim(&token);
-        }
-        
-        if (token.length == 0) {
-            continue;
-        }
-        
-        if (!lxt_token_validates(token, kind)) {
-            return -1;
-        }
+    name.start = generator;
+    name.length = strlen(generator);
+    
+    uint32_t const definition =
+        lxt_index_find(&index, name, lxt_token_hash(name),
+                       LXT_KIND_GENERATOR);
+    
+    if (index.irregular || definition == DEFINITION_NONE) {
+        // generating would pick from every generator, or the pattern can
+        // not be told apart by definition; parse all of it
+        lxt_index_free(&index);
+        lxt_builder_free(&builder);
         
-        if (lxt_process_token(template, token, kind) != 0) {
-            return -1;
-        }
+        return lxt_compile_library(template, pattern, length, library);
     }
     
-    return 0;
-}
-
-static
-char const *
-lxt_read_up_to(struct lxt_token * const token,
-               char const delimiters[],
-               size_t const delimiter_count)
-{
-    char const * p = token->start;
+    enum lxt_error error = LXT_ERROR_NONE;
     
-    while (*p) {
-        char const c = *p;
-        
-        for (size_t i = 0; i < delimiter_count; i++) {
-            char const delimiter = delimiters[i];
-            
-            if (c == delimiter) {
-                return p;
-            }
-        }
-        
-        token->length += 1;
-        
-        p++;
+    if (lxt_parse_reachable(&builder, &index, definition) != 0) {
+        error = LXT_ERROR_INVALID_TEMPLATE;
     }
     
-    return p;
+    lxt_index_free(&index);
+    
+    if (error == LXT_ERROR_NONE) {
+        error = lxt_compile_builder(template, &builder);
+    }
+    
+    lxt_builder_free(&builder);
+    
+    return error;
 }
 
-static
-char const *
-lxt_read_token(struct lxt_token * const token,
-               enum lxt_kind const kind,
-               char const * pattern)
+void
+lxt_free(struct lxt_template * const template)
 {
-    switch (kind) {
-        case LXT_KIND_COMMENT: {
-            token->start = pattern;
-            
-            char delimiters[1] = { '\n' };
-            
-            return lxt_read_up_to(token, delimiters, 1);
-        }
-            
-        case LXT_KIND_CONTAINER_ENTRY: {
-            token->start = pattern + 1;
-            
-            char delimiters[2] = { ')', ',' };
-            
-            return lxt_read_up_to(token, delimiters, 2);
-        }
-            
-        case LXT_KIND_SEQUENCE: {
-            token->start = pattern + 1;
-            
-            char delimiters[1] = { '>' };
-            
-            return lxt_read_up_to(token, delimiters, 1);
-        }
-            
-        case LXT_KIND_NONE: {
-            token->start = pattern;
-            token->length += 1;
-            
-            return pattern + token->length;
+    if (template == NULL) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < template->import_count; i++) {
+        if (template->imports[i].owned) {
+            // containers copied from files belong to the template
+            lxt_free((struct lxt_template *)template->imports[i].template);
         }
-            
-        case LXT_KIND_CONTAINER:
-        case LXT_KIND_GENERATOR:
-        case LXT_KIND_VARIABLE:
-        case LXT_KIND_TEXT:
-            /* fall through */
-            break;
     }
     
-    return NULL;
+    lxt_release_image(template);
+    
+    free(template);
 }
 
-static
-char const *
-lxt_parse_token(struct lxt_token * const token,
-                enum lxt_kind * const kind,
-                char const * pattern)
+enum lxt_error
+lxt_measure(struct lxt_bounds * const bounds,
+            struct lxt_template const * const template,
+            char const * const name)
 {
-    *kind = LXT_KIND_NONE;
-
-    token->start = NULL;
-    token->length = 0;
+    bounds->min = 0;
+    bounds->max = 0;
     
-    if (lxt_token_starts(kind, pattern)) {
-        return lxt_read_token(token, *kind, pattern);
+    if (template->generator_count == 0) {
+        return LXT_ERROR_GENERATOR_NOT_FOUND;
     }
     
-    token->start = pattern;
+    struct lxt_generator const * generator = NULL;
     
-    while (*pattern) {
-        token->length += 1;
+    if (name != NULL) {
+        struct lxt_token token;
         
-        if (lxt_token_ends(kind, pattern)) {
-            return pattern + 1;
-        }
+        token.start = name;
+        token.length = strlen(name);
         
-        pattern++;
+        lxt_find_generator(&generator, token, lxt_token_hash(token),
+                           template);
     }
     
-    return pattern;
-}
-
-static
-char const *
-lxt_parse_sequence(struct lxt_token * const token,
-                   enum lxt_kind * const kind,
-                   char const * sequence,
-                   char const * const end)
-{
-    *kind = LXT_KIND_NONE;
+    if (generator != NULL) {
+        bounds->min = generator->min_length;
+        bounds->max = generator->max_length;
+        
+        return LXT_ERROR_NONE;
+    }
     
-    token->length = 0;
-    token->start = NULL;
+    // any generator could be picked
+    bounds->min = LXT_LENGTH_UNBOUNDED;
     
-    while (*sequence && sequence != end) {
-        if (token->start == NULL && *sequence == VARIABLE_CHARACTER) {
-            // skip this character
-            sequence++;
-            
-            // begin parsing variable
-            token->start = sequence;
-            
-            *kind = LXT_KIND_VARIABLE;
-        }
+    for (uint32_t i = 0; i < template->generator_count; i++) {
+        struct lxt_generator const * const other = &template->generators[i];
         
-        if (token->start != NULL && !lxt_token_character(*sequence)) {
-            // end parsing variable
-            return sequence;
+        if (other->min_length < bounds->min) {
+            bounds->min = other->min_length;
         }
         
-        token->length += 1;
-        
-        if (token->start == NULL) {
-            // parse as a chunk of text
-            token->start = sequence;
-            
-            *kind = LXT_KIND_TEXT;
-            
-            return sequence + 1;
+        if (other->max_length > bounds->max) {
+            bounds->max = other->max_length;
         }
-        
-        sequence++;
     }
     
-    return sequence;
+    return LXT_ERROR_NONE;
 }
 
-static
-int32_t
-lxt_process_token(struct lxt_template * const template,
-                  struct lxt_token token,
-                  enum lxt_kind const kind)
+uint32_t
+lxt_generator_count(struct lxt_template const * const template)
 {
-    switch (kind) {
-        case LXT_KIND_CONTAINER: {
-            if (lxt_append_container(template, token) != 0) {
-                return -1;
+    return template->generator_count;
+}
+
+enum lxt_error
+lxt_generator_at(struct lxt_generator_info * const info,
+                 struct lxt_template const * const template,
+                 uint32_t const index)
+{
+    if (index >= template->generator_count) {
+        return LXT_ERROR_GENERATOR_NOT_FOUND;
+    }
+    
+    struct lxt_generator const * const generator =
+        &template->generators[index];
+    
+    struct lxt_token const name = lxt_get_token(template, generator->entry);
+    
+    info->name = name.start;
+    info->name_length = name.length;
+    info->bounds.min = generator->min_length;
+    info->bounds.max = generator->max_length;
+    info->combinations = generator->combinations;
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_gen_compiled(char * const buffer,
+                 size_t const length,
+                 struct lxt_template const * const template,
+                 struct lxt_opts options)
+{
+    struct lxt_rng fallback;
+    struct lxt_rng * const rng = lxt_opts_rng(&fallback, &options);
+    
+    struct lxt_frame frames[FRAME_COUNT];
+    struct lxt_scratch scratch;
+    
+    // the block is only used for sinks; the buffer is written directly
+    lxt_scratch_init(&scratch, frames, NULL);
+    
+    struct lxt_cursor cursor;
+    
+    // leave 1 byte for the null-terminator
+    lxt_cursor_init(&cursor, buffer, length - 1, NULL);
+    
+    enum lxt_error const error = lxt_generate(&cursor, template,
+                                              &options,
+                                              rng, NULL, &scratch);
+    
+    lxt_scratch_release(&scratch);
+    lxt_opts_rng_return(&fallback, &options);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    // null-terminate the resulting buffer
+    memset(buffer + cursor.offset, '\0', 1);
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_gen_at(char * const buffer,
+           size_t const length,
+           uint64_t const index,
+           struct lxt_template const * const template,
+           struct lxt_opts options)
+{
+    uint64_t count = 0;
+    
+    enum lxt_error error = lxt_count(&count, template, options.generator);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    if (index >= count) {
+        return LXT_ERROR_OUT_OF_RANGE;
+    }
+    
+    struct lxt_combination combination;
+    
+    combination.generator = NULL;
+    combination.index = index;
+    
+    if (options.generator != NULL) {
+        struct lxt_token name;
+        
+        name.start = options.generator;
+        name.length = strlen(options.generator);
+        
+        lxt_find_generator(&combination.generator, name,
+                           lxt_token_hash(name), template);
+    } else {
+        // find the generator that the index belongs to
+        for (uint32_t i = 0; i < template->generator_count; i++) {
+            uint64_t const combinations =
+                template->generators[i].combinations;
+            
+            if (combination.index < combinations) {
+                combination.generator = &template->generators[i];
+                
+                break;
+            }
+            
+            combination.index -= combinations;
+        }
+    }
+    
+    struct lxt_frame frames[FRAME_COUNT];
+    struct lxt_scratch scratch;
+    
+    lxt_scratch_init(&scratch, frames, NULL);
+    
+    struct lxt_cursor cursor;
+    
+    // leave 1 byte for the null-terminator
+    lxt_cursor_init(&cursor, buffer, length - 1, NULL);
+    
+    error = lxt_generate(&cursor, template, &options, NULL, &combination,
+                         &scratch);
+    
+    lxt_scratch_release(&scratch);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    // null-terminate the resulting buffer
+    memset(buffer + cursor.offset, '\0', 1);
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_gen_sink(struct lxt_sink const * const sink,
+             struct lxt_template const * const template,
+             struct lxt_opts options)
+{
+    struct lxt_rng fallback;
+    struct lxt_rng * const rng = lxt_opts_rng(&fallback, &options);
+    
+    struct lxt_frame frames[FRAME_COUNT];
+    char block[BLOCK_SIZE];
+    
+    struct lxt_scratch scratch;
+    
+    lxt_scratch_init(&scratch, frames, block);
+    
+    enum lxt_error const error = lxt_gen_scratch(&scratch, sink, template,
+                                                 &options, rng);
+    
+    lxt_scratch_release(&scratch);
+    lxt_opts_rng_return(&fallback, &options);
+    
+    return error;
+}
+
+enum lxt_error
+lxt_gen_batch(struct lxt_batch * const batch,
+              size_t const count,
+              struct lxt_template const * const template,
+              struct lxt_opts options)
+{
+    struct lxt_rng fallback;
+    struct lxt_rng * const rng = lxt_opts_rng(&fallback, &options);
+    
+    enum lxt_error error = lxt_batch_reserve(batch, batch->count + count,
+                                             lxt_batch_estimate(batch, count,
+                                                                template,
+                                                                options));
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    struct lxt_frame frames[FRAME_COUNT];
+    char block[BLOCK_SIZE];
+    
+    struct lxt_scratch scratch;
+    
+    // every result of the batch is generated using the same scratch
+    lxt_scratch_init(&scratch, frames, block);
+    
+    for (size_t i = 0; i < count; i++) {
+        error = lxt_batch_append(batch, template, &options, rng, NULL,
+                                 &scratch);
+        
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+    }
+    
+    lxt_scratch_release(&scratch);
+    lxt_opts_rng_return(&fallback, &options);
+    
+    return error;
+}
+
+enum lxt_error
+lxt_gen_batch_split(struct lxt_batch * const batch,
+                    struct lxt_rng const * const rng,
+                    uint64_t const first,
+                    size_t const count,
+                    struct lxt_template const * const template,
+                    struct lxt_opts const options)
+{
+    enum lxt_error error = lxt_batch_reserve(batch, batch->count + count,
+                                             lxt_batch_estimate(batch, count,
+                                                                template,
+                                                                options));
+    
+    struct lxt_frame frames[FRAME_COUNT];
+    char block[BLOCK_SIZE];
+    
+    struct lxt_scratch scratch;
+    
+    lxt_scratch_init(&scratch, frames, block);
+    
+    for (size_t i = 0; i < count; i++) {
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+        
+        struct lxt_rng split;
+        
+        error = lxt_rng_split(&split, rng, first + i);
+        
+        if (error == LXT_ERROR_NONE) {
+            error = lxt_batch_append(batch, template, &options, &split,
+                                     NULL, &scratch);
+        }
+    }
+    
+    lxt_scratch_release(&scratch);
+    
+    return error;
+}
+
+enum lxt_error
+lxt_gen_unique(struct lxt_batch * const batch,
+               uint64_t const first,
+               size_t const count,
+               struct lxt_template const * const template,
+               struct lxt_opts options)
+{
+    if (template->generator_count == 0) {
+        return LXT_ERROR_GENERATOR_NOT_FOUND;
+    }
+    
+    struct lxt_rng fallback;
+    struct lxt_rng keys;
+    
+    enum lxt_error error =
+        lxt_rng_split(&keys, lxt_opts_rng(&fallback, &options), 0);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    struct lxt_generator const * generator = NULL;
+    
+    // the combinations of every generator, one after another, up to and
+    // including each generator; only when no generator is specified
+    uint64_t * ends = NULL;
+    
+    uint64_t total = 0;
+    
+    if (options.generator != NULL) {
+        struct lxt_token name;
+        
+        name.start = options.generator;
+        name.length = strlen(options.generator);
+        
+        if (!lxt_find_generator(&generator, name, lxt_token_hash(name),
+                                template)) {
+            return LXT_ERROR_GENERATOR_NOT_FOUND;
+        }
+        
+        total = generator->combinations;
+    } else {
+        ends = malloc(template->generator_count * sizeof(uint64_t));
+        
+        if (ends == NULL) {
+            return LXT_ERROR_OUT_OF_MEMORY;
+        }
+        
+        for (uint32_t i = 0; i < template->generator_count; i++) {
+            uint64_t const combinations =
+                template->generators[i].combinations;
+            
+            if (combinations == 0) {
+                total = 0;
+                
+                break;
+            }
+            
+            total = combinations > UINT64_MAX - total ?
+                UINT64_MAX : total + combinations;
+            
+            ends[i] = total;
+        }
+    }
+    
+    if (total == 0) {
+        // a recursive generator has no countable combinations
+        free(ends);
+        
+        return LXT_ERROR_UNSUPPORTED;
+    }
+    
+    size_t const remaining = first < total ?
+        (total - first < count ? (size_t)(total - first) : count) : 0;
+    
+    error = lxt_batch_reserve(batch, batch->count + remaining,
+                              lxt_batch_estimate(batch, remaining,
+                                                 template, options));
+    
+    struct lxt_permutation permutation;
+    
+    lxt_permutation_init(&permutation, total, &keys);
+    
+    struct lxt_frame frames[FRAME_COUNT];
+    char block[BLOCK_SIZE];
+    
+    struct lxt_scratch scratch;
+    
+    lxt_scratch_init(&scratch, frames, block);
+    
+    for (size_t i = 0; i < remaining; i++) {
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+        
+        struct lxt_combination combination;
+        
+        combination.generator = generator;
+        combination.index = lxt_permute(&permutation, first + i);
+        
+        if (generator == NULL) {
+            // find the generator that the combination belongs to
+            uint32_t low = 0;
+            uint32_t high = template->generator_count - 1;
+            
+            while (low < high) {
+                uint32_t const middle = low + (high - low) / 2;
+                
+                if (ends[middle] > combination.index) {
+                    high = middle;
+                } else {
+                    low = middle + 1;
+                }
+            }
+            
+            combination.generator = &template->generators[low];
+            
+            if (low > 0) {
+                combination.index -= ends[low - 1];
+            }
+        }
+        
+        error = lxt_batch_append(batch, template, &options, NULL,
+                                 &combination, &scratch);
+    }
+    
+    lxt_scratch_release(&scratch);
+    
+    free(ends);
+    
+    return error;
+}
+
+
+enum lxt_error
+lxt_batch_reserve(struct lxt_batch * const batch,
+                  size_t const count,
+                  size_t const capacity)
+{
+    if (batch->offsets == NULL || count > batch->max_count) {
+        size_t max_count = batch->max_count < 16 ? 16 : batch->max_count;
+        
+        while (max_count < count) {
+            max_count *= 2;
+        }
+        
+        int64_t * const offsets =
+            realloc(batch->offsets, (max_count + 1) * sizeof(int64_t));
+        
+        if (offsets == NULL) {
+            return LXT_ERROR_OUT_OF_MEMORY;
+        }
+        
+        if (batch->offsets == NULL) {
+            offsets[0] = 0;
+        }
+        
+        batch->offsets = offsets;
+        batch->max_count = max_count;
+    }
+    
+    if (capacity > batch->capacity) {
+        char * const data = realloc(batch->data, capacity);
+        
+        if (data == NULL) {
+            return LXT_ERROR_OUT_OF_MEMORY;
+        }
+        
+        batch->data = data;
+        batch->capacity = capacity;
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+void
+lxt_batch_clear(struct lxt_batch * const batch)
+{
+    batch->count = 0;
+}
+
+void
+lxt_batch_free(struct lxt_batch * const batch)
+{
+    free(batch->data);
+    free(batch->offsets);
+    
+    *batch = LXT_BATCH_EMPTY;
+}
+
+enum lxt_error
+lxt_ctx_create(struct lxt_ctx ** const ctx,
+               struct lxt_rng const * const rng)
+{
+    *ctx = malloc(sizeof(struct lxt_ctx));
+    
+    if (*ctx == NULL) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    if (rng != NULL) {
+        (*ctx)->rng = *rng;
+    } else {
+        lxt_rng_init(&(*ctx)->rng, LXT_RNG_DEFAULT_SEED, 0);
+    }
+    
+    lxt_scratch_init(&(*ctx)->scratch, (*ctx)->frames, (*ctx)->block);
+    
+    return LXT_ERROR_NONE;
+}
+
+void
+lxt_ctx_free(struct lxt_ctx * const ctx)
+{
+    if (ctx == NULL) {
+        return;
+    }
+    
+    lxt_scratch_release(&ctx->scratch);
+    
+    free(ctx);
+}
+
+struct lxt_rng *
+lxt_ctx_rng(struct lxt_ctx * const ctx)
+{
+    return &ctx->rng;
+}
+
+enum lxt_error
+lxt_gen_ctx(struct lxt_ctx * const ctx,
+            char * const buffer,
+            size_t const length,
+            struct lxt_template const * const template,
+            struct lxt_opts const options)
+{
+    struct lxt_cursor cursor;
+    
+    // leave 1 byte for the null-terminator
+    lxt_cursor_init(&cursor, buffer, length - 1, NULL);
+    
+    enum lxt_error const error = lxt_generate(&cursor, template, &options,
+                                              &ctx->rng, NULL,
+                                              &ctx->scratch);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    // null-terminate the resulting buffer
+    memset(buffer + cursor.offset, '\0', 1);
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_gen_sink_ctx(struct lxt_ctx * const ctx,
+                 struct lxt_sink const * const sink,
+                 struct lxt_template const * const template,
+                 struct lxt_opts const options)
+{
+    return lxt_gen_scratch(&ctx->scratch, sink, template, &options,
+                           &ctx->rng);
+}
+
+enum lxt_error
+lxt_gen_batch_ctx(struct lxt_ctx * const ctx,
+                  struct lxt_batch * const batch,
+                  size_t const count,
+                  struct lxt_template const * const template,
+                  struct lxt_opts const options)
+{
+    enum lxt_error error = lxt_batch_reserve(batch, batch->count + count,
+                                             lxt_batch_estimate(batch, count,
+                                                                template,
+                                                                options));
+    
+    for (size_t i = 0; i < count; i++) {
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+        
+        error = lxt_batch_append(batch, template, &options, &ctx->rng,
+                                 NULL, &ctx->scratch);
+    }
+    
+    return error;
+}
+
+enum lxt_error
+lxt_gen(char * const buffer,
+        size_t const length,
+        char const * const pattern,
+        struct lxt_opts options)
+{
+    struct lxt_template * template = NULL;
+    
+    enum lxt_error error = lxt_compile(&template, pattern);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    error = lxt_gen_compiled(buffer, length, template, options);
+    
+    lxt_free(template);
+    
+    return error;
+}
+
+static
+int32_t
+lxt_parse(struct lxt_builder * const builder,
+          char const * pattern,
+          char const * const end,
+          bool const directives)
+{
+    while (pattern < end) {
+        struct lxt_token token;
+        enum lxt_kind kind;
+        
+        pattern = lxt_parse_token(&token, &kind, pattern, end);
+        
+        if (kind != LXT_KIND_NONE &&
+            kind != LXT_KIND_COMMENT) {
+            lxt_token_trim(&token);
+        }
+        
+        uint32_t weight = 1;
+        
+        if ((kind == LXT_KIND_CONTAINER_ENTRY ||
+             kind == LXT_KIND_GENERATOR) &&
+            !lxt_token_weight(&token, &weight)) {
+            return -1;
+        }
+        
+        if (token.length == 0) {
+            continue;
+        }
+        
+        if (!lxt_token_validates(token, kind)) {
+            return -1;
+        }
+        
+        if (kind == LXT_KIND_COMMENT && !directives) {
+            continue;
+        }
+        
+        if (lxt_process_token(builder, token, kind, weight) != 0) {
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+static
+char const *
+lxt_read_up_to(struct lxt_token * const token,
+               char const * const end,
+               enum lxt_class const delimiters)
+{
+    char const * const p = lxt_scan(token->start, end, delimiters);
+    
+    token->length = (size_t)(p - token->start);
+    
+    return p;
+}
+
+static
+char const *
+lxt_read_token(struct lxt_token * const token,
+               enum lxt_kind const kind,
+               char const * pattern,
+               char const * const end)
+{
+    switch (kind) {
+        case LXT_KIND_COMMENT: {
+            token->start = pattern;
+            
+            return lxt_read_up_to(token, end, LXT_CLASS_COMMENT_END);
+        }
+            
+        case LXT_KIND_CONTAINER_ENTRY: {
+            token->start = pattern + 1;
+            
+            return lxt_read_up_to(token, end, LXT_CLASS_ENTRY_END);
+        }
+            
+        case LXT_KIND_SEQUENCE: {
+            token->start = pattern + 1;
+            
+            return lxt_read_up_to(token, end, LXT_CLASS_SEQUENCE_END);
+        }
+            
+        case LXT_KIND_NONE: {
+            token->start = pattern;
+            token->length += 1;
+            
+            return pattern + token->length;
+        }
+            
+        case LXT_KIND_CONTAINER:
+        case LXT_KIND_GENERATOR:
+        case LXT_KIND_VARIABLE:
+        case LXT_KIND_TEXT:
+            /* fall through */
+            break;
+    }
+    
+    return NULL;
+}
+
+static
+char const *
+lxt_parse_token(struct lxt_token * const token,
+                enum lxt_kind * const kind,
+                char const * pattern,
+                char const * const end)
+{
+    *kind = LXT_KIND_NONE;
+
+    token->start = NULL;
+    token->length = 0;
+    
+    if (lxt_token_starts(kind, pattern)) {
+        return lxt_read_token(token, *kind, pattern, end);
+    }
+    
+    token->start = pattern;
+    
+    // the token ends right before the next keyword character; the
+    // first character is never one, as no token starts here
+    char const * const next = lxt_scan(pattern + 1, end, LXT_CLASS_NAME_END);
+    
+    token->length = (size_t)(next - pattern);
+    
+    if (next < end) {
+        lxt_token_ends(kind, next - 1);
+    }
+    
+    return next;
+}
+
+static
+char const *
+lxt_parse_sequence(struct lxt_token * const token,
+                   enum lxt_kind * const kind,
+                   char const * sequence,
+                   char const * const end)
+{
+    *kind = LXT_KIND_NONE;
+    
+    token->length = 0;
+    token->start = NULL;
+    
+    if (sequence >= end) {
+        return end;
+    }
+    
+    if (*sequence == VARIABLE_CHARACTER) {
+        // skip this character
+        sequence++;
+        
+        // begin parsing variable
+        token->start = sequence;
+        
+        *kind = LXT_KIND_VARIABLE;
+        
+        while (sequence < end && lxt_token_character(*sequence)) {
+            token->length += 1;
+            
+            sequence++;
+        }
+        
+        // end parsing variable
+        return sequence;
+    }
+    
+    // parse as a chunk of text, up until the next variable
+    char const * const variable =
+        memchr(sequence, VARIABLE_CHARACTER, (size_t)(end - sequence));
+    
+    char const * const next = variable != NULL ? variable : end;
+    
+    token->start = sequence;
+    token->length = (size_t)(next - sequence);
+    
+    *kind = LXT_KIND_TEXT;
+    
+    return next;
+}
+
+static
+int32_t
+lxt_process_token(struct lxt_builder * const builder,
+                  struct lxt_token token,
+                  enum lxt_kind const kind,
+                  uint32_t const weight)
+{
+    switch (kind) {
+        case LXT_KIND_CONTAINER: {
+            if (lxt_append_container(builder, token) != 0) {
+                return -1;
             }
         } break;
             
         case LXT_KIND_CONTAINER_ENTRY: {
-            if (lxt_append_container_entry(template, token) != 0) {
+            if (lxt_append_container_entry(builder, token, weight) != 0) {
                 return -1;
             }
         } break;
             
         case LXT_KIND_GENERATOR: {
-            if (lxt_append_generator(template, token) != 0) {
+            if (lxt_append_generator(builder, token, weight) != 0) {
                 return -1;
             }
         } break;
             
-        case LXT_KIND_SEQUENCE: {
-            if (lxt_append_sequence(template, token) != 0) {
-                return -1;
-            }
-        } break;
+        case LXT_KIND_SEQUENCE: {
+            if (lxt_append_sequence(builder, token) != 0) {
+                return -1;
+            }
+        } break;
+        
+        case LXT_KIND_COMMENT: {
+            if (lxt_process_directive(builder, token) != 0) {
+                return -1;
+            }
+        } break;
+        
+        case LXT_KIND_VARIABLE:
+        case LXT_KIND_TEXT:
+        case LXT_KIND_NONE:
+            /* fall through */
+            break;
+    }
+    
+    return 0;
+}
+
+static
+bool
+lxt_parse_directive(struct lxt_token * const name,
+                    struct lxt_token const comment,
+                    char const * const directive)
+{
+    size_t const length = strlen(directive);
+    
+    if (comment.length <= length ||
+        memcmp(comment.start, directive, length) != 0 ||
+        !lxt_class_is(comment.start[length], LXT_CLASS_SPACE)) {
+        return false;
+    }
+    
+    name->start = comment.start + length;
+    name->length = comment.length - length;
+    
+    lxt_token_trim(name);
+    
+    return true;
+}
+
+static
+int32_t
+lxt_process_directive(struct lxt_builder * const builder,
+                      struct lxt_token const comment)
+{
+    struct lxt_token name;
+    
+    if (lxt_parse_directive(&name, comment, LINES_DIRECTIVE)) {
+        if (name.length == 0 ||
+            !lxt_token_validates(name, LXT_KIND_CONTAINER) ||
+            lxt_append_lines(builder, name) != 0) {
+            return -1;
+        }
+        
+        return 0;
+    }
+    
+    if (!lxt_parse_directive(&name, comment, IMPORT_DIRECTIVE)) {
+        // just a comment
+        return 0;
+    }
+    
+    if (name.length == 0 ||
+        !lxt_token_validates(name, LXT_KIND_CONTAINER) ||
+        lxt_append_import(builder, name) != 0) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+static
+int32_t
+lxt_compile_sequence(struct lxt_builder * const builder,
+                     size_t const generator_index)
+{
+    struct lxt_generator const * const gen =
+        (struct lxt_generator *)builder->generators.items + generator_index;
+    
+    struct lxt_token name;
+    
+    name.start = builder->pattern + gen->entry.offset;
+    name.length = gen->entry.length;
+    
+    char const * next = builder->pattern + gen->sequence.offset;
+    char const * const end = next + gen->sequence.length;
+    
+    while (next < end) {
+        struct lxt_token token;
+        enum lxt_kind kind;
+        
+        next = lxt_parse_sequence(&token, &kind, next, end);
+        
+        if (kind == LXT_KIND_NONE) {
+            continue;
+        }
+        
+        if (token.length == 0) {
+            // zero-length token will neither resolve as variable nor
+            // point to writable content; skip it
+            continue;
+        }
+        
+        if (kind == LXT_KIND_VARIABLE) {
+            if (lxt_token_equals(token, name)) {
+                // variable points to its own generator; skip it or
+                // incur the wrath of infinite recursion
+                continue;
+            }
+            
+            if (lxt_append_op(builder, generator_index,
+                              LXT_OP_VARIABLE, token) != 0) {
+                return -1;
+            }
+        } else if (kind == LXT_KIND_TEXT) {
+            if (lxt_append_op(builder, generator_index,
+                              LXT_OP_TEXT, token) != 0) {
+                return -1;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+static
+enum lxt_error
+lxt_compile_builder(struct lxt_template ** const template,
+                    struct lxt_builder * const builder)
+{
+    enum lxt_error error = lxt_fold_entries(builder);
+    
+    if (error == LXT_ERROR_NONE) {
+        error = lxt_build(template, builder);
+    }
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    error = lxt_optimize(template);
+    
+    if (error != LXT_ERROR_NONE) {
+        lxt_free(*template);
+        
+        *template = NULL;
+    }
+    
+    return error;
+}
+
+static
+int32_t
+lxt_index_pattern(struct lxt_index * const index,
+                  struct lxt_builder * const builder,
+                  char const * pattern,
+                  char const * const end)
+{
+    // the kind of the definition that tokens currently belong to
+    enum lxt_kind current = LXT_KIND_NONE;
+    
+    while (pattern < end) {
+        char const * const start = pattern;
+        
+        struct lxt_token token;
+        enum lxt_kind kind;
+        
+        pattern = lxt_parse_token(&token, &kind, pattern, end);
+        
+        if (kind == LXT_KIND_CONTAINER_ENTRY) {
+            if (current != LXT_KIND_CONTAINER) {
+                index->irregular = true;
+            }
+            
+            if (*start == '(') {
+                // every entry up to the closing parenthesis belongs to the
+                // same container; skip over all of them in one go
+                char const * const close =
+                    memchr(pattern, ')', (size_t)(end - pattern));
+                
+                pattern = close != NULL ? close : end;
+            }
+            
+            continue;
+        }
+        
+        if (kind == LXT_KIND_SEQUENCE) {
+            if (current != LXT_KIND_GENERATOR) {
+                index->irregular = true;
+            }
+            
+            continue;
+        }
+        
+        if (kind == LXT_KIND_COMMENT) {
+            if (lxt_process_directive(builder, token) != 0) {
+                index->irregular = true;
+            }
+            
+            continue;
+        }
+        
+        if (kind != LXT_KIND_CONTAINER &&
+            kind != LXT_KIND_GENERATOR) {
+            continue;
+        }
+        
+        lxt_token_trim(&token);
+        
+        uint32_t weight = 1;
+        
+        if (kind == LXT_KIND_GENERATOR &&
+            !lxt_token_weight(&token, &weight)) {
+            index->irregular = true;
+            
+            continue;
+        }
         
-        case LXT_KIND_VARIABLE:
-        case LXT_KIND_TEXT:
-        case LXT_KIND_COMMENT:
-        case LXT_KIND_NONE:
-            /* fall through */
+        if (token.length == 0) {
+            // not a definition; anything that follows still belongs to
+            // the current definition
+            continue;
+        }
+        
+        if (index->definitions.count == (UINT32_MAX >> 2)) {
+            // more definitions than a template could ever hold
+            index->irregular = true;
+            
             break;
+        }
+        
+        struct lxt_definition * const definitions =
+            (struct lxt_definition *)index->definitions.items;
+        
+        if (index->definitions.count > 0) {
+            definitions[index->definitions.count - 1].end = start;
+        }
+        
+        struct lxt_definition const definition = {
+            .name = token,
+            .start = start,
+            .end = end,
+            .hash = lxt_token_hash(token),
+            .kind = kind,
+            .reached = false
+        };
+        
+        if (lxt_list_push(&index->definitions, &definition,
+                          sizeof(definition)) == NULL) {
+            return -1;
+        }
+        
+        current = kind;
+    }
+    
+    uint32_t const count = (uint32_t)index->definitions.count;
+    
+    // keep the table at most half full, such that probing for a missing
+    // definition always terminates
+    uint32_t capacity = 1;
+    
+    while (capacity < count * 2 + 1) {
+        capacity *= 2;
+    }
+    
+    index->slots = calloc(capacity, sizeof(uint32_t));
+    index->mask = capacity - 1;
+    
+    if (index->slots == NULL) {
+        return -1;
+    }
+    
+    struct lxt_definition const * const definitions =
+        (struct lxt_definition const *)index->definitions.items;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        struct lxt_definition const * const definition = &definitions[i];
+        
+        if (lxt_index_find(index, definition->name, definition->hash,
+                           definition->kind) != DEFINITION_NONE) {
+            // only the first definition of a name is ever used
+            continue;
+        }
+        
+        uint32_t slot = definition->hash & index->mask;
+        
+        while (index->slots[slot] != 0) {
+            slot = (slot + 1) & index->mask;
+        }
+        
+        index->slots[slot] = i + 1;
     }
     
     return 0;
 }
 
 static
-int32_t
-lxt_resolve_generator(struct lxt_cursor * const cursor,
-                      struct lxt_generator const * const gen,
-                      struct lxt_template const * const template)
+uint32_t
+lxt_index_find(struct lxt_index const * const index,
+               struct lxt_token const name,
+               uint32_t const hash,
+               enum lxt_kind const kind)
 {
-    char const * next = gen->sequence.start;
-    char const * const end = next + gen->sequence.length;
+    struct lxt_definition const * const definitions =
+        (struct lxt_definition const *)index->definitions.items;
     
-    while (*next && next != end) {
-        struct lxt_token token;
-        enum lxt_kind kind;
-        
-        next = lxt_parse_sequence(&token, &kind, next, end);
+    uint32_t slot = hash & index->mask;
+    
+    while (index->slots[slot] != 0) {
+        uint32_t const i = index->slots[slot] - 1;
         
-        if (kind == LXT_KIND_NONE) {
-            continue;
+        if (definitions[i].kind == kind &&
+            definitions[i].hash == hash &&
+            lxt_token_equals(name, definitions[i].name)) {
+            return i;
         }
         
-        if (token.length == 0) {
-            // zero-length token will neither resolve as variable nor
-            // point to writable content; skip it
-            continue;
+        slot = (slot + 1) & index->mask;
+    }
+    
+    return DEFINITION_NONE;
+}
+
+static
+void
+lxt_index_free(struct lxt_index * const index)
+{
+    lxt_list_free(&index->definitions);
+    
+    free(index->slots);
+}
+
+static
+int32_t
+lxt_parse_reachable(struct lxt_builder * const builder,
+                    struct lxt_index * const index,
+                    uint32_t const entry)
+{
+    struct lxt_definition * const definitions =
+        (struct lxt_definition *)index->definitions.items;
+    
+    definitions[entry].reached = true;
+    
+    if (lxt_parse(builder, definitions[entry].start,
+                  definitions[entry].end, false) != 0) {
+        return -1;
+    }
+    
+    // generators are compiled in the order that they are reached; the
+    // variables of each one then reach the definitions that they name
+    for (size_t i = 0; i < builder->generators.count; i++) {
+        if (lxt_compile_sequence(builder, i) != 0) {
+            return -1;
         }
         
-        if (kind == LXT_KIND_VARIABLE) {
-            if (lxt_token_equals(token, gen->entry)) {
-                // variable points to its own generator; skip it or
-                // incur the wrath of infinite recursion
+        struct lxt_generator const * const generator =
+            (struct lxt_generator const *)builder->generators.items + i;
+        
+        // parsing more definitions moves the generators around
+        uint32_t const op_index = generator->op_index;
+        uint32_t const op_count = generator->op_count;
+        
+        for (uint32_t k = 0; k < op_count; k++) {
+            struct lxt_op const * const op =
+                (struct lxt_op const *)builder->ops.items + op_index + k;
+            
+            if (op->kind != LXT_OP_VARIABLE) {
                 continue;
             }
             
-            if (lxt_resolve_variable(cursor, token, template) != 0) {
-                return -1;
+            struct lxt_token name;
+            
+            name.start = builder->pattern + op->text.offset;
+            name.length = op->text.length;
+            
+            uint32_t const hash = lxt_token_hash(name);
+            
+            // variables name generators before containers, exactly as
+            // they are linked
+            uint32_t definition = lxt_index_find(index, name, hash,
+                                                 LXT_KIND_GENERATOR);
+            
+            if (definition == DEFINITION_NONE) {
+                definition = lxt_index_find(index, name, hash,
+                                            LXT_KIND_CONTAINER);
             }
-        } else if (kind == LXT_KIND_TEXT) {
-            if (lxt_cursor_write(cursor, token) != 0) {
+            
+            if (definition == DEFINITION_NONE) {
+                // imported, or undefined; either is left to linking
+                continue;
+            }
+            
+            if (definitions[definition].reached) {
+                continue;
+            }
+            
+            definitions[definition].reached = true;
+            
+            if (lxt_parse(builder, definitions[definition].start,
+                          definitions[definition].end, false) != 0) {
                 return -1;
             }
         }
@@ -398,38 +1754,451 @@ lxt_resolve_generator(struct lxt_cursor * const cursor,
     return 0;
 }
 
+static
+size_t
+lxt_batch_estimate(struct lxt_batch const * const batch,
+                   size_t const count,
+                   struct lxt_template const * const template,
+                   struct lxt_opts const options)
+{
+    struct lxt_bounds bounds;
+    
+    if (lxt_measure(&bounds, template, options.generator) != LXT_ERROR_NONE) {
+        return batch->capacity;
+    }
+    
+    size_t const used = batch->offsets != NULL ?
+        (size_t)batch->offsets[batch->count] : 0;
+    
+    // the longest length that every result can have within the limit
+    uint64_t const limit = MAX_ESTIMATE / (count > 0 ? count : 1);
+    
+    // if every result fits, allocate once; otherwise make sure to at least
+    // allocate as much as is needed
+    uint64_t const length = bounds.max <= limit ? bounds.max : bounds.min;
+    
+    if (length > limit) {
+        return batch->capacity;
+    }
+    
+    size_t const capacity = used + (size_t)length * count;
+    
+    return capacity > batch->capacity ? capacity : batch->capacity;
+}
+
+static
+enum lxt_error
+lxt_batch_append(struct lxt_batch * const batch,
+                 struct lxt_template const * const template,
+                 struct lxt_opts const * const options,
+                 struct lxt_rng * const rng,
+                 struct lxt_combination const * const combination,
+                 struct lxt_scratch * const scratch)
+{
+    struct lxt_batch_writer writer;
+    struct lxt_sink sink;
+    
+    writer.batch = batch;
+    writer.length = 0;
+    writer.error = LXT_ERROR_NONE;
+    
+    sink.write = lxt_batch_write;
+    sink.context = &writer;
+    
+    struct lxt_cursor cursor;
+    
+    lxt_cursor_init(&cursor, scratch->block, BLOCK_SIZE, &sink);
+    
+    enum lxt_error error = lxt_generate(&cursor, template, options, rng,
+                                        combination, scratch);
+    
+    if (error == LXT_ERROR_NONE && lxt_cursor_flush(&cursor) != 0) {
+        error = LXT_ERROR_WRITE_FAILED;
+    }
+    
+    if (writer.error != LXT_ERROR_NONE) {
+        // the batch failed to grow
+        error = writer.error;
+    }
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    batch->offsets[batch->count + 1] =
+        batch->offsets[batch->count] + (int64_t)writer.length;
+    batch->count += 1;
+    
+    return LXT_ERROR_NONE;
+}
+
 static
 int32_t
-lxt_resolve_variable(struct lxt_cursor * const cursor,
-                     struct lxt_token const variable,
-                     struct lxt_template const * const template)
+lxt_batch_write(void * const context,
+                char const * const data,
+                size_t const length)
 {
-    struct lxt_generator const * generator = NULL;
+    struct lxt_batch_writer * const writer = context;
+    struct lxt_batch * const batch = writer->batch;
+    
+    size_t const end =
+        (size_t)batch->offsets[batch->count] + writer->length;
     
-    if (lxt_find_generator(&generator, variable, template)) {
-        if (lxt_resolve_generator(cursor, generator, template) != 0) {
+    if (length > batch->capacity - end) {
+        size_t capacity = batch->capacity < 256 ? 512 : batch->capacity * 2;
+        
+        while (length > capacity - end) {
+            capacity *= 2;
+        }
+        
+        writer->error = lxt_batch_reserve(batch, batch->max_count, capacity);
+        
+        if (writer->error != LXT_ERROR_NONE) {
             return -1;
         }
+    }
+    
+    memcpy(batch->data + end, data, length);
+    
+    writer->length += length;
+    
+    return 0;
+}
+
+static
+void
+lxt_scratch_init(struct lxt_scratch * const scratch,
+                 struct lxt_frame * const frames,
+                 char * const block)
+{
+    scratch->frames = frames;
+    scratch->frame_count = FRAME_COUNT;
+    scratch->frames_allocated = false;
+    scratch->block = block;
+}
+
+static
+void
+lxt_scratch_release(struct lxt_scratch * const scratch)
+{
+    if (scratch->frames_allocated) {
+        free(scratch->frames);
+    }
+}
+
+static
+enum lxt_error
+lxt_gen_scratch(struct lxt_scratch * const scratch,
+                struct lxt_sink const * const sink,
+                struct lxt_template const * const template,
+                struct lxt_opts const * const options,
+                struct lxt_rng * const rng)
+{
+    struct lxt_cursor cursor;
+    
+    lxt_cursor_init(&cursor, scratch->block, BLOCK_SIZE, sink);
+    
+    enum lxt_error error = lxt_generate(&cursor, template, options, rng,
+                                        NULL, scratch);
+    
+    if (error == LXT_ERROR_NONE && lxt_cursor_flush(&cursor) != 0) {
+        error = LXT_ERROR_WRITE_FAILED;
+    }
+    
+    return error;
+}
+
+static
+struct lxt_rng *
+lxt_opts_rng(struct lxt_rng * const fallback,
+             struct lxt_opts const * const options)
+{
+    if (options->rng != NULL) {
+        return options->rng;
+    }
+    
+    if (options->seed != NULL) {
+        lxt_rng_init_xorshift32(fallback, *options->seed);
+    } else {
+        lxt_rng_init(fallback, LXT_RNG_DEFAULT_SEED, 0);
+    }
+    
+    return fallback;
+}
+
+static
+void
+lxt_opts_rng_return(struct lxt_rng const * const fallback,
+                    struct lxt_opts const * const options)
+{
+    if (options->rng == NULL && options->seed != NULL) {
+        *options->seed = (uint32_t)fallback->state;
+    }
+}
+
+static
+enum lxt_error
+lxt_generate(struct lxt_cursor * const cursor,
+             struct lxt_template const * const template,
+             struct lxt_opts const * const options,
+             struct lxt_rng * const rng,
+             struct lxt_combination const * const combination,
+             struct lxt_scratch * const scratch)
+{
+    if (combination != NULL) {
+        uint64_t index = combination->index;
+        
+        // combinations only exist for generators that are not recursive,
+        // which can never nest deeper than there are generators
+        enum lxt_error const error =
+            lxt_resolve_generator(cursor, combination->generator, template,
+                                  template->generator_count, NULL, &index,
+                                  scratch);
+        
+        if (error != LXT_ERROR_NONE) {
+            return error;
+        }
         
-        return 0;
+        return cursor->failed ? LXT_ERROR_WRITE_FAILED : LXT_ERROR_NONE;
     }
     
-    struct lxt_container const * container = NULL;
+    struct lxt_generator const * generator = NULL;
+    
+    lxt_get_generator(&generator, template, options->generator, rng);
     
-    if (!lxt_find_container(&container, variable, template)) {
-        return -1;
+    if (generator == NULL) {
+        return LXT_ERROR_GENERATOR_NOT_FOUND;
     }
     
+    uint32_t const max_depth = options->max_depth == 0 ?
+        LXT_DEPTH_DEFAULT : options->max_depth;
+    
+    enum lxt_error const error = lxt_resolve_generator(cursor, generator,
+                                                       template, max_depth,
+                                                       rng, NULL, scratch);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    if (cursor->failed) {
+        return LXT_ERROR_WRITE_FAILED;
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+static
+enum lxt_error
+lxt_resolve_generator(struct lxt_cursor * const cursor,
+                      struct lxt_generator const * const gen,
+                      struct lxt_template const * const template,
+                      uint32_t const max_depth,
+                      struct lxt_rng * const rng,
+                      uint64_t * const combination,
+                      struct lxt_scratch * const scratch)
+{
+    struct lxt_frame * frames = scratch->frames;
+    
+    uint32_t capacity = scratch->frame_count;
+    uint32_t depth = 1;
+    
+    frames[0].generator = gen;
+    frames[0].op = 0;
+    
+    enum lxt_error error = LXT_ERROR_NONE;
+    
+    while (depth > 0) {
+        struct lxt_frame * const frame = &frames[depth - 1];
+        
+        if (frame->op == frame->generator->op_count) {
+            // generator is fully resolved; return to its caller
+            depth -= 1;
+            
+            continue;
+        }
+        
+        struct lxt_op const * op =
+            &template->ops[frame->generator->op_index + frame->op];
+        
+        frame->op += 1;
+        
+        if (op->kind == LXT_OP_INLINE) {
+            if (depth >= max_depth) {
+                continue;
+            }
+            
+            // run the only operation of the generator in place
+            op = &template->ops[template->generators[op->index].op_index];
+        }
+        
+        struct lxt_generator const * next = NULL;
+        
+        switch (op->kind) {
+            case LXT_OP_TEXT: {
+                struct lxt_token const text =
+                    lxt_get_token(template, op->text);
+                
+                if (op->index > 0 && rng != NULL) {
+                    if (cursor->sink == NULL &&
+                        cursor->offset >= cursor->length) {
+                        // the first of the folded picks would draw, and
+                        // then stop the result
+                        lxt_rand_next(rng);
+                        
+                        depth = 0;
+                        
+                        break;
+                    }
+                    
+                    for (uint32_t i = 0; i < op->index; i++) {
+                        lxt_rand_next(rng);
+                    }
+                }
+                
+                bool const truncates = cursor->sink == NULL &&
+                    (cursor->offset >= cursor->length ||
+                     text.length > cursor->length - cursor->offset);
+                
+                if (lxt_cursor_write(cursor, text) != 0 || truncates) {
+                    // stop as soon as text is cut off, exactly as if the
+                    // text had been written one character at a time
+                    depth = 0;
+                }
+            } break;
+            
+            case LXT_OP_CONTAINER: {
+                struct lxt_container const * const container =
+                    &template->containers[op->index];
+                
+                if (lxt_resolve_container(cursor, container, template,
+                                          rng, combination) != 0) {
+                    depth = 0;
+                }
+            } break;
+            
+            case LXT_OP_ENTRY: {
+                if (rng != NULL) {
+                    lxt_rand_next(rng);
+                }
+                
+                if (lxt_cursor_write(cursor,
+                                     lxt_get_token(template,
+                                                   op->text)) != 0) {
+                    depth = 0;
+                }
+            } break;
+            
+            case LXT_OP_IMPORT: {
+                struct lxt_import const * const import =
+                    &template->imports[op->index];
+                
+                // entries of an imported container belong to its module
+                if (lxt_resolve_container(cursor, import->container,
+                                          import->template,
+                                          rng, combination) != 0) {
+                    depth = 0;
+                }
+            } break;
+            
+            case LXT_OP_RECURSION: {
+                next = &template->generators[op->index];
+                
+                for (uint32_t i = 0; i < depth; i++) {
+                    if (frames[i].generator == next) {
+                        // generator is already being resolved; resolving
+                        // it again would never end
+                        next = NULL;
+                        
+                        break;
+                    }
+                }
+            } break;
+            
+            case LXT_OP_GENERATOR: {
+                next = &template->generators[op->index];
+            } break;
+            
+            default:
+                // unreachable; variables are always linked
+                depth = 0;
+                
+                break;
+        }
+        
+        if (next == NULL || depth >= max_depth) {
+            continue;
+        }
+        
+        if (depth == capacity) {
+            uint32_t const count = capacity > max_depth / 2 ?
+                max_depth : capacity * 2;
+            
+            struct lxt_frame * const grown = !scratch->frames_allocated ?
+                malloc(sizeof(struct lxt_frame) * count) :
+                realloc(frames, sizeof(struct lxt_frame) * count);
+            
+            if (grown == NULL) {
+                error = LXT_ERROR_OUT_OF_MEMORY;
+                
+                break;
+            }
+            
+            if (!scratch->frames_allocated) {
+                memcpy(grown, frames, sizeof(struct lxt_frame) * capacity);
+            }
+            
+            // keep the grown frames for any later generator
+            frames = grown;
+            capacity = count;
+            
+            scratch->frames = frames;
+            scratch->frame_count = capacity;
+            scratch->frames_allocated = true;
+        }
+        
+        frames[depth].generator = next;
+        frames[depth].op = 0;
+        
+        depth += 1;
+    }
+    
+    return error;
+}
+
+static
+int32_t
+lxt_resolve_container(struct lxt_cursor * const cursor,
+                      struct lxt_container const * const container,
+                      struct lxt_template const * const template,
+                      struct lxt_rng * const rng,
+                      uint64_t * const combination)
+{
     if (container->entry_count == 0) {
         // resolve by doing nothing
         return 0;
     }
     
-    size_t const i = lxt_rand32(template->seed) % container->entry_count;
+    if (combination != NULL) {
+        uint64_t const i = *combination % container->entry_count;
+        
+        *combination /= container->entry_count;
+        
+        struct lxt_span const entry =
+            template->entries[container->entry_index + i];
+        
+        return lxt_cursor_write(cursor, lxt_get_token(template, entry));
+    }
+    
+    size_t const i = container->weight_total == 0 ?
+        lxt_rand_bounded(rng, container->entry_count) :
+        lxt_pick(&template->weights[container->weight_index],
+                 container->entry_count, container->weight_total, rng);
     
-    struct lxt_token const * entry = &container->entries[i];
+    struct lxt_span const entry =
+        template->entries[container->entry_index + i];
     
-    if (lxt_cursor_write(cursor, *entry) != 0) {
+    if (lxt_cursor_write(cursor, lxt_get_token(template, entry)) != 0) {
         return -1;
     }
     
@@ -0,0 +1,394 @@
+#include <lext/lext.h> // lxt_library, lxt_library_*, lxt_compile_library
+
+#include "library.h" // lxt_module, lxt_lines, lxt_compile_file
+#include "template.h" // lxt_template, lxt_builder, lxt_build, lxt_*_image
+#include "token.h" // lxt_token, lxt_token_equals, lxt_token_trim
+#include "arena.h" // lxt_list_push, lxt_list_free
+
+#include <stddef.h> // size_t, NULL
+#include <stdbool.h> // bool, true, false
+#include <stdlib.h> // malloc, calloc, free
+#include <string.h> // memcpy, memset, memchr, strlen
+
+/**
+ * Add a module to a library, copying its name and filename.
+ */
+static enum lxt_error lxt_library_append(struct lxt_library *,
+                                         char const * name,
+                                         char const * pattern,
+                                         size_t length,
+                                         char const * filename);
+/**
+ * Compile the pattern of a module, reading it from its file first if needed.
+ */
+static enum lxt_error lxt_module_compile(struct lxt_module *,
+                                         struct lxt_library *);
+/**
+ * Read a file as a template of a single unnamed container, with an entry
+ * for each line of the file that is not blank.
+ *
+ * The lines are indexed once; the entries point directly into the contents
+ * of the file, which are never copied if mapped. Like entries of a pattern,
+ * lines are trimmed of whitespace (including any carriage return).
+ */
+static enum lxt_error lxt_read_lines(struct lxt_template **,
+                                     char const * filename,
+                                     bool mapped);
+/**
+ * Copy a string into newly allocated memory.
+ */
+static char * lxt_copy_string(char const *, size_t length);
+
+enum lxt_error
+lxt_library_create(struct lxt_library ** const library)
+{
+    *library = calloc(1, sizeof(struct lxt_library));
+    
+    if (*library == NULL) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_library_add(struct lxt_library * const library,
+                char const * const name,
+                char const * const pattern,
+                size_t const length)
+{
+    return lxt_library_append(library, name, pattern, length, NULL);
+}
+
+enum lxt_error
+lxt_library_add_file(struct lxt_library * const library,
+                     char const * const name,
+                     char const * const filename)
+{
+    return lxt_library_append(library, name, NULL, 0, filename);
+}
+
+enum lxt_error
+lxt_library_add_lines(struct lxt_library * const library,
+                      char const * const name,
+                      char const * const filename)
+{
+    struct lxt_lines lines;
+    
+    memset(&lines, 0, sizeof(lines));
+    
+    lines.name_length = strlen(name);
+    lines.name = lxt_copy_string(name, lines.name_length);
+    lines.filename = lxt_copy_string(filename, strlen(filename));
+    
+    if (lines.name == NULL || lines.filename == NULL ||
+        lxt_list_push(&library->lines, &lines, sizeof(lines)) == NULL) {
+        free(lines.name);
+        free(lines.filename);
+        
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+void
+lxt_library_free(struct lxt_library * const library)
+{
+    if (library == NULL) {
+        return;
+    }
+    
+    struct lxt_module * const modules =
+        (struct lxt_module *)library->modules.items;
+    
+    for (size_t i = 0; i < library->modules.count; i++) {
+        // releasing a module read from a file also releases its pattern
+        lxt_free(modules[i].template);
+        
+        free(modules[i].name);
+        free(modules[i].filename);
+    }
+    
+    lxt_list_free(&library->modules);
+    
+    struct lxt_lines * const lines = (struct lxt_lines *)library->lines.items;
+    
+    for (size_t i = 0; i < library->lines.count; i++) {
+        lxt_free(lines[i].template);
+        
+        free(lines[i].name);
+        free(lines[i].filename);
+    }
+    
+    lxt_list_free(&library->lines);
+    
+    free(library);
+}
+
+enum lxt_error
+lxt_library_find(struct lxt_template const ** const template,
+                 struct lxt_library * const library,
+                 struct lxt_token const name)
+{
+    *template = NULL;
+    
+    for (size_t i = 0; i < library->modules.count; i++) {
+        struct lxt_module * const module =
+            (struct lxt_module *)library->modules.items + i;
+        
+        struct lxt_token const module_name = {
+            .start = module->name,
+            .length = module->name_length
+        };
+        
+        if (!lxt_token_equals(name, module_name)) {
+            continue;
+        }
+        
+        if (module->compiling) {
+            // module imports itself; it would never finish compiling
+            return LXT_ERROR_INVALID_TEMPLATE;
+        }
+        
+        if (!module->compiled) {
+            // compiling may import from other modules, but never adds any;
+            // the module stays in place
+            module->compiling = true;
+            module->error = lxt_module_compile(module, library);
+            module->compiling = false;
+            module->compiled = true;
+        }
+        
+        *template = module->template;
+        
+        return module->error;
+    }
+    
+    return LXT_ERROR_INVALID_TEMPLATE;
+}
+
+enum lxt_error
+lxt_compile_file(struct lxt_template ** const template,
+                 char const * const filename,
+                 struct lxt_library * const library)
+{
+    *template = NULL;
+    
+    struct lxt_template file;
+    
+    // the file is read rather than mapped, such that changing the file
+    // never changes a template compiled from it
+    enum lxt_error error = lxt_read_image(&file, filename, false);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    error = lxt_compile_library(template, file.image, file.image_length,
+                                library);
+    
+    if (error != LXT_ERROR_NONE) {
+        lxt_release_image(&file);
+        
+        return error;
+    }
+    
+    // the template refers to the contents of the file; keep them for as
+    // long as the template, exactly like a template loaded from an image
+    (*template)->image = file.image;
+    (*template)->image_length = file.image_length;
+    (*template)->image_mapped = file.image_mapped;
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_library_find_lines(struct lxt_template ** const template,
+                       bool * const owned,
+                       struct lxt_library * const library,
+                       struct lxt_token const name)
+{
+    *template = NULL;
+    *owned = false;
+    
+    for (size_t i = 0; i < library->lines.count; i++) {
+        struct lxt_lines * const lines =
+            (struct lxt_lines *)library->lines.items + i;
+        
+        struct lxt_token const lines_name = {
+            .start = lines->name,
+            .length = lines->name_length
+        };
+        
+        if (!lxt_token_equals(name, lines_name)) {
+            continue;
+        }
+        
+        lines->used = true;
+        
+        if (library->copies_lines) {
+            // the copy can outlive any later change of the file
+            *owned = true;
+            
+            return lxt_read_lines(template, lines->filename, false);
+        }
+        
+        if (!lines->read) {
+            // the file is mapped, such that its lines are never copied;
+            // like an image, it must not change while the library exists
+            lines->error = lxt_read_lines(&lines->template,
+                                          lines->filename, true);
+            lines->read = true;
+        }
+        
+        *template = lines->template;
+        
+        return lines->error;
+    }
+    
+    return LXT_ERROR_UNSUPPORTED;
+}
+
+static
+enum lxt_error
+lxt_read_lines(struct lxt_template ** const template,
+               char const * const filename,
+               bool const mapped)
+{
+    *template = NULL;
+    
+    struct lxt_template file;
+    
+    enum lxt_error error = lxt_read_image(&file, filename, mapped);
+    
+    if (error != LXT_ERROR_NONE) {
+        return error;
+    }
+    
+    struct lxt_builder builder;
+    
+    memset(&builder, 0, sizeof(builder));
+    
+    builder.pattern = file.image;
+    
+    struct lxt_token const unnamed = {
+        .start = builder.pattern,
+        .length = 0
+    };
+    
+    if (lxt_append_container(&builder, unnamed) != 0) {
+        error = LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    char const * line = builder.pattern;
+    char const * const end = line + file.image_length;
+    
+    while (error == LXT_ERROR_NONE && line < end) {
+        char const * const newline =
+            memchr(line, '\n', (size_t)(end - line));
+        
+        struct lxt_token entry;
+        
+        entry.start = line;
+        entry.length = (size_t)((newline != NULL ? newline : end) - line);
+        
+        line = newline != NULL ? newline + 1 : end;
+        
+        lxt_token_trim(&entry);
+        
+        if (entry.length == 0) {
+            continue;
+        }
+        
+        if (lxt_append_container_entry(&builder, entry, 1) != 0) {
+            // either out of memory, or too large a file to be addressed
+            // by spans
+            error = LXT_ERROR_INVALID_TEMPLATE;
+        }
+    }
+    
+    // entries are never folded; every line is equally likely, such that
+    // repeated lines are picked as often as they are repeated
+    if (error == LXT_ERROR_NONE) {
+        error = lxt_build(template, &builder);
+    }
+    
+    lxt_builder_free(&builder);
+    
+    if (error != LXT_ERROR_NONE) {
+        lxt_release_image(&file);
+        
+        return error;
+    }
+    
+    (*template)->image = file.image;
+    (*template)->image_length = file.image_length;
+    (*template)->image_mapped = file.image_mapped;
+    
+    return LXT_ERROR_NONE;
+}
+
+static
+enum lxt_error
+lxt_library_append(struct lxt_library * const library,
+                   char const * const name,
+                   char const * const pattern,
+                   size_t const length,
+                   char const * const filename)
+{
+    struct lxt_module module;
+    
+    memset(&module, 0, sizeof(module));
+    
+    module.name_length = strlen(name);
+    module.name = lxt_copy_string(name, module.name_length);
+    module.pattern = pattern;
+    module.length = length;
+    
+    if (filename != NULL) {
+        module.filename = lxt_copy_string(filename, strlen(filename));
+    }
+    
+    if (module.name == NULL || (filename != NULL &&
+                                module.filename == NULL) ||
+        lxt_list_push(&library->modules, &module, sizeof(module)) == NULL) {
+        free(module.name);
+        free(module.filename);
+        
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+static
+enum lxt_error
+lxt_module_compile(struct lxt_module * const module,
+                   struct lxt_library * const library)
+{
+    if (module->filename == NULL) {
+        return lxt_compile_library(&module->template, module->pattern,
+                                   module->length, library);
+    }
+    
+    return lxt_compile_file(&module->template, module->filename, library);
+}
+
+static
+char *
+lxt_copy_string(char const * const string,
+                size_t const length)
+{
+    char * const copy = malloc(length + 1);
+    
+    if (copy == NULL) {
+        return NULL;
+    }
+    
+    memcpy(copy, string, length);
+    
+    copy[length] = '\0';
+    
+    return copy;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <lext/lext.h> // lxt_library, lxt_template, lxt_error
+
+#include "token.h" // lxt_token
+#include "arena.h" // lxt_list
+
+#include <stddef.h> // size_t
+#include <stdbool.h> // bool
+
+/**
+ * Represents a named pattern of a library.
+ *
+ * A module is only compiled once a template first imports a container from
+ * it; its template is then kept for as long as the library is, and shared by
+ * every template that imports from it.
+ */
+struct lxt_module {
+    char * name;
+    size_t name_length;
+    char const * pattern;
+    size_t length;
+    /**
+     * The file that the pattern is read from, if the pattern was not given
+     * directly.
+     */
+    char * filename;
+    struct lxt_template * template;
+    /**
+     * The result of compiling the module, once compiled.
+     *
+     * A module that fails to compile is never compiled again.
+     */
+    enum lxt_error error;
+    bool compiled;
+    /**
+     * Whether the module is being compiled; a module that is imported
+     * while being compiled imports itself.
+     */
+    bool compiling;
+};
+
+/**
+ * Represents a named file of lines of a library.
+ *
+ * The file is only read once a template first uses it; its template is
+ * then kept for as long as the library is, and shared by every template
+ * that uses it, unless the library copies lines.
+ */
+struct lxt_lines {
+    char * name;
+    size_t name_length;
+    char * filename;
+    struct lxt_template * template;
+    /**
+     * The result of reading the file, once read.
+     *
+     * A file that fails to be read is never read again.
+     */
+    enum lxt_error error;
+    bool read;
+    /**
+     * Whether any template has used the file since this was last cleared;
+     * used to find the files that a template depends on.
+     */
+    bool used;
+};
+
+struct lxt_library {
+    struct lxt_list modules;
+    struct lxt_list lines;
+    /**
+     * Whether each template reads lines files into memory of its own,
+     * rather than sharing those read by the library; files can then change
+     * while templates using them exist.
+     */
+    bool copies_lines;
+};
+
+/**
+ * Get the template of a module by name, compiling the module on first use.
+ *
+ * Returns LXT_ERROR_INVALID_TEMPLATE if the library has no such module, or
+ * if the module imports itself, directly or through other modules.
+ */
+enum lxt_error lxt_library_find(struct lxt_template const **,
+                                struct lxt_library *,
+                                struct lxt_token name);
+/**
+ * Compile a template from a pattern file, importing from a library if any.
+ *
+ * The template keeps a copy of the contents of the file for as long as it
+ * exists, such that the file can change without affecting the template.
+ */
+enum lxt_error lxt_compile_file(struct lxt_template **,
+                                char const * filename,
+                                struct lxt_library *);
+/**
+ * Get the template of a lines file by name, reading the file on first use.
+ *
+ * If the library copies lines, the file is read again on every call, into
+ * a template that is owned by the caller; otherwise, the template belongs to
+ * the library.
+ *
+ * Returns LXT_ERROR_UNSUPPORTED if the library has no such file.
+ */
+enum lxt_error lxt_library_find_lines(struct lxt_template **,
+                                      bool * owned,
+                                      struct lxt_library *,
+                                      struct lxt_token name);
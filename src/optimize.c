@@ -0,0 +1,561 @@
+#include <lext/lext.h> // lxt_error, lxt_buffer, lxt_sink, lxt_sink_buffer
+
+#include "template.h" // lxt_template, lxt_generator, lxt_op, lxt_span, lxt_*
+#include "arena.h" // lxt_arena, lxt_arena_*, lxt_list, lxt_list_*
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint8_t
+#include <stdbool.h> // bool, true, false
+#include <stdlib.h> // malloc, calloc, free
+#include <string.h> // memcpy, memset
+
+/**
+ * Represents a piece of text of a sequence that can be folded into a
+ * literal.
+ */
+struct lxt_part {
+    struct lxt_span text;
+    /**
+     * Whether the text is the only entry of a container, and so takes a
+     * random number to pick.
+     */
+    bool pick;
+};
+
+/**
+ * Represents the state of optimizing the operations of a template.
+ */
+struct lxt_optimizer {
+    struct lxt_template const * template;
+    /**
+     * A copy of the generators of the template, pointing to their
+     * optimized operations.
+     */
+    struct lxt_generator * generators;
+    struct lxt_list ops;
+    /**
+     * The parts of the run of operations being folded.
+     */
+    struct lxt_list parts;
+    struct lxt_buffer literals;
+    /**
+     * Whether any operation was rewritten.
+     */
+    bool changed;
+};
+
+/**
+ * Optimize the operations of a generator, appending them to the optimized
+ * operations.
+ *
+ * The generators that the generator resolves must be optimized first.
+ */
+static int32_t lxt_optimize_generator(struct lxt_optimizer *,
+                                      uint32_t generator_index);
+/**
+ * Fold the parts of a run of operations into as few operations as possible.
+ *
+ * Text that comes before the first pick is folded into a single text
+ * operation, and the last (up to) MAX_PICKS picks of every run of picks are
+ * folded into a single text operation along with the text that follows.
+ * Any other picks are written as entry operations.
+ *
+ * A result that is cut off by a pick stops at the next pick, after it has
+ * drawn; folded picks always draw together, so a text operation can only
+ * hold picks that are certain to draw, and must be followed by text to
+ * stop the result where the text that follows would have.
+ */
+static int32_t lxt_fold_parts(struct lxt_optimizer *,
+                              uint32_t generator_index);
+/**
+ * Append an operation writing the combined text of a number of parts.
+ *
+ * Parts that are not consecutive in the pattern are copied into the
+ * literals.
+ */
+static int32_t lxt_append_parts(struct lxt_optimizer *,
+                                uint32_t generator_index,
+                                enum lxt_op_kind,
+                                struct lxt_part const * parts,
+                                size_t count,
+                                uint32_t picks);
+static int32_t lxt_optimizer_push(struct lxt_optimizer *,
+                                  uint32_t generator_index,
+                                  struct lxt_op);
+/**
+ * Move the optimized operations into a newly allocated template.
+ */
+static enum lxt_error lxt_optimizer_build(struct lxt_template **,
+                                          struct lxt_optimizer const *);
+
+enum lxt_error
+lxt_optimize(struct lxt_template ** const template)
+{
+    struct lxt_template const * const source = *template;
+    
+    uint32_t const count = source->generator_count;
+    
+    if (count == 0) {
+        return LXT_ERROR_NONE;
+    }
+    
+    struct lxt_optimizer optimizer;
+    
+    memset(&optimizer, 0, sizeof(optimizer));
+    
+    optimizer.template = source;
+    optimizer.generators = malloc(count * sizeof(struct lxt_generator));
+    optimizer.literals = LXT_BUFFER_EMPTY;
+    
+    // generators are optimized depth-first, such that every generator is
+    // optimized after the generators it resolves
+    struct lxt_frame {
+        uint32_t generator;
+        uint32_t op;
+    };
+    
+    struct lxt_frame * const stack = calloc(count, sizeof(struct lxt_frame));
+    uint8_t * const visited = calloc(count, sizeof(uint8_t));
+    
+    enum lxt_error error = LXT_ERROR_NONE;
+    
+    if (optimizer.generators == NULL || stack == NULL || visited == NULL) {
+        error = LXT_ERROR_OUT_OF_MEMORY;
+    } else {
+        memcpy(optimizer.generators, source->generators,
+               count * sizeof(struct lxt_generator));
+    }
+    
+    for (uint32_t root = 0; root < count; root++) {
+        if (error != LXT_ERROR_NONE) {
+            break;
+        }
+        
+        if (visited[root]) {
+            continue;
+        }
+        
+        uint32_t depth = 0;
+        
+        stack[depth++] = (struct lxt_frame) { .generator = root, .op = 0 };
+        visited[root] = 1;
+        
+        while (depth > 0) {
+            struct lxt_frame * const frame = &stack[depth - 1];
+            struct lxt_generator const * const generator =
+                &source->generators[frame->generator];
+            
+            if (frame->op == generator->op_count) {
+                if (lxt_optimize_generator(&optimizer,
+                                           frame->generator) != 0) {
+                    error = LXT_ERROR_OUT_OF_MEMORY;
+                    
+                    break;
+                }
+                
+                depth -= 1;
+                
+                continue;
+            }
+            
+            struct lxt_op const * const op =
+                &source->ops[generator->op_index + frame->op];
+            
+            frame->op += 1;
+            
+            // recursion operations are never inlined, so only generators
+            // outside of a recursive cycle have to be optimized first;
+            // these never nest deeper than there are generators
+            if (op->kind == LXT_OP_GENERATOR && !visited[op->index]) {
+                stack[depth++] = (struct lxt_frame) {
+                    .generator = op->index,
+                    .op = 0
+                };
+                
+                visited[op->index] = 1;
+            }
+        }
+    }
+    
+    if (error == LXT_ERROR_NONE && optimizer.changed) {
+        struct lxt_template * optimized = NULL;
+        
+        error = lxt_optimizer_build(&optimized, &optimizer);
+        
+        if (error == LXT_ERROR_NONE) {
+            // the optimized template takes over any containers that were
+            // read from files
+            (*template)->import_count = 0;
+            
+            lxt_free(*template);
+            
+            *template = optimized;
+        }
+    }
+    
+    free(stack);
+    free(visited);
+    free(optimizer.generators);
+    
+    lxt_list_free(&optimizer.ops);
+    lxt_list_free(&optimizer.parts);
+    lxt_buffer_free(&optimizer.literals);
+    
+    return error;
+}
+
+static
+int32_t
+lxt_optimize_generator(struct lxt_optimizer * const optimizer,
+                       uint32_t const generator_index)
+{
+    struct lxt_template const * const template = optimizer->template;
+    struct lxt_generator const * const generator =
+        &template->generators[generator_index];
+    
+    if (optimizer->ops.count + generator->op_count > UINT32_MAX) {
+        return -1;
+    }
+    
+    optimizer->generators[generator_index].op_index =
+        (uint32_t)optimizer->ops.count;
+    optimizer->generators[generator_index].op_count = 0;
+    
+    optimizer->parts.count = 0;
+    
+    for (uint32_t i = 0; i < generator->op_count; i++) {
+        struct lxt_op op = template->ops[generator->op_index + i];
+        
+        struct lxt_part part;
+        
+        part.pick = false;
+        
+        if (op.kind == LXT_OP_TEXT && op.text.length > 0) {
+            part.text = op.text;
+            
+            if (lxt_list_push(&optimizer->parts,
+                              &part, sizeof(part)) == NULL) {
+                return -1;
+            }
+            
+            continue;
+        }
+        
+        if (op.kind == LXT_OP_CONTAINER) {
+            struct lxt_container const * const container =
+                &template->containers[op.index];
+            
+            if (container->entry_count == 0) {
+                // resolves by doing nothing
+                optimizer->changed = true;
+                
+                continue;
+            }
+            
+            struct lxt_span const entry =
+                template->entries[container->entry_index];
+            
+            // an empty entry stops a result; leave it be
+            if (container->entry_count == 1 && entry.length > 0) {
+                part.text = entry;
+                part.pick = true;
+                
+                if (lxt_list_push(&optimizer->parts,
+                                  &part, sizeof(part)) == NULL) {
+                    return -1;
+                }
+                
+                continue;
+            }
+        }
+        
+        if (op.kind == LXT_OP_GENERATOR) {
+            struct lxt_generator const * const callee =
+                &optimizer->generators[op.index];
+            
+            if (callee->op_count == 0) {
+                // resolves by doing nothing
+                optimizer->changed = true;
+                
+                continue;
+            }
+            
+            struct lxt_op const * const only =
+                (struct lxt_op const *)optimizer->ops.items +
+                callee->op_index;
+            
+            if (callee->op_count == 1 && (only->kind == LXT_OP_TEXT ||
+                                          only->kind == LXT_OP_ENTRY)) {
+                op.kind = LXT_OP_INLINE;
+            }
+        }
+        
+        // anything else ends the run of parts
+        if (lxt_fold_parts(optimizer, generator_index) != 0 ||
+            lxt_optimizer_push(optimizer, generator_index, op) != 0) {
+            return -1;
+        }
+    }
+    
+    return lxt_fold_parts(optimizer, generator_index);
+}
+
+static
+int32_t
+lxt_fold_parts(struct lxt_optimizer * const optimizer,
+               uint32_t const generator_index)
+{
+    struct lxt_part const * const parts =
+        (struct lxt_part const *)optimizer->parts.items;
+    
+    size_t const count = optimizer->parts.count;
+    
+    size_t i = 0;
+    
+    while (i < count && !parts[i].pick) {
+        i += 1;
+    }
+    
+    if (i > 0 && lxt_append_parts(optimizer, generator_index, LXT_OP_TEXT,
+                                  parts, i, 0) != 0) {
+        return -1;
+    }
+    
+    while (i < count) {
+        size_t const first = i;
+        
+        while (i < count && parts[i].pick) {
+            i += 1;
+        }
+        
+        size_t const picks = i - first;
+        
+        while (i < count && !parts[i].pick) {
+            i += 1;
+        }
+        
+        // picks that no text follows, or that are not certain to draw,
+        // are written as entry operations
+        size_t folded = i;
+        
+        if (i > first + picks) {
+            folded = picks > MAX_PICKS ? first + picks - MAX_PICKS : first;
+        }
+        
+        for (size_t k = first; k < folded; k++) {
+            if (lxt_append_parts(optimizer, generator_index, LXT_OP_ENTRY,
+                                 &parts[k], 1, 1) != 0) {
+                return -1;
+            }
+        }
+        
+        if (folded < i &&
+            lxt_append_parts(optimizer, generator_index, LXT_OP_TEXT,
+                             &parts[folded], i - folded,
+                             (uint32_t)(first + picks - folded)) != 0) {
+            return -1;
+        }
+    }
+    
+    optimizer->parts.count = 0;
+    
+    return 0;
+}
+
+static
+int32_t
+lxt_append_parts(struct lxt_optimizer * const optimizer,
+                 uint32_t const generator_index,
+                 enum lxt_op_kind const kind,
+                 struct lxt_part const * const parts,
+                 size_t const count,
+                 uint32_t const picks)
+{
+    struct lxt_op op;
+    
+    op.kind = kind;
+    op.index = kind == LXT_OP_ENTRY ? 0 : picks;
+    op.text = parts[0].text;
+    
+    bool consecutive = true;
+    
+    for (size_t i = 1; i < count; i++) {
+        if (op.text.length > LXT_SPAN_LITERAL - parts[i].text.length) {
+            return -1;
+        }
+        
+        if (op.text.offset + op.text.length != parts[i].text.offset) {
+            consecutive = false;
+        }
+        
+        op.text.length += parts[i].text.length;
+    }
+    
+    if (!consecutive) {
+        struct lxt_buffer * const literals = &optimizer->literals;
+        
+        if (op.text.length > LXT_SPAN_LITERAL - literals->length) {
+            return -1;
+        }
+        
+        op.text.offset = (uint32_t)literals->length | LXT_SPAN_LITERAL;
+        
+        struct lxt_sink sink;
+        
+        lxt_sink_buffer(&sink, literals);
+        
+        for (size_t i = 0; i < count; i++) {
+            struct lxt_token const text =
+                lxt_get_token(optimizer->template, parts[i].text);
+            
+            if (sink.write(sink.context, text.start, text.length) != 0) {
+                return -1;
+            }
+        }
+    }
+    
+    if (kind != LXT_OP_TEXT || picks > 0 || count > 1) {
+        optimizer->changed = true;
+    }
+    
+    return lxt_optimizer_push(optimizer, generator_index, op);
+}
+
+static
+int32_t
+lxt_optimizer_push(struct lxt_optimizer * const optimizer,
+                   uint32_t const generator_index,
+                   struct lxt_op const op)
+{
+    if (lxt_list_push(&optimizer->ops, &op, sizeof(op)) == NULL) {
+        return -1;
+    }
+    
+    optimizer->generators[generator_index].op_count += 1;
+    
+    if (op.kind == LXT_OP_INLINE) {
+        optimizer->changed = true;
+    }
+    
+    return 0;
+}
+
+static
+enum lxt_error
+lxt_optimizer_build(struct lxt_template ** const template,
+                    struct lxt_optimizer const * const optimizer)
+{
+    struct lxt_template const * const source = optimizer->template;
+    
+    uint32_t const container_capacity = source->container_symbols.mask + 1;
+    uint32_t const generator_capacity = source->generator_symbols.mask + 1;
+    
+    size_t const containers_size =
+        source->container_count * sizeof(struct lxt_container);
+    size_t const generators_size =
+        source->generator_count * sizeof(struct lxt_generator);
+    size_t const entries_size =
+        source->entry_count * sizeof(struct lxt_span);
+    size_t const ops_size =
+        optimizer->ops.count * sizeof(struct lxt_op);
+    size_t const weights_size =
+        source->weight_count * sizeof(struct lxt_weight);
+    size_t const imports_size =
+        source->import_count * sizeof(struct lxt_import);
+    size_t const container_symbols_size =
+        container_capacity * sizeof(struct lxt_symbol);
+    size_t const generator_symbols_size =
+        generator_capacity * sizeof(struct lxt_symbol);
+    size_t const literals_size = optimizer->literals.length;
+    
+    struct lxt_arena arena;
+    
+    if (lxt_arena_create(&arena,
+                         lxt_arena_size(sizeof(struct lxt_template)) +
+                         lxt_arena_size(containers_size) +
+                         lxt_arena_size(generators_size) +
+                         lxt_arena_size(entries_size) +
+                         lxt_arena_size(ops_size) +
+                         lxt_arena_size(weights_size) +
+                         lxt_arena_size(imports_size) +
+                         lxt_arena_size(container_symbols_size) +
+                         lxt_arena_size(generator_symbols_size) +
+                         lxt_arena_size(literals_size)) != 0) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    // the template must be the first allocation, as releasing the
+    // template memory releases the entire arena
+    struct lxt_template * const result =
+        lxt_arena_alloc(&arena, sizeof(struct lxt_template));
+    
+    struct lxt_container * const containers =
+        lxt_arena_alloc(&arena, containers_size);
+    struct lxt_generator * const generators =
+        lxt_arena_alloc(&arena, generators_size);
+    struct lxt_span * const entries =
+        lxt_arena_alloc(&arena, entries_size);
+    struct lxt_op * const ops =
+        lxt_arena_alloc(&arena, ops_size);
+    struct lxt_weight * const weights =
+        lxt_arena_alloc(&arena, weights_size);
+    struct lxt_import * const imports =
+        lxt_arena_alloc(&arena, imports_size);
+    struct lxt_symbol * const container_symbols =
+        lxt_arena_alloc(&arena, container_symbols_size);
+    struct lxt_symbol * const generator_symbols =
+        lxt_arena_alloc(&arena, generator_symbols_size);
+    char * const literals =
+        lxt_arena_alloc(&arena, literals_size);
+    
+    if (containers_size > 0) {
+        memcpy(containers, source->containers, containers_size);
+    }
+    
+    if (generators_size > 0) {
+        memcpy(generators, optimizer->generators, generators_size);
+    }
+    
+    if (entries_size > 0) {
+        memcpy(entries, source->entries, entries_size);
+    }
+    
+    if (ops_size > 0) {
+        memcpy(ops, optimizer->ops.items, ops_size);
+    }
+    
+    if (weights_size > 0) {
+        memcpy(weights, source->weights, weights_size);
+    }
+    
+    if (imports_size > 0) {
+        memcpy(imports, source->imports, imports_size);
+    }
+    
+    if (literals_size > 0) {
+        memcpy(literals, optimizer->literals.data, literals_size);
+    }
+    
+    memcpy(container_symbols, source->container_symbols.slots,
+           container_symbols_size);
+    memcpy(generator_symbols, source->generator_symbols.slots,
+           generator_symbols_size);
+    
+    *result = *source;
+    
+    result->containers = containers;
+    result->generators = generators;
+    result->entries = entries;
+    result->ops = ops;
+    result->weights = weights;
+    result->imports = imports;
+    result->literals = literals;
+    result->container_symbols.slots = container_symbols;
+    result->generator_symbols.slots = generator_symbols;
+    result->op_count = (uint32_t)optimizer->ops.count;
+    result->literal_length = (uint32_t)literals_size;
+    
+    *template = result;
+    
+    return LXT_ERROR_NONE;
+}
@@ -0,0 +1,292 @@
+#if !defined(_WIN32)
+ #define _POSIX_C_SOURCE 200809L // sysconf
+#endif
+
+#include <lext/lext.h> // lxt_batch, lxt_gen_batch, lxt_gen_batch_parallel
+
+#include "rand.h" // LXT_RNG_DEFAULT_SEED
+#include "batch.h" // lxt_gen_batch_split
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint64_t, int64_t
+#include <stdbool.h> // bool
+#include <stdlib.h> // calloc, free
+#include <string.h> // memcpy
+
+#if defined(LXT_PTHREADS)
+ #include <pthread.h> // pthread_*
+ #include <unistd.h> // sysconf
+#endif
+
+// the number of results that a job claims at a time
+#define CHUNK_SIZE (1024)
+
+/**
+ * Represents the shared state of a parallel batch.
+ *
+ * Results are split into chunks that are each generated into a separate
+ * batch. Jobs claim the next unclaimed chunk until no chunks remain, so
+ * that faster jobs pick up the slack of slower ones.
+ */
+struct lxt_work {
+    struct lxt_template const * template;
+    struct lxt_batch * chunks;
+    struct lxt_opts options;
+    uint64_t first;
+    size_t count;
+    size_t chunk_count;
+    size_t next_chunk;
+    struct lxt_rng rng;
+    enum lxt_error error;
+#if defined(LXT_PTHREADS)
+    pthread_mutex_t lock;
+#endif
+};
+
+/**
+ * Claim the next chunk of work.
+ *
+ * Returns false if there is no more work.
+ */
+static bool lxt_work_claim(struct lxt_work *, size_t * chunk);
+static void lxt_work_fail(struct lxt_work *, enum lxt_error);
+/**
+ * Generate chunks until there is no more work.
+ */
+static void * lxt_work_run(void * work);
+/**
+ * Generate the results of a chunk into its batch.
+ */
+static enum lxt_error lxt_work_chunk(struct lxt_work const *, size_t chunk);
+
+static uint32_t lxt_processor_count(void);
+
+
+enum lxt_error
+lxt_gen_batch_parallel(struct lxt_batch * const batch,
+                       uint64_t const first,
+                       size_t const count,
+                       struct lxt_template const * const template,
+                       struct lxt_opts const options,
+                       uint32_t jobs)
+{
+    struct lxt_work work;
+    
+    work.template = template;
+    work.options = options;
+    work.first = first;
+    work.count = count;
+    work.chunk_count = (count + (CHUNK_SIZE - 1)) / CHUNK_SIZE;
+    work.next_chunk = 0;
+    work.error = LXT_ERROR_NONE;
+    
+    if (options.rng != NULL) {
+        if (options.rng->kind == LXT_RNG_CUSTOM) {
+            // custom generators can not be split into independent streams
+            return LXT_ERROR_UNSUPPORTED;
+        }
+        
+        work.rng = *options.rng;
+    } else if (options.seed != NULL) {
+        lxt_rng_init_xorshift32(&work.rng, *options.seed);
+    } else {
+        lxt_rng_init(&work.rng, LXT_RNG_DEFAULT_SEED, 0);
+    }
+    
+    if (work.chunk_count == 0) {
+        return lxt_batch_reserve(batch, batch->count, batch->capacity);
+    }
+    
+    if (jobs == 0) {
+        jobs = lxt_processor_count();
+    }
+    
+    if (jobs > work.chunk_count) {
+        jobs = (uint32_t)work.chunk_count;
+    }
+    
+    if (jobs == 1) {
+        // nothing to split between jobs; generate straight into the batch
+        return lxt_gen_batch_split(batch, &work.rng, first, count,
+                                   template, options);
+    }
+    
+    work.chunks = calloc(work.chunk_count, sizeof(struct lxt_batch));
+    
+    if (work.chunks == NULL) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+
+#if defined(LXT_PTHREADS)
+    pthread_mutex_init(&work.lock, NULL);
+    
+    pthread_t * const threads = calloc(jobs, sizeof(pthread_t));
+    
+    uint32_t started = 0;
+    
+    if (threads != NULL) {
+        // the calling thread is one of the jobs, so start one less
+        while (started + 1 < jobs &&
+               pthread_create(&threads[started], NULL,
+                              lxt_work_run, &work) == 0) {
+            started += 1;
+        }
+    }
+    
+    lxt_work_run(&work);
+    
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    free(threads);
+    
+    pthread_mutex_destroy(&work.lock);
+#else
+    lxt_work_run(&work);
+#endif
+    
+    enum lxt_error error = work.error;
+    
+    if (error == LXT_ERROR_NONE) {
+        // move the chunks, in order, to the end of the batch
+        size_t length = 0;
+        
+        for (size_t i = 0; i < work.chunk_count; i++) {
+            length += (size_t)work.chunks[i].offsets[work.chunks[i].count];
+        }
+        
+        error = lxt_batch_reserve(batch, batch->count + count, 0);
+        
+        size_t offset = 0;
+        
+        if (error == LXT_ERROR_NONE) {
+            offset = (size_t)batch->offsets[batch->count];
+            
+            error = lxt_batch_reserve(batch, batch->count + count,
+                                      offset + length);
+        }
+        
+        for (size_t i = 0; i < work.chunk_count; i++) {
+            if (error != LXT_ERROR_NONE) {
+                break;
+            }
+            
+            struct lxt_batch const * const chunk = &work.chunks[i];
+            
+            size_t const chunk_length = (size_t)chunk->offsets[chunk->count];
+            
+            memcpy(batch->data + offset, chunk->data, chunk_length);
+            
+            for (size_t k = 0; k < chunk->count; k++) {
+                batch->count += 1;
+                batch->offsets[batch->count] =
+                    (int64_t)offset + chunk->offsets[k + 1];
+            }
+            
+            offset += chunk_length;
+        }
+    }
+    
+    for (size_t i = 0; i < work.chunk_count; i++) {
+        lxt_batch_free(&work.chunks[i]);
+    }
+    
+    free(work.chunks);
+    
+    return error;
+}
+
+static
+bool
+lxt_work_claim(struct lxt_work * const work,
+               size_t * const chunk)
+{
+    bool claimed = false;
+
+#if defined(LXT_PTHREADS)
+    pthread_mutex_lock(&work->lock);
+#endif
+    
+    if (work->error == LXT_ERROR_NONE &&
+        work->next_chunk < work->chunk_count) {
+        *chunk = work->next_chunk;
+        
+        work->next_chunk += 1;
+        
+        claimed = true;
+    }
+
+#if defined(LXT_PTHREADS)
+    pthread_mutex_unlock(&work->lock);
+#endif
+    
+    return claimed;
+}
+
+static
+void
+lxt_work_fail(struct lxt_work * const work,
+              enum lxt_error const error)
+{
+#if defined(LXT_PTHREADS)
+    pthread_mutex_lock(&work->lock);
+#endif
+    
+    if (work->error == LXT_ERROR_NONE) {
+        work->error = error;
+    }
+
+#if defined(LXT_PTHREADS)
+    pthread_mutex_unlock(&work->lock);
+#endif
+}
+
+static
+void *
+lxt_work_run(void * const context)
+{
+    struct lxt_work * const work = context;
+    
+    size_t chunk;
+    
+    while (lxt_work_claim(work, &chunk)) {
+        enum lxt_error const error = lxt_work_chunk(work, chunk);
+        
+        if (error != LXT_ERROR_NONE) {
+            lxt_work_fail(work, error);
+        }
+    }
+    
+    return NULL;
+}
+
+static
+enum lxt_error
+lxt_work_chunk(struct lxt_work const * const work,
+               size_t const chunk)
+{
+    struct lxt_batch * const batch = &work->chunks[chunk];
+    
+    size_t const start = chunk * CHUNK_SIZE;
+    size_t const end = start + CHUNK_SIZE < work->count ?
+        start + CHUNK_SIZE : work->count;
+    
+    return lxt_gen_batch_split(batch, &work->rng, work->first + start,
+                               end - start, work->template, work->options);
+}
+
+static
+uint32_t
+lxt_processor_count(void)
+{
+#if defined(LXT_PTHREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long const count = sysconf(_SC_NPROCESSORS_ONLN);
+    
+    if (count > 0) {
+        return (uint32_t)count;
+    }
+#endif
+    
+    return 1;
+}
@@ -0,0 +1,203 @@
+#include <lext/lext.h> // lxt_rng, lxt_rng_*, lxt_error
+
+#include "rand.h" // lxt_rand*
+
+#include <stdint.h> // uint32_t, uint64_t
+#include <stddef.h> // NULL
+
+extern inline uint32_t lxt_rand32(uint32_t * seed);
+extern inline uint32_t lxt_rand32_seed(uint32_t seed, uint64_t index);
+extern inline uint32_t lxt_rand_pcg32(struct lxt_rng * rng);
+extern inline uint32_t lxt_rand_next(struct lxt_rng * rng);
+extern inline uint32_t lxt_rand_bounded(struct lxt_rng * rng, uint32_t bound);
+
+#define PCG32_MULTIPLIER (6364136223846793005ULL)
+
+/**
+ * Mix the bits of a number such that similar numbers become dissimilar.
+ */
+static uint64_t lxt_rand_mix(uint64_t);
+
+void
+lxt_rng_init(struct lxt_rng * const rng,
+             uint64_t const seed,
+             uint64_t const stream)
+{
+    rng->kind = LXT_RNG_PCG32;
+    rng->state = 0;
+    rng->increment = (stream << 1) | 1;
+    rng->next = NULL;
+    rng->context = NULL;
+    
+    lxt_rand_pcg32(rng);
+    
+    rng->state += seed;
+    
+    lxt_rand_pcg32(rng);
+}
+
+void
+lxt_rng_init_xorshift32(struct lxt_rng * const rng,
+                        uint32_t const seed)
+{
+    rng->kind = LXT_RNG_XORSHIFT32;
+    rng->state = seed;
+    rng->increment = 0;
+    rng->next = NULL;
+    rng->context = NULL;
+}
+
+void
+lxt_rng_init_custom(struct lxt_rng * const rng,
+                    uint32_t (* const next)(void *),
+                    void * const context)
+{
+    rng->kind = LXT_RNG_CUSTOM;
+    rng->state = 0;
+    rng->increment = 0;
+    rng->next = next;
+    rng->context = context;
+}
+
+enum lxt_error
+lxt_rng_split(struct lxt_rng * const rng,
+              struct lxt_rng const * const other,
+              uint64_t const stream)
+{
+    switch (other->kind) {
+        case LXT_RNG_PCG32: {
+            // seed from both state and stream, as streams of the same state
+            // are otherwise correlated
+            lxt_rng_init(rng,
+                         lxt_rand_mix(other->state ^ lxt_rand_mix(stream)),
+                         stream ^ (other->increment >> 1));
+        } break;
+        
+        case LXT_RNG_XORSHIFT32: {
+            lxt_rng_init_xorshift32(rng,
+                                    lxt_rand32_seed((uint32_t)other->state,
+                                                    stream));
+        } break;
+        
+        case LXT_RNG_CUSTOM:
+        default:
+            return LXT_ERROR_UNSUPPORTED;
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+void
+lxt_rng_advance(struct lxt_rng * const rng,
+                uint64_t count)
+{
+    if (rng->kind != LXT_RNG_PCG32) {
+        while (count > 0) {
+            lxt_rand_next(rng);
+            
+            count -= 1;
+        }
+        
+        return;
+    }
+    
+    // jump ahead by composing the affine step with itself in O(log n);
+    // see Brown, "Random Number Generation with Arbitrary Stride" (1994)
+    uint64_t multiplier = PCG32_MULTIPLIER;
+    uint64_t increment = rng->increment;
+    
+    uint64_t total_multiplier = 1;
+    uint64_t total_increment = 0;
+    
+    while (count > 0) {
+        if (count & 1) {
+            total_multiplier *= multiplier;
+            total_increment = total_increment * multiplier + increment;
+        }
+        
+        increment = (multiplier + 1) * increment;
+        multiplier *= multiplier;
+        
+        count >>= 1;
+    }
+    
+    rng->state = total_multiplier * rng->state + total_increment;
+}
+
+uint32_t
+lxt_rng_next(struct lxt_rng * const rng)
+{
+    return lxt_rand_next(rng);
+}
+
+uint32_t
+lxt_rng_bounded(struct lxt_rng * const rng,
+                uint32_t const bound)
+{
+    if (bound == 0) {
+        return 0;
+    }
+    
+    return lxt_rand_bounded(rng, bound);
+}
+
+void
+lxt_permutation_init(struct lxt_permutation * const permutation,
+                     uint64_t const count,
+                     struct lxt_rng * const rng)
+{
+    uint32_t half_bits = 1;
+    
+    // find the smallest even number of bits that holds every number
+    while (half_bits < 32 && (1ULL << (half_bits * 2)) < count) {
+        half_bits += 1;
+    }
+    
+    for (uint32_t i = 0; i < LXT_PERMUTATION_ROUNDS; i++) {
+        uint64_t const high = lxt_rand_next(rng);
+        uint64_t const low = lxt_rand_next(rng);
+        
+        permutation->keys[i] = (high << 32) | low;
+    }
+    
+    permutation->count = count;
+    permutation->mask = (1ULL << half_bits) - 1;
+    permutation->half_bits = half_bits;
+}
+
+uint64_t
+lxt_permute(struct lxt_permutation const * const permutation,
+            uint64_t const index)
+{
+    uint64_t const mask = permutation->mask;
+    
+    uint64_t x = index;
+    
+    do {
+        uint64_t left = x >> permutation->half_bits;
+        uint64_t right = x & mask;
+        
+        for (uint32_t i = 0; i < LXT_PERMUTATION_ROUNDS; i++) {
+            uint64_t const next =
+                left ^ (lxt_rand_mix(right ^ permutation->keys[i]) & mask);
+            
+            left = right;
+            right = next;
+        }
+        
+        x = (left << permutation->half_bits) | right;
+    } while (x >= permutation->count);
+    
+    return x;
+}
+
+static
+uint64_t
+lxt_rand_mix(uint64_t z)
+{
+    // finalizer of SplitMix64
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    
+    return z ^ (z >> 31);
+}
@@ -1,6 +1,13 @@
 #pragma once
 
-#include <stdint.h> // uint32_t
+#include <lext/lext.h> // lxt_rng, lxt_rng_kind
+
+#include <stdint.h> // uint32_t, uint64_t
+
+/**
+ * The seed of generators when no seed or generator is specified.
+ */
+#define LXT_RNG_DEFAULT_SEED (2147483647)
 
 inline
 uint32_t
@@ -16,3 +23,131 @@ lxt_rand32(uint32_t * const seed)
     
     return (x & 0xffffffffUL);
 }
+
+/**
+ * Derive a seed for the result at an index from a base seed.
+ *
+ * Derived seeds are well distributed even for consecutive indices,
+ * and are never 0 (which would make the generator produce only zeros).
+ */
+inline
+uint32_t
+lxt_rand32_seed(uint32_t const seed,
+                uint64_t const index)
+{
+    // finalizer of SplitMix64
+    uint64_t z = ((uint64_t)seed << 32) + (index + 1) * 0x9e3779b97f4a7c15ULL;
+    
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z = z ^ (z >> 31);
+    
+    uint32_t const derived = (uint32_t)(z >> 32);
+    
+    return derived != 0 ? derived : 1;
+}
+
+inline
+uint32_t
+lxt_rand_pcg32(struct lxt_rng * const rng)
+{
+    uint64_t const state = rng->state;
+    
+    rng->state = state * 6364136223846793005ULL + rng->increment;
+    
+    uint32_t const xorshifted = (uint32_t)(((state >> 18) ^ state) >> 27);
+    uint32_t const rotation = (uint32_t)(state >> 59);
+    
+    return (xorshifted >> rotation) | (xorshifted << ((0U - rotation) & 31));
+}
+
+/**
+ * Get the next random number of a generator.
+ */
+inline
+uint32_t
+lxt_rand_next(struct lxt_rng * const rng)
+{
+    switch (rng->kind) {
+        case LXT_RNG_XORSHIFT32: {
+            uint32_t seed = (uint32_t)rng->state;
+            uint32_t const x = lxt_rand32(&seed);
+            
+            rng->state = seed;
+            
+            return x;
+        }
+        
+        case LXT_RNG_CUSTOM:
+            return rng->next(rng->context);
+        
+        case LXT_RNG_PCG32:
+        default:
+            break;
+    }
+    
+    return lxt_rand_pcg32(rng);
+}
+
+/**
+ * Get a random number in the range [0, bound) from a generator.
+ *
+ * Uses the nearly divisionless method of Lemire (2019); a division is only
+ * needed when the first draw lands in the small, biased part of the range.
+ */
+inline
+uint32_t
+lxt_rand_bounded(struct lxt_rng * const rng,
+                 uint32_t const bound)
+{
+    if (rng->kind == LXT_RNG_XORSHIFT32) {
+        // reduce as earlier versions did, biased or not, such that seeds
+        // keep reproducing the same results
+        return lxt_rand_next(rng) % bound;
+    }
+    
+    uint64_t m = (uint64_t)lxt_rand_next(rng) * bound;
+    uint32_t low = (uint32_t)m;
+    
+    if (low < bound) {
+        uint32_t const threshold = (0U - bound) % bound;
+        
+        while (low < threshold) {
+            m = (uint64_t)lxt_rand_next(rng) * bound;
+            low = (uint32_t)m;
+        }
+    }
+    
+    return (uint32_t)(m >> 32);
+}
+
+#define LXT_PERMUTATION_ROUNDS (4)
+
+/**
+ * Represents a pseudo-random permutation of the numbers in [0, count).
+ *
+ * Numbers are permuted by a balanced Feistel network over the smallest
+ * even number of bits that holds every number, keyed by a random number
+ * generator. Numbers that are permuted beyond the count are permuted
+ * again until they are not (cycle-walking), such that the permutation
+ * never leaves its range.
+ */
+struct lxt_permutation {
+    uint64_t keys[LXT_PERMUTATION_ROUNDS];
+    uint64_t count;
+    uint64_t mask;
+    uint32_t half_bits;
+};
+
+/**
+ * Initialize a permutation of the numbers in [0, count), keyed by drawing
+ * from a random number generator.
+ */
+void lxt_permutation_init(struct lxt_permutation *,
+                          uint64_t count,
+                          struct lxt_rng * rng);
+/**
+ * Get the number that a number in [0, count) is permuted to.
+ */
+uint64_t lxt_permute(struct lxt_permutation const *,
+                     uint64_t index);
@@ -0,0 +1,1014 @@
+#if !defined(_WIN32)
+ #define _POSIX_C_SOURCE 200809L // stat, st_mtim, clock_gettime
+#endif
+
+#include <lext/lext.h> // lxt_registry, lxt_reader, lxt_registry_*, lxt_reader_*, lxt_library_*
+
+#include "library.h" // lxt_library, lxt_lines, lxt_compile_file
+#include "arena.h" // lxt_list, lxt_list_push, lxt_list_free
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint64_t
+#include <stdbool.h> // bool, true, false
+#include <stdlib.h> // malloc, calloc, free
+#include <string.h> // strcmp, strlen, memcmp, memcpy, memset
+#include <sys/stat.h> // stat
+
+#if defined(LXT_PTHREADS)
+ #include <pthread.h> // pthread_*
+ #include <time.h> // clock_gettime, timespec
+ #include <errno.h> // ETIMEDOUT
+#endif
+
+#if defined(__GNUC__)
+ // readers and writers only meet through atomic loads and stores
+ #define LXT_ATOMICS
+ #define lxt_atomic_load(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+ #define lxt_atomic_store(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+ #define lxt_atomic_exchange(p, v) \
+    __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+ #define lxt_atomic_increment(p) __atomic_fetch_add((p), 1, __ATOMIC_SEQ_CST)
+ #define lxt_atomic_claim(p, expected, v) \
+    __atomic_compare_exchange_n((p), (expected), (v), false, \
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#endif
+
+/**
+ * Represents the state of a file when its template was last compiled.
+ */
+struct lxt_stamp {
+    int64_t seconds;
+    int64_t nanoseconds;
+    int64_t size;
+    uint64_t inode;
+};
+
+/**
+ * Represents a lines file that a template of a registry was compiled from.
+ */
+struct lxt_linked {
+    /**
+     * The index of the file in the library of the registry.
+     */
+    size_t index;
+    /**
+     * The state of the file when the template was compiled.
+     */
+    struct lxt_stamp stamp;
+};
+
+/**
+ * Represents a named template of a registry.
+ *
+ * The current version of the template is swapped atomically on reload;
+ * readers never see a template that is only partially published.
+ */
+struct lxt_entry {
+    char * name;
+    char * filename;
+    struct lxt_template * current;
+    /**
+     * The state of the file when last compiled; only used by writers.
+     */
+    struct lxt_stamp stamp;
+    /**
+     * The lines files that the template was last compiled from; only used
+     * by writers.
+     */
+    struct lxt_list lines;
+    /**
+     * The next entry; entries are only ever appended.
+     */
+    struct lxt_entry * next;
+};
+
+/**
+ * Represents a template that was replaced, but may still be in use.
+ */
+struct lxt_retired {
+    struct lxt_template * template;
+    /**
+     * The epoch that the template was replaced in; only readers that
+     * entered during or before this epoch can still be using it.
+     */
+    uint64_t epoch;
+};
+
+struct lxt_reader {
+    struct lxt_registry * registry;
+    /**
+     * The epoch that the reader entered in, or 0 if it is not reading.
+     */
+    uint64_t epoch;
+    /**
+     * Whether the reader is claimed by a thread; released readers are
+     * reused rather than freed.
+     */
+    uint32_t claimed;
+    /**
+     * The next reader; readers are only ever prepended.
+     */
+    struct lxt_reader * next;
+};
+
+struct lxt_registry {
+    struct lxt_entry * entries;
+    struct lxt_entry * last;
+    struct lxt_reader * readers;
+    /**
+     * The current epoch, starting from 1; advanced whenever a template is
+     * replaced.
+     */
+    uint64_t epoch;
+    /**
+     * Templates waiting for every reader that may use them to leave.
+     */
+    struct lxt_list retired;
+    /**
+     * The lines files that templates can use, or NULL if none; only used
+     * by writers.
+     *
+     * Every template reads its own copy of the files it uses, such that a
+     * file can change while a template using it exists.
+     */
+    struct lxt_library * library;
+#if defined(LXT_PTHREADS)
+    /**
+     * Serializes writers, such that only one reload runs at a time; readers
+     * never take it.
+     */
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_t watcher;
+    uint32_t interval;
+    bool watching;
+    bool stopping;
+#endif
+};
+
+#if defined(LXT_ATOMICS)
+
+/**
+ * Get the state of a file.
+ */
+static enum lxt_error lxt_stamp_file(struct lxt_stamp *,
+                                     char const * filename);
+/**
+ * Get the state of every lines file of a registry, in the order they were
+ * added; files that can not be found are stamped as all zeros.
+ */
+static enum lxt_error lxt_stamp_lines(struct lxt_stamp ** stamps,
+                                      struct lxt_registry const *);
+/**
+ * Compile the template of an entry, keeping the lines files that it uses,
+ * as stamped before compiling, in linked.
+ *
+ * Lines files are kept even if compiling fails.
+ */
+static enum lxt_error lxt_registry_compile(struct lxt_template **,
+                                           struct lxt_list * linked,
+                                           struct lxt_registry *,
+                                           struct lxt_entry const *,
+                                           struct lxt_stamp const * stamps);
+/**
+ * Determine whether any lines file that the template of an entry was
+ * compiled from has changed.
+ */
+static bool lxt_lines_changed(struct lxt_entry const *,
+                              struct lxt_stamp const * stamps);
+/**
+ * Add lines files to those of an entry, replacing the state of any that
+ * it already has.
+ */
+static void lxt_lines_merge(struct lxt_entry *,
+                            struct lxt_list const * linked);
+/**
+ * Recompile the template of every entry whose file has changed, and
+ * publish the new templates.
+ *
+ * Writers must be serialized by the caller.
+ */
+static enum lxt_error lxt_registry_reload(struct lxt_registry *);
+/**
+ * Release every retired template that no reader can be using anymore.
+ */
+static void lxt_registry_reclaim(struct lxt_registry *);
+/**
+ * Copy a string into newly allocated memory.
+ */
+static char * lxt_registry_copy(char const *);
+
+static void lxt_registry_lock(struct lxt_registry *);
+static void lxt_registry_unlock(struct lxt_registry *);
+
+#if defined(LXT_PTHREADS)
+/**
+ * Poll the files of a registry at an interval, until stopped.
+ */
+static void * lxt_registry_watcher(void * registry);
+#endif
+
+enum lxt_error
+lxt_registry_create(struct lxt_registry ** const registry)
+{
+    *registry = calloc(1, sizeof(struct lxt_registry));
+    
+    if (*registry == NULL) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    (*registry)->epoch = 1;
+
+#if defined(LXT_PTHREADS)
+    if (pthread_mutex_init(&(*registry)->mutex, NULL) != 0) {
+        free(*registry);
+        
+        *registry = NULL;
+        
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    if (pthread_cond_init(&(*registry)->wake, NULL) != 0) {
+        pthread_mutex_destroy(&(*registry)->mutex);
+        
+        free(*registry);
+        
+        *registry = NULL;
+        
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+#endif
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_registry_add(struct lxt_registry * const registry,
+                 char const * const name,
+                 char const * const filename)
+{
+    struct lxt_entry * const entry = calloc(1, sizeof(struct lxt_entry));
+    
+    if (entry == NULL) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    entry->name = lxt_registry_copy(name);
+    entry->filename = lxt_registry_copy(filename);
+    
+    enum lxt_error error = LXT_ERROR_NONE;
+    
+    if (entry->name == NULL || entry->filename == NULL) {
+        error = LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    if (error == LXT_ERROR_NONE) {
+        error = lxt_stamp_file(&entry->stamp, filename);
+    }
+    
+    // the lines files of the registry are only used by one writer at a time
+    lxt_registry_lock(registry);
+    
+    struct lxt_stamp * stamps = NULL;
+    
+    if (error == LXT_ERROR_NONE) {
+        error = lxt_stamp_lines(&stamps, registry);
+    }
+    
+    if (error == LXT_ERROR_NONE) {
+        // the files are stamped first, such that any change made while
+        // compiling is picked up by the next reload
+        error = lxt_registry_compile(&entry->current, &entry->lines,
+                                     registry, entry, stamps);
+    }
+    
+    free(stamps);
+    
+    if (error != LXT_ERROR_NONE) {
+        lxt_registry_unlock(registry);
+        
+        lxt_list_free(&entry->lines);
+        
+        free(entry->name);
+        free(entry->filename);
+        free(entry);
+        
+        return error;
+    }
+    
+    // the entry is complete before it is linked, so readers that find it
+    // always find its first template
+    if (registry->last == NULL) {
+        lxt_atomic_store(&registry->entries, entry);
+    } else {
+        lxt_atomic_store(&registry->last->next, entry);
+    }
+    
+    registry->last = entry;
+    
+    lxt_registry_unlock(registry);
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_registry_add_lines(struct lxt_registry * const registry,
+                       char const * const name,
+                       char const * const filename)
+{
+    lxt_registry_lock(registry);
+    
+    enum lxt_error error = LXT_ERROR_NONE;
+    
+    if (registry->library == NULL) {
+        error = lxt_library_create(&registry->library);
+        
+        if (error == LXT_ERROR_NONE) {
+            registry->library->copies_lines = true;
+        }
+    }
+    
+    if (error == LXT_ERROR_NONE) {
+        error = lxt_library_add_lines(registry->library, name, filename);
+    }
+    
+    lxt_registry_unlock(registry);
+    
+    return error;
+}
+
+enum lxt_error
+lxt_registry_poll(struct lxt_registry * const registry)
+{
+    lxt_registry_lock(registry);
+    
+    enum lxt_error const error = lxt_registry_reload(registry);
+    
+    lxt_registry_unlock(registry);
+    
+    return error;
+}
+
+enum lxt_error
+lxt_registry_watch(struct lxt_registry * const registry,
+                   uint32_t const interval)
+{
+#if defined(LXT_PTHREADS)
+    if (interval == 0) {
+        // the watcher would never wait, and keep the lock to itself
+        return LXT_ERROR_OUT_OF_RANGE;
+    }
+    
+    lxt_registry_lock(registry);
+    
+    if (registry->watching) {
+        registry->interval = interval;
+        
+        lxt_registry_unlock(registry);
+        
+        return LXT_ERROR_NONE;
+    }
+    
+    registry->interval = interval;
+    registry->stopping = false;
+    
+    if (pthread_create(&registry->watcher, NULL,
+                       lxt_registry_watcher, registry) != 0) {
+        lxt_registry_unlock(registry);
+        
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    registry->watching = true;
+    
+    lxt_registry_unlock(registry);
+    
+    return LXT_ERROR_NONE;
+#else
+    (void)registry;
+    (void)interval;
+    
+    return LXT_ERROR_UNSUPPORTED;
+#endif
+}
+
+void
+lxt_registry_free(struct lxt_registry * const registry)
+{
+    if (registry == NULL) {
+        return;
+    }
+
+#if defined(LXT_PTHREADS)
+    lxt_registry_lock(registry);
+    
+    bool const watching = registry->watching;
+    
+    registry->stopping = true;
+    
+    pthread_cond_signal(&registry->wake);
+    
+    lxt_registry_unlock(registry);
+    
+    if (watching) {
+        pthread_join(registry->watcher, NULL);
+    }
+    
+    pthread_cond_destroy(&registry->wake);
+    pthread_mutex_destroy(&registry->mutex);
+#endif
+    
+    struct lxt_entry * entry = registry->entries;
+    
+    while (entry != NULL) {
+        struct lxt_entry * const next = entry->next;
+        
+        lxt_free(entry->current);
+        
+        lxt_list_free(&entry->lines);
+        
+        free(entry->name);
+        free(entry->filename);
+        free(entry);
+        
+        entry = next;
+    }
+    
+    struct lxt_reader * reader = registry->readers;
+    
+    while (reader != NULL) {
+        struct lxt_reader * const next = reader->next;
+        
+        free(reader);
+        
+        reader = next;
+    }
+    
+    struct lxt_retired * const retired =
+        (struct lxt_retired *)registry->retired.items;
+    
+    for (size_t i = 0; i < registry->retired.count; i++) {
+        lxt_free(retired[i].template);
+    }
+    
+    lxt_list_free(&registry->retired);
+    
+    lxt_library_free(registry->library);
+    
+    free(registry);
+}
+
+enum lxt_error
+lxt_reader_create(struct lxt_reader ** const reader,
+                  struct lxt_registry * const registry)
+{
+    *reader = NULL;
+    
+    // reuse a released reader if there is one
+    for (struct lxt_reader * other = lxt_atomic_load(&registry->readers);
+         other != NULL;
+         other = other->next) {
+        uint32_t expected = 0;
+        
+        if (lxt_atomic_claim(&other->claimed, &expected, 1)) {
+            *reader = other;
+            
+            return LXT_ERROR_NONE;
+        }
+    }
+    
+    struct lxt_reader * const created = calloc(1, sizeof(struct lxt_reader));
+    
+    if (created == NULL) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    created->registry = registry;
+    created->claimed = 1;
+    created->next = lxt_atomic_load(&registry->readers);
+    
+    // prepend without a lock; retry if another reader got there first
+    while (!lxt_atomic_claim(&registry->readers, &created->next, created)) {
+        continue;
+    }
+    
+    *reader = created;
+    
+    return LXT_ERROR_NONE;
+}
+
+struct lxt_template const *
+lxt_reader_acquire(struct lxt_reader * const reader,
+                   char const * const name)
+{
+    struct lxt_registry * const registry = reader->registry;
+    
+    if (reader->epoch == 0) {
+        // announce the epoch before loading any template; a writer that
+        // replaces a template after this keeps it until the reader leaves
+        lxt_atomic_store(&reader->epoch, lxt_atomic_load(&registry->epoch));
+    }
+    
+    for (struct lxt_entry * entry = lxt_atomic_load(&registry->entries);
+         entry != NULL;
+         entry = lxt_atomic_load(&entry->next)) {
+        if (strcmp(entry->name, name) == 0) {
+            return lxt_atomic_load(&entry->current);
+        }
+    }
+    
+    return NULL;
+}
+
+void
+lxt_reader_release(struct lxt_reader * const reader)
+{
+    lxt_atomic_store(&reader->epoch, 0);
+}
+
+void
+lxt_reader_free(struct lxt_reader * const reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+    
+    lxt_reader_release(reader);
+    
+    lxt_atomic_store(&reader->claimed, 0);
+}
+
+static
+enum lxt_error
+lxt_stamp_file(struct lxt_stamp * const stamp,
+               char const * const filename)
+{
+    struct stat status;
+    
+    if (stat(filename, &status) != 0) {
+        return LXT_ERROR_READ_FAILED;
+    }
+    
+    memset(stamp, 0, sizeof(*stamp));
+    
+    stamp->seconds = (int64_t)status.st_mtime;
+    stamp->size = (int64_t)status.st_size;
+
+#if defined(__APPLE__)
+    stamp->nanoseconds = (int64_t)status.st_mtimespec.tv_nsec;
+    stamp->inode = (uint64_t)status.st_ino;
+#elif !defined(_WIN32)
+    // files written within the same second are told apart by nanoseconds,
+    // and files replaced by renaming another file by their inode
+    stamp->nanoseconds = (int64_t)status.st_mtim.tv_nsec;
+    stamp->inode = (uint64_t)status.st_ino;
+#endif
+    
+    return LXT_ERROR_NONE;
+}
+
+static
+enum lxt_error
+lxt_stamp_lines(struct lxt_stamp ** const stamps,
+                struct lxt_registry const * const registry)
+{
+    *stamps = NULL;
+    
+    if (registry->library == NULL) {
+        return LXT_ERROR_NONE;
+    }
+    
+    size_t const count = registry->library->lines.count;
+    
+    *stamps = calloc(count, sizeof(struct lxt_stamp));
+    
+    if (*stamps == NULL) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    struct lxt_lines const * const lines =
+        (struct lxt_lines const *)registry->library->lines.items;
+    
+    for (size_t i = 0; i < count; i++) {
+        if (lxt_stamp_file(&(*stamps)[i], lines[i].filename) !=
+            LXT_ERROR_NONE) {
+            // a file that appears later is a change like any other
+            memset(&(*stamps)[i], 0, sizeof(struct lxt_stamp));
+        }
+    }
+    
+    return LXT_ERROR_NONE;
+}
+
+static
+enum lxt_error
+lxt_registry_compile(struct lxt_template ** const template,
+                     struct lxt_list * const linked,
+                     struct lxt_registry * const registry,
+                     struct lxt_entry const * const entry,
+                     struct lxt_stamp const * const stamps)
+{
+    struct lxt_library * const library = registry->library;
+    
+    if (library == NULL) {
+        return lxt_compile_file(template, entry->filename, NULL);
+    }
+    
+    struct lxt_lines * const lines = (struct lxt_lines *)library->lines.items;
+    
+    for (size_t i = 0; i < library->lines.count; i++) {
+        lines[i].used = false;
+    }
+    
+    enum lxt_error const error =
+        lxt_compile_file(template, entry->filename, library);
+    
+    for (size_t i = 0; i < library->lines.count; i++) {
+        if (!lines[i].used) {
+            continue;
+        }
+        
+        struct lxt_linked const file = {
+            .index = i,
+            .stamp = stamps[i]
+        };
+        
+        if (lxt_list_push(linked, &file, sizeof(file)) == NULL) {
+            lxt_free(*template);
+            
+            *template = NULL;
+            
+            return LXT_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    return error;
+}
+
+static
+bool
+lxt_lines_changed(struct lxt_entry const * const entry,
+                  struct lxt_stamp const * const stamps)
+{
+    struct lxt_linked const * const linked =
+        (struct lxt_linked const *)entry->lines.items;
+    
+    for (size_t i = 0; i < entry->lines.count; i++) {
+        if (memcmp(&linked[i].stamp, &stamps[linked[i].index],
+                   sizeof(struct lxt_stamp)) != 0) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static
+void
+lxt_lines_merge(struct lxt_entry * const entry,
+                struct lxt_list const * const linked)
+{
+    struct lxt_linked const * const files =
+        (struct lxt_linked const *)linked->items;
+    
+    for (size_t i = 0; i < linked->count; i++) {
+        struct lxt_linked * const existing =
+            (struct lxt_linked *)entry->lines.items;
+        
+        size_t k = 0;
+        
+        while (k < entry->lines.count &&
+               existing[k].index != files[i].index) {
+            k += 1;
+        }
+        
+        if (k < entry->lines.count) {
+            existing[k].stamp = files[i].stamp;
+            
+            continue;
+        }
+        
+        // if out of memory, the file is not watched until the template
+        // is compiled again
+        lxt_list_push(&entry->lines, &files[i], sizeof(files[i]));
+    }
+}
+
+static
+enum lxt_error
+lxt_registry_reload(struct lxt_registry * const registry)
+{
+    struct lxt_stamp * stamps = NULL;
+    
+    enum lxt_error result = lxt_stamp_lines(&stamps, registry);
+    
+    if (result != LXT_ERROR_NONE) {
+        return result;
+    }
+    
+    for (struct lxt_entry * entry = registry->entries;
+         entry != NULL;
+         entry = entry->next) {
+        struct lxt_stamp stamp;
+        
+        enum lxt_error error = lxt_stamp_file(&stamp, entry->filename);
+        
+        if (error != LXT_ERROR_NONE) {
+            // the file may be in the middle of being replaced; try again
+            // on the next reload
+            if (result == LXT_ERROR_NONE) {
+                result = error;
+            }
+            
+            continue;
+        }
+        
+        if (memcmp(&stamp, &entry->stamp, sizeof(stamp)) == 0 &&
+            !lxt_lines_changed(entry, stamps)) {
+            // unchanged
+            continue;
+        }
+        
+        struct lxt_template * template = NULL;
+        struct lxt_list linked;
+        
+        memset(&linked, 0, sizeof(linked));
+        
+        error = lxt_registry_compile(&template, &linked,
+                                     registry, entry, stamps);
+        
+        if (error == LXT_ERROR_NONE) {
+            // make room to retire the replaced template up front, such that
+            // publishing can not fail halfway
+            struct lxt_retired const pending = { NULL, 0 };
+            
+            if (lxt_list_push(&registry->retired,
+                              &pending, sizeof(pending)) == NULL) {
+                lxt_free(template);
+                
+                error = LXT_ERROR_OUT_OF_MEMORY;
+            } else {
+                registry->retired.count -= 1;
+            }
+        }
+        
+        if (error != LXT_ERROR_NONE) {
+            // keep the current template; a file that fails to compile is
+            // not compiled again until it, or a lines file, changes
+            if (error != LXT_ERROR_OUT_OF_MEMORY) {
+                entry->stamp = stamp;
+                
+                lxt_lines_merge(entry, &linked);
+            }
+            
+            lxt_list_free(&linked);
+            
+            if (result == LXT_ERROR_NONE) {
+                result = error;
+            }
+            
+            continue;
+        }
+        
+        entry->stamp = stamp;
+        
+        lxt_list_free(&entry->lines);
+        
+        entry->lines = linked;
+        
+        struct lxt_template * const replaced =
+            lxt_atomic_exchange(&entry->current, template);
+        
+        // readers that entered before the epoch advances may still be
+        // using the replaced template
+        struct lxt_retired const retired = {
+            .template = replaced,
+            .epoch = lxt_atomic_increment(&registry->epoch)
+        };
+        
+        lxt_list_push(&registry->retired, &retired, sizeof(retired));
+    }
+    
+    free(stamps);
+    
+    lxt_registry_reclaim(registry);
+    
+    return result;
+}
+
+static
+void
+lxt_registry_reclaim(struct lxt_registry * const registry)
+{
+    if (registry->retired.count == 0) {
+        return;
+    }
+    
+    // the oldest epoch that any reader is still reading in
+    uint64_t oldest = UINT64_MAX;
+    
+    for (struct lxt_reader * reader = lxt_atomic_load(&registry->readers);
+         reader != NULL;
+         reader = reader->next) {
+        uint64_t const epoch = lxt_atomic_load(&reader->epoch);
+        
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    
+    struct lxt_retired * const retired =
+        (struct lxt_retired *)registry->retired.items;
+    
+    size_t kept = 0;
+    
+    for (size_t i = 0; i < registry->retired.count; i++) {
+        if (retired[i].epoch < oldest) {
+            // every reader entered after the template was replaced
+            lxt_free(retired[i].template);
+            
+            continue;
+        }
+        
+        retired[kept++] = retired[i];
+    }
+    
+    registry->retired.count = kept;
+}
+
+static
+char *
+lxt_registry_copy(char const * const string)
+{
+    size_t const length = strlen(string);
+    
+    char * const copy = malloc(length + 1);
+    
+    if (copy == NULL) {
+        return NULL;
+    }
+    
+    memcpy(copy, string, length + 1);
+    
+    return copy;
+}
+
+static
+void
+lxt_registry_lock(struct lxt_registry * const registry)
+{
+#if defined(LXT_PTHREADS)
+    pthread_mutex_lock(&registry->mutex);
+#else
+    (void)registry;
+#endif
+}
+
+static
+void
+lxt_registry_unlock(struct lxt_registry * const registry)
+{
+#if defined(LXT_PTHREADS)
+    pthread_mutex_unlock(&registry->mutex);
+#else
+    (void)registry;
+#endif
+}
+
+#if defined(LXT_PTHREADS)
+static
+void *
+lxt_registry_watcher(void * const context)
+{
+    struct lxt_registry * const registry = context;
+    
+    lxt_registry_lock(registry);
+    
+    while (!registry->stopping) {
+        struct timespec deadline;
+        
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        
+        deadline.tv_sec += registry->interval / 1000;
+        deadline.tv_nsec += (long)(registry->interval % 1000) * 1000000;
+        
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        
+        // wait out the interval, unless woken up to stop
+        while (!registry->stopping &&
+               pthread_cond_timedwait(&registry->wake, &registry->mutex,
+                                      &deadline) != ETIMEDOUT) {
+            continue;
+        }
+        
+        if (registry->stopping) {
+            break;
+        }
+        
+        // errors are left for the next change of the file to fix
+        lxt_registry_reload(registry);
+    }
+    
+    lxt_registry_unlock(registry);
+    
+    return NULL;
+}
+#endif
+
+#else
+
+// without atomic operations, templates can not be published safely
+
+enum lxt_error
+lxt_registry_create(struct lxt_registry ** const registry)
+{
+    *registry = NULL;
+    
+    return LXT_ERROR_UNSUPPORTED;
+}
+
+enum lxt_error
+lxt_registry_add(struct lxt_registry * const registry,
+                 char const * const name,
+                 char const * const filename)
+{
+    (void)registry;
+    (void)name;
+    (void)filename;
+    
+    return LXT_ERROR_UNSUPPORTED;
+}
+
+enum lxt_error
+lxt_registry_add_lines(struct lxt_registry * const registry,
+                       char const * const name,
+                       char const * const filename)
+{
+    (void)registry;
+    (void)name;
+    (void)filename;
+    
+    return LXT_ERROR_UNSUPPORTED;
+}
+
+enum lxt_error
+lxt_registry_poll(struct lxt_registry * const registry)
+{
+    (void)registry;
+    
+    return LXT_ERROR_UNSUPPORTED;
+}
+
+enum lxt_error
+lxt_registry_watch(struct lxt_registry * const registry,
+                   uint32_t const interval)
+{
+    (void)registry;
+    (void)interval;
+    
+    return LXT_ERROR_UNSUPPORTED;
+}
+
+void
+lxt_registry_free(struct lxt_registry * const registry)
+{
+    (void)registry;
+}
+
+enum lxt_error
+lxt_reader_create(struct lxt_reader ** const reader,
+                  struct lxt_registry * const registry)
+{
+    (void)registry;
+    
+    *reader = NULL;
+    
+    return LXT_ERROR_UNSUPPORTED;
+}
+
+struct lxt_template const *
+lxt_reader_acquire(struct lxt_reader * const reader,
+                   char const * const name)
+{
+    (void)reader;
+    (void)name;
+    
+    return NULL;
+}
+
+void
+lxt_reader_release(struct lxt_reader * const reader)
+{
+    (void)reader;
+}
+
+void
+lxt_reader_free(struct lxt_reader * const reader)
+{
+    (void)reader;
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include "scan.h" // lxt_class, lxt_classes, lxt_class_is, lxt_scan
+
+#include <stdint.h> // uint8_t, uint32_t
+#include <stdbool.h> // bool
+#include <stddef.h> // size_t
+
+#if defined(__AVX2__)
+ #include <immintrin.h> // _mm256_*
+ #define LXT_SCAN_BLOCK (32)
+#elif defined(__SSE2__) || defined(_M_X64)
+ #include <emmintrin.h> // _mm_*
+ #define LXT_SCAN_BLOCK (16)
+#endif
+
+extern inline bool lxt_class_is(char character, uint8_t classes);
+
+uint8_t const lxt_classes[256] = {
+    ['\t'] = LXT_CLASS_SPACE,
+    ['\n'] = LXT_CLASS_SPACE | LXT_CLASS_COMMENT_END,
+    ['\v'] = LXT_CLASS_SPACE,
+    ['\f'] = LXT_CLASS_SPACE,
+    ['\r'] = LXT_CLASS_SPACE,
+    [' '] = LXT_CLASS_SPACE,
+    ['#'] = LXT_CLASS_NAME_END,
+    ['('] = LXT_CLASS_NAME_END,
+    [')'] = LXT_CLASS_ENTRY_END,
+    [','] = LXT_CLASS_ENTRY_END,
+    ['0'] = LXT_CLASS_IDENTIFIER,
+    ['1'] = LXT_CLASS_IDENTIFIER,
+    ['2'] = LXT_CLASS_IDENTIFIER,
+    ['3'] = LXT_CLASS_IDENTIFIER,
+    ['4'] = LXT_CLASS_IDENTIFIER,
+    ['5'] = LXT_CLASS_IDENTIFIER,
+    ['6'] = LXT_CLASS_IDENTIFIER,
+    ['7'] = LXT_CLASS_IDENTIFIER,
+    ['8'] = LXT_CLASS_IDENTIFIER,
+    ['9'] = LXT_CLASS_IDENTIFIER,
+    ['<'] = LXT_CLASS_NAME_END,
+    ['>'] = LXT_CLASS_SEQUENCE_END,
+    ['A'] = LXT_CLASS_IDENTIFIER,
+    ['B'] = LXT_CLASS_IDENTIFIER,
+    ['C'] = LXT_CLASS_IDENTIFIER,
+    ['D'] = LXT_CLASS_IDENTIFIER,
+    ['E'] = LXT_CLASS_IDENTIFIER,
+    ['F'] = LXT_CLASS_IDENTIFIER,
+    ['G'] = LXT_CLASS_IDENTIFIER,
+    ['H'] = LXT_CLASS_IDENTIFIER,
+    ['I'] = LXT_CLASS_IDENTIFIER,
+    ['J'] = LXT_CLASS_IDENTIFIER,
+    ['K'] = LXT_CLASS_IDENTIFIER,
+    ['L'] = LXT_CLASS_IDENTIFIER,
+    ['M'] = LXT_CLASS_IDENTIFIER,
+    ['N'] = LXT_CLASS_IDENTIFIER,
+    ['O'] = LXT_CLASS_IDENTIFIER,
+    ['P'] = LXT_CLASS_IDENTIFIER,
+    ['Q'] = LXT_CLASS_IDENTIFIER,
+    ['R'] = LXT_CLASS_IDENTIFIER,
+    ['S'] = LXT_CLASS_IDENTIFIER,
+    ['T'] = LXT_CLASS_IDENTIFIER,
+    ['U'] = LXT_CLASS_IDENTIFIER,
+    ['V'] = LXT_CLASS_IDENTIFIER,
+    ['W'] = LXT_CLASS_IDENTIFIER,
+    ['X'] = LXT_CLASS_IDENTIFIER,
+    ['Y'] = LXT_CLASS_IDENTIFIER,
+    ['Z'] = LXT_CLASS_IDENTIFIER,
+    ['_'] = LXT_CLASS_IDENTIFIER,
+    ['a'] = LXT_CLASS_IDENTIFIER,
+    ['b'] = LXT_CLASS_IDENTIFIER,
+    ['c'] = LXT_CLASS_IDENTIFIER,
+    ['d'] = LXT_CLASS_IDENTIFIER,
+    ['e'] = LXT_CLASS_IDENTIFIER,
+    ['f'] = LXT_CLASS_IDENTIFIER,
+    ['g'] = LXT_CLASS_IDENTIFIER,
+    ['h'] = LXT_CLASS_IDENTIFIER,
+    ['i'] = LXT_CLASS_IDENTIFIER,
+    ['j'] = LXT_CLASS_IDENTIFIER,
+    ['k'] = LXT_CLASS_IDENTIFIER,
+    ['l'] = LXT_CLASS_IDENTIFIER,
+    ['m'] = LXT_CLASS_IDENTIFIER,
+    ['n'] = LXT_CLASS_IDENTIFIER,
+    ['o'] = LXT_CLASS_IDENTIFIER,
+    ['p'] = LXT_CLASS_IDENTIFIER,
+    ['q'] = LXT_CLASS_IDENTIFIER,
+    ['r'] = LXT_CLASS_IDENTIFIER,
+    ['s'] = LXT_CLASS_IDENTIFIER,
+    ['t'] = LXT_CLASS_IDENTIFIER,
+    ['u'] = LXT_CLASS_IDENTIFIER,
+    ['v'] = LXT_CLASS_IDENTIFIER,
+    ['w'] = LXT_CLASS_IDENTIFIER,
+    ['x'] = LXT_CLASS_IDENTIFIER,
+    ['y'] = LXT_CLASS_IDENTIFIER,
+    ['z'] = LXT_CLASS_IDENTIFIER
+};
+
+#ifdef LXT_SCAN_BLOCK
+/**
+ * Get the characters of an end class.
+ *
+ * Classes of fewer than three characters repeat their last character.
+ *
+ * Returns false if the class can not be scanned for by characters.
+ */
+static bool lxt_scan_characters(char characters[3], enum lxt_class);
+/**
+ * Get the index of the lowest set bit in a non-zero mask.
+ */
+static uint32_t lxt_scan_index(uint32_t mask);
+#endif
+
+char const *
+lxt_scan(char const * text,
+         char const * const end,
+         enum lxt_class const class)
+{
+#ifdef LXT_SCAN_BLOCK
+    char characters[3];
+    
+    if (end - text >= LXT_SCAN_BLOCK &&
+        lxt_scan_characters(characters, class)) {
+ #if defined(__AVX2__)
+        __m256i const a = _mm256_set1_epi8(characters[0]);
+        __m256i const b = _mm256_set1_epi8(characters[1]);
+        __m256i const c = _mm256_set1_epi8(characters[2]);
+        
+        while (end - text >= LXT_SCAN_BLOCK) {
+            __m256i const block = _mm256_loadu_si256((__m256i const *)text);
+            
+            __m256i const matches =
+                _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, a),
+                                                _mm256_cmpeq_epi8(block, b)),
+                                _mm256_cmpeq_epi8(block, c));
+            
+            uint32_t const mask = (uint32_t)_mm256_movemask_epi8(matches);
+            
+            if (mask != 0) {
+                return text + lxt_scan_index(mask);
+            }
+            
+            text += LXT_SCAN_BLOCK;
+        }
+ #else
+        __m128i const a = _mm_set1_epi8(characters[0]);
+        __m128i const b = _mm_set1_epi8(characters[1]);
+        __m128i const c = _mm_set1_epi8(characters[2]);
+        
+        while (end - text >= LXT_SCAN_BLOCK) {
+            __m128i const block = _mm_loadu_si128((__m128i const *)text);
+            
+            __m128i const matches =
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, a),
+                                          _mm_cmpeq_epi8(block, b)),
+                             _mm_cmpeq_epi8(block, c));
+            
+            uint32_t const mask = (uint32_t)_mm_movemask_epi8(matches);
+            
+            if (mask != 0) {
+                return text + lxt_scan_index(mask);
+            }
+            
+            text += LXT_SCAN_BLOCK;
+        }
+ #endif
+    }
+#endif
+    
+    // scan remaining characters (or all, without vector instructions)
+    while (text < end) {
+        if (lxt_class_is(*text, (uint8_t)class)) {
+            return text;
+        }
+        
+        text++;
+    }
+    
+    return end;
+}
+
+#ifdef LXT_SCAN_BLOCK
+static
+bool
+lxt_scan_characters(char characters[3],
+                    enum lxt_class const class)
+{
+    switch (class) {
+        case LXT_CLASS_NAME_END: {
+            characters[0] = '(';
+            characters[1] = '<';
+            characters[2] = '#';
+        } break;
+        
+        case LXT_CLASS_ENTRY_END: {
+            characters[0] = ')';
+            characters[1] = ',';
+            characters[2] = ',';
+        } break;
+        
+        case LXT_CLASS_SEQUENCE_END: {
+            characters[0] = '>';
+            characters[1] = '>';
+            characters[2] = '>';
+        } break;
+        
+        case LXT_CLASS_COMMENT_END: {
+            characters[0] = '\n';
+            characters[1] = '\n';
+            characters[2] = '\n';
+        } break;
+        
+        case LXT_CLASS_SPACE:
+        case LXT_CLASS_IDENTIFIER:
+        default:
+            return false;
+    }
+    
+    return true;
+}
+
+static
+uint32_t
+lxt_scan_index(uint32_t const mask)
+{
+ #if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t)__builtin_ctz(mask);
+ #else
+    uint32_t index = 0;
+    
+    while ((mask & (1UL << index)) == 0) {
+        index++;
+    }
+    
+    return index;
+ #endif
+}
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h> // uint8_t
+#include <stdbool.h> // bool
+
+/**
+ * Represents a class of characters that are significant when parsing.
+ *
+ * A character can belong to more than one class.
+ */
+enum lxt_class {
+    LXT_CLASS_SPACE = 1 << 0,
+    LXT_CLASS_IDENTIFIER = 1 << 1,
+    /**
+     * Characters that end the name of a container or generator, or
+     * any text leading up to a comment ("(", "<" and "#").
+     */
+    LXT_CLASS_NAME_END = 1 << 2,
+    /**
+     * Characters that end a container entry (")" and ",").
+     */
+    LXT_CLASS_ENTRY_END = 1 << 3,
+    /**
+     * Characters that end a generator sequence (">").
+     */
+    LXT_CLASS_SEQUENCE_END = 1 << 4,
+    /**
+     * Characters that end a comment (newline).
+     */
+    LXT_CLASS_COMMENT_END = 1 << 5
+};
+
+/**
+ * Lookup table of the classes of every character.
+ *
+ * Unlike the functions of `ctype.h`, this table does not depend on locale
+ * and works for any character, signed or not.
+ */
+extern uint8_t const lxt_classes[256];
+
+/**
+ * Determine whether a character belongs to any of the specified classes.
+ */
+inline
+bool
+lxt_class_is(char const character,
+             uint8_t const classes)
+{
+    return (lxt_classes[(unsigned char)character] & classes) != 0;
+}
+
+/**
+ * Find the first character belonging to a class in a range of text.
+ *
+ * Only one of the end classes (`LXT_CLASS_*_END`) can be scanned for at
+ * a time. Where available, text is scanned in blocks of 16 or 32 characters
+ * using SSE2 or AVX2 instructions.
+ *
+ * Returns end if no such character is found.
+ */
+char const * lxt_scan(char const * text,
+                      char const * end,
+                      enum lxt_class);
@@ -0,0 +1,146 @@
+#if !defined(_WIN32)
+ #define _POSIX_C_SOURCE 200809L // write
+#endif
+
+#include <lext/lext.h> // lxt_sink, lxt_buffer, lxt_sink_*
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // int32_t
+#include <stdlib.h> // realloc, free
+#include <string.h> // memcpy
+#include <stdio.h> // FILE, fwrite
+#include <errno.h> // errno, EINTR
+
+#if defined(_WIN32)
+ #include <io.h> // _write
+#else
+ #include <unistd.h> // write, ssize_t
+#endif
+
+static int32_t lxt_sink_file_write(void * file,
+                                   char const * data,
+                                   size_t length);
+static int32_t lxt_sink_fd_write(void * fd,
+                                 char const * data,
+                                 size_t length);
+static int32_t lxt_sink_buffer_write(void * buffer,
+                                     char const * data,
+                                     size_t length);
+
+struct lxt_buffer const LXT_BUFFER_EMPTY = {
+    .data = NULL,
+    .length = 0,
+    .capacity = 0
+};
+
+void
+lxt_sink_file(struct lxt_sink * const sink,
+              FILE * const file)
+{
+    sink->write = lxt_sink_file_write;
+    sink->context = file;
+}
+
+void
+lxt_sink_fd(struct lxt_sink * const sink,
+            int const fd)
+{
+    sink->write = lxt_sink_fd_write;
+    // store the descriptor itself rather than pointing to it, such that
+    // the sink does not depend on the lifetime of any variable
+    sink->context = (void *)(intptr_t)fd;
+}
+
+void
+lxt_sink_buffer(struct lxt_sink * const sink,
+                struct lxt_buffer * const buffer)
+{
+    sink->write = lxt_sink_buffer_write;
+    sink->context = buffer;
+}
+
+void
+lxt_buffer_free(struct lxt_buffer * const buffer)
+{
+    free(buffer->data);
+    
+    *buffer = LXT_BUFFER_EMPTY;
+}
+
+static
+int32_t
+lxt_sink_file_write(void * const file,
+                    char const * const data,
+                    size_t const length)
+{
+    if (fwrite(data, 1, length, file) != length) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+static
+int32_t
+lxt_sink_fd_write(void * const fd,
+                  char const * data,
+                  size_t length)
+{
+    int const descriptor = (int)(intptr_t)fd;
+    
+    while (length > 0) {
+#if defined(_WIN32)
+        unsigned int const chunk = length > 0x40000000 ?
+            0x40000000 : (unsigned int)length;
+        
+        int const written = _write(descriptor, data, chunk);
+#else
+        ssize_t const written = write(descriptor, data, length);
+#endif
+        
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            
+            return -1;
+        }
+        
+        data += written;
+        length -= (size_t)written;
+    }
+    
+    return 0;
+}
+
+static
+int32_t
+lxt_sink_buffer_write(void * const context,
+                      char const * const data,
+                      size_t const length)
+{
+    struct lxt_buffer * const buffer = context;
+    
+    if (length > buffer->capacity - buffer->length) {
+        size_t capacity = buffer->capacity < 256 ? 512 : buffer->capacity;
+        
+        while (length > capacity - buffer->length) {
+            capacity *= 2;
+        }
+        
+        char * const grown = realloc(buffer->data, capacity);
+        
+        if (grown == NULL) {
+            return -1;
+        }
+        
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    
+    memcpy(buffer->data + buffer->length, data, length);
+    
+    buffer->length += length;
+    
+    return 0;
+}
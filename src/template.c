@@ -1,15 +1,143 @@
+#include <lext/lext.h> // lxt_error
+
 #include "template.h" // lxt_template, lxt_generator, lxt_container, lxt_*
 #include "token.h" // lxt_token, lxt_token_equals
-#include "rand.h" // lxt_rand32
+#include "arena.h" // lxt_arena, lxt_arena_*, lxt_list_*
+#include "rand.h" // lxt_rand_bounded
+#include "library.h" // lxt_library_find, lxt_library_find_lines
 
 #include <stddef.h> // size_t, NULL
 #include <stdbool.h> // bool
-#include <string.h> // strlen
+#include <stdint.h> // uint32_t, uint64_t, uint8_t, UINT32_MAX
+#include <stdlib.h> // malloc, calloc, free
+#include <string.h> // strlen, memcpy
+
+// limit symbols such that a symbol table can always be at most half full
+#define MAX_SYMBOLS (UINT32_MAX >> 2)
+
+static int32_t lxt_make_span(struct lxt_span *,
+                             struct lxt_builder const *,
+                             struct lxt_token);
+
+/**
+ * Link each variable operation to the container or generator it names.
+ *
+ * Variables are linked to generators before containers, and to containers
+ * of the template before containers read from files, and those before
+ * imported containers.
+ */
+static enum lxt_error lxt_link(struct lxt_op * ops,
+                               struct lxt_import * imports,
+                               uint32_t * import_count,
+                               struct lxt_template const *,
+                               struct lxt_builder const *);
+/**
+ * Link a variable operation to a container read from a lines file of the
+ * library, or else to a container of an imported module.
+ *
+ * Modules are searched in the order they are imported. Each imported
+ * container is added to the imports once, no matter how many variables
+ * name it; the import of each container read from a file is kept in
+ * loaded, such that the file is only looked up once.
+ *
+ * Returns LXT_ERROR_UNSUPPORTED if the library has no such lines file, or
+ * there is no library; patterns can only read files that are registered.
+ */
+static enum lxt_error lxt_link_import(struct lxt_op *,
+                                      struct lxt_import * imports,
+                                      uint32_t * import_count,
+                                      uint32_t * loaded,
+                                      struct lxt_token name,
+                                      uint32_t hash,
+                                      struct lxt_builder const *);
+
+/**
+ * Mark each operation that resolves a generator of the same recursive cycle
+ * as its own generator as a recursion operation.
+ *
+ * Cycles are found as the strongly connected components of the graph of
+ * generators (using Tarjan's algorithm, with an explicit stack).
+ */
+static int32_t lxt_mark_recursion(struct lxt_op * ops,
+                                  struct lxt_template const *);
+/**
+ * Build an alias table for a number of weighted choices.
+ *
+ * Columns are filled using the method of Vose (1991); each column is
+ * topped up from a choice that has more than its share of weight, until
+ * every column holds the same amount of weight.
+ */
+static int32_t lxt_make_alias(struct lxt_weight * table,
+                              uint32_t const * weights,
+                              uint32_t count);
+/**
+ * Determine the minimum and maximum length of results of each generator.
+ *
+ * Generators are measured depth-first, such that every generator is
+ * measured after the generators it resolves. A generator that resolves a
+ * generator that is still being measured is recursive, and so unbounded;
+ * the recursive generator counts as 0 towards its minimum.
+ */
+static int32_t lxt_measure_generators(struct lxt_generator * generators,
+                                      struct lxt_template const *);
+/**
+ * Add two lengths, saturating at LXT_LENGTH_UNBOUNDED.
+ */
+static uint64_t lxt_add_length(uint64_t, uint64_t);
+/**
+ * Multiply two counts of combinations, saturating at UINT64_MAX.
+ *
+ * A count of 0 (uncountable) stays 0.
+ */
+static uint64_t lxt_multiply_count(uint64_t, uint64_t);
+
+/**
+ * Get the capacity of a symbol table that holds a given number of symbols.
+ */
+static uint32_t lxt_symbols_capacity(uint32_t count);
+/**
+ * Insert a symbol into a symbol table.
+ *
+ * If a symbol of the same name already exists, the table is left unchanged;
+ * the first definition of a name always takes precedence.
+ */
+static void lxt_symbols_insert(struct lxt_symbol * slots,
+                               uint32_t mask,
+                               struct lxt_span name,
+                               uint32_t index,
+                               char const * pattern);
+/**
+ * Find the index of a symbol in a symbol table.
+ *
+ * Returns SYMBOL_NONE if the symbol is not in the table.
+ */
+static uint32_t lxt_symbols_find(struct lxt_symbols,
+                                 struct lxt_token,
+                                 uint32_t hash,
+                                 char const * pattern);
+
+struct lxt_token
+lxt_get_token(struct lxt_template const * const template,
+              struct lxt_span const span)
+{
+    struct lxt_token token;
+    
+    if (span.offset & LXT_SPAN_LITERAL) {
+        token.start = template->literals + (span.offset & ~LXT_SPAN_LITERAL);
+    } else {
+        token.start = template->pattern + span.offset;
+    }
+    
+    token.length = span.length;
+    
+    return token;
+}
 
 void
 lxt_get_generator(struct lxt_generator const ** generator,
                   struct lxt_template const * const template,
-                  char const * const name)
+                  char const * const name,
+                  struct lxt_rng * const rng)
 {
     *generator = NULL;
     
@@ -23,125 +151,1287 @@ lxt_get_generator(struct lxt_generator const ** generator,
         token.start = name;
         token.length = strlen(name);
         
-        if (lxt_find_generator(generator, token, template)) {
+        uint32_t const hash = lxt_token_hash(token);
+        
+        if (lxt_find_generator(generator, token, hash, template)) {
             return;
         }
     }
     
-    size_t const i = lxt_rand32(template->seed);
+    size_t const i = template->generator_weight_total == 0 ?
+        lxt_rand_bounded(rng, template->generator_count) :
+        lxt_pick(template->weights, template->generator_count,
+                 template->generator_weight_total, rng);
+    
+    *generator = &template->generators[i];
+}
+
+void
+lxt_get_container(struct lxt_container const ** const container,
+                  struct lxt_template const ** const owner,
+                  struct lxt_op const * const op,
+                  struct lxt_template const * const template)
+{
+    if (op->kind == LXT_OP_IMPORT) {
+        struct lxt_import const * const import =
+            &template->imports[op->index];
+        
+        *container = import->container;
+        *owner = import->template;
+        
+        return;
+    }
+    
+    *container = &template->containers[op->index];
+    *owner = template;
+}
+
+uint32_t
+lxt_pick(struct lxt_weight const * const weights,
+         uint32_t const count,
+         uint32_t const total,
+         struct lxt_rng * const rng)
+{
+    if (rng->kind == LXT_RNG_XORSHIFT32) {
+        // find the first choice whose cumulative weight exceeds the draw;
+        // exactly the choice that a draw over every duplicate would pick
+        uint32_t const r = lxt_rand_bounded(rng, total);
+        
+        uint32_t low = 0;
+        uint32_t high = count - 1;
+        
+        while (low < high) {
+            uint32_t const middle = low + (high - low) / 2;
+            
+            if (weights[middle].cumulative > r) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        
+        return low;
+    }
+    
+    // the high half of the product picks a column, and the low half is
+    // a uniform fraction for choosing between the column and its alias
+    uint64_t const m = (uint64_t)lxt_rand_next(rng) * count;
+    uint32_t const column = (uint32_t)(m >> 32);
     
-    *generator = &template->generators[i % template->generator_count];
+    if ((uint32_t)m < weights[column].threshold) {
+        return column;
+    }
+    
+    return weights[column].alias;
 }
 
 bool
 lxt_find_generator(struct lxt_generator const ** const generator,
                    struct lxt_token const token,
+                   uint32_t const hash,
                    struct lxt_template const * const template)
 {
-    for (size_t i = 0; i < template->generator_count; i++) {
-        struct lxt_generator const * const match = &template->generators[i];
-        
-        if (lxt_token_equals(token, match->entry)) {
-            *generator = match;
-            
-            return true;
-        }
+    uint32_t const index = lxt_symbols_find(template->generator_symbols,
+                                            token, hash,
+                                            template->pattern);
+    
+    if (index == SYMBOL_NONE) {
+        return false;
     }
     
-    return false;
+    *generator = &template->generators[index];
+    
+    return true;
 }
 
 bool
 lxt_find_container(struct lxt_container const ** const container,
                    struct lxt_token const token,
+                   uint32_t const hash,
                    struct lxt_template const * const template)
 {
-    for (size_t i = 0; i < template->container_count; i++) {
-        struct lxt_container const * const match = &template->containers[i];
-        
-        if (lxt_token_equals(token, match->entry)) {
-            *container = match;
-            
-            return true;
-        }
+    uint32_t const index = lxt_symbols_find(template->container_symbols,
+                                            token, hash,
+                                            template->pattern);
+    
+    if (index == SYMBOL_NONE) {
+        return false;
     }
     
-    return false;
+    *container = &template->containers[index];
+    
+    return true;
 }
 
 int32_t
-lxt_append_container(struct lxt_template * const template,
+lxt_append_container(struct lxt_builder * const builder,
                      struct lxt_token const token)
 {
-    if (template->container_count == MAX_CONTAINERS) {
+    if (builder->containers.count == MAX_SYMBOLS) {
         return -1;
     }
     
-    size_t const cur_index = template->container_count;
+    struct lxt_container container;
     
-    struct lxt_container * const container = &template->containers[cur_index];
+    if (lxt_make_span(&container.entry, builder, token) != 0) {
+        return -1;
+    }
     
-    container->entry = token;
+    container.entry_index = (uint32_t)builder->entries.count;
+    container.entry_count = 0;
+    container.weight_index = 0;
+    container.weight_total = 0;
     
-    template->container_count += 1;
+    if (lxt_list_push(&builder->containers,
+                      &container, sizeof(container)) == NULL) {
+        return -1;
+    }
     
     return 0;
 }
 
 int32_t
-lxt_append_container_entry(struct lxt_template * const template,
-                           struct lxt_token const token)
+lxt_append_container_entry(struct lxt_builder * const builder,
+                           struct lxt_token const token,
+                           uint32_t const weight)
 {
-    if (template->container_count == 0) {
+    if (builder->containers.count == 0) {
+        return -1;
+    }
+    
+    if (builder->entries.count == UINT32_MAX) {
         return -1;
     }
     
-    size_t const cur_index = template->container_count - 1;
+    size_t const cur_index = builder->containers.count - 1;
+    
+    struct lxt_container * const container =
+        (struct lxt_container *)builder->containers.items + cur_index;
     
-    struct lxt_container * const container = &template->containers[cur_index];
+    struct lxt_span entry;
     
-    if (container->entry_count == MAX_CONTAINER_ENTRIES) {
+    if (lxt_make_span(&entry, builder, token) != 0) {
+        return -1;
+    }
+    
+    // entries always belong to the most recent container, so appending to
+    // the end keeps the entries of each container consecutive
+    if (lxt_list_push(&builder->entries, &entry, sizeof(entry)) == NULL ||
+        lxt_list_push(&builder->entry_weights,
+                      &weight, sizeof(weight)) == NULL) {
         return -1;
     }
     
-    container->entries[container->entry_count] = token;
     container->entry_count += 1;
     
     return 0;
 }
 
 int32_t
-lxt_append_generator(struct lxt_template * const template,
-                     struct lxt_token const token)
+lxt_append_generator(struct lxt_builder * const builder,
+                     struct lxt_token const token,
+                     uint32_t const weight)
 {
-    if (template->generator_count == MAX_GENERATORS) {
+    if (builder->generators.count == MAX_SYMBOLS) {
         return -1;
     }
     
-    size_t const cur_index = template->generator_count;
+    struct lxt_generator generator;
     
-    struct lxt_generator * const generator = &template->generators[cur_index];
+    if (lxt_make_span(&generator.entry, builder, token) != 0) {
+        return -1;
+    }
     
-    generator->entry = token;
+    generator.sequence.offset = 0;
+    generator.sequence.length = 0;
+    generator.op_index = 0;
+    generator.op_count = 0;
+    generator.min_length = 0;
+    generator.max_length = 0;
+    generator.combinations = 1;
     
-    template->generator_count += 1;
+    if (lxt_list_push(&builder->generators,
+                      &generator, sizeof(generator)) == NULL ||
+        lxt_list_push(&builder->generator_weights,
+                      &weight, sizeof(weight)) == NULL) {
+        return -1;
+    }
     
     return 0;
 }
 
 int32_t
-lxt_append_sequence(struct lxt_template * const template,
+lxt_append_import(struct lxt_builder * const builder,
+                  struct lxt_token const token)
+{
+    struct lxt_span name;
+    
+    if (lxt_make_span(&name, builder, token) != 0) {
+        return -1;
+    }
+    
+    if (lxt_list_push(&builder->imports, &name, sizeof(name)) == NULL) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+int32_t
+lxt_append_lines(struct lxt_builder * const builder,
+                 struct lxt_token const token)
+{
+    struct lxt_span name;
+    
+    if (lxt_make_span(&name, builder, token) != 0) {
+        return -1;
+    }
+    
+    if (lxt_list_push(&builder->lines, &name, sizeof(name)) == NULL) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+int32_t
+lxt_append_sequence(struct lxt_builder * const builder,
                     struct lxt_token const token)
 {
-    if (template->container_count == 0) {
+    if (builder->generators.count == 0) {
         return -1;
     }
     
-    size_t const cur_index = template->generator_count - 1;
+    size_t const cur_index = builder->generators.count - 1;
     
-    struct lxt_generator * const generator = &template->generators[cur_index];
+    struct lxt_generator * const generator =
+        (struct lxt_generator *)builder->generators.items + cur_index;
     
-    generator->sequence = token;
+    if (lxt_make_span(&generator->sequence, builder, token) != 0) {
+        return -1;
+    }
     
     return 0;
 }
+
+int32_t
+lxt_append_op(struct lxt_builder * const builder,
+              size_t const generator_index,
+              enum lxt_op_kind const kind,
+              struct lxt_token const token)
+{
+    if (generator_index >= builder->generators.count) {
+        return -1;
+    }
+    
+    if (builder->ops.count == UINT32_MAX) {
+        return -1;
+    }
+    
+    struct lxt_generator * const generator =
+        (struct lxt_generator *)builder->generators.items + generator_index;
+    
+    struct lxt_op op;
+    
+    op.kind = kind;
+    op.index = 0;
+    
+    if (lxt_make_span(&op.text, builder, token) != 0) {
+        return -1;
+    }
+    
+    if (generator->op_count == 0) {
+        generator->op_index = (uint32_t)builder->ops.count;
+    } else if (kind == LXT_OP_TEXT) {
+        struct lxt_op * const last =
+            (struct lxt_op *)builder->ops.items + builder->ops.count - 1;
+        
+        if (last->kind == LXT_OP_TEXT &&
+            last->text.offset + last->text.length == op.text.offset) {
+            // text immediately follows the previous text; extend it
+            // instead of writing each chunk separately
+            last->text.length += op.text.length;
+            
+            return 0;
+        }
+    }
+    
+    if (lxt_list_push(&builder->ops, &op, sizeof(op)) == NULL) {
+        return -1;
+    }
+    
+    generator->op_count += 1;
+    
+    return 0;
+}
+
+enum lxt_error
+lxt_fold_entries(struct lxt_builder * const builder)
+{
+    struct lxt_container * const containers =
+        (struct lxt_container *)builder->containers.items;
+    struct lxt_span * const entries =
+        (struct lxt_span *)builder->entries.items;
+    uint32_t * const weights =
+        (uint32_t *)builder->entry_weights.items;
+    
+    uint32_t folded = 0;
+    
+    for (size_t i = 0; i < builder->containers.count; i++) {
+        struct lxt_container * const container = &containers[i];
+        
+        uint32_t const first = folded;
+        
+        uint64_t total = 0;
+        bool weighted = false;
+        
+        for (uint32_t k = 0; k < container->entry_count; k++) {
+            // entries are only ever moved towards the front, so the
+            // entry at this index has not been overwritten yet
+            struct lxt_span const entry = entries[container->entry_index + k];
+            uint32_t const weight = weights[container->entry_index + k];
+            
+            total += weight;
+            
+            if (weight != 1) {
+                weighted = true;
+            }
+            
+            if (folded > first) {
+                struct lxt_span const previous = entries[folded - 1];
+                
+                struct lxt_token const token = {
+                    .start = builder->pattern + entry.offset,
+                    .length = entry.length
+                };
+                
+                struct lxt_token const other = {
+                    .start = builder->pattern + previous.offset,
+                    .length = previous.length
+                };
+                
+                if (lxt_token_equals(other, token)) {
+                    // only a run of duplicates picks exactly as a single
+                    // weighted entry would; fold it into the first
+                    weights[folded - 1] += weight;
+                    weighted = true;
+                    
+                    continue;
+                }
+            }
+            
+            entries[folded] = entry;
+            weights[folded] = weight;
+            
+            folded += 1;
+        }
+        
+        if (total > UINT32_MAX) {
+            return LXT_ERROR_INVALID_TEMPLATE;
+        }
+        
+        container->entry_index = first;
+        container->entry_count = folded - first;
+        container->weight_total = weighted ? (uint32_t)total : 0;
+    }
+    
+    builder->entries.count = folded;
+    builder->entry_weights.count = folded;
+    
+    return LXT_ERROR_NONE;
+}
+
+enum lxt_error
+lxt_build(struct lxt_template ** const template,
+          struct lxt_builder const * const builder)
+{
+    size_t const containers_size =
+        builder->containers.count * sizeof(struct lxt_container);
+    size_t const generators_size =
+        builder->generators.count * sizeof(struct lxt_generator);
+    size_t const entries_size =
+        builder->entries.count * sizeof(struct lxt_span);
+    size_t const ops_size =
+        builder->ops.count * sizeof(struct lxt_op);
+    
+    uint32_t const * const generator_weights =
+        (uint32_t const *)builder->generator_weights.items;
+    uint32_t const * const entry_weights =
+        (uint32_t const *)builder->entry_weights.items;
+    
+    uint64_t generator_total = 0;
+    bool generators_weighted = false;
+    
+    for (size_t i = 0; i < builder->generators.count; i++) {
+        generator_total += generator_weights[i];
+        
+        if (generator_weights[i] != 1) {
+            generators_weighted = true;
+        }
+    }
+    
+    if (generator_total > UINT32_MAX) {
+        return LXT_ERROR_INVALID_TEMPLATE;
+    }
+    
+    uint64_t weight_count = generators_weighted ?
+        builder->generators.count : 0;
+    
+    for (size_t i = 0; i < builder->containers.count; i++) {
+        struct lxt_container const * const container =
+            (struct lxt_container const *)builder->containers.items + i;
+        
+        if (container->weight_total != 0) {
+            weight_count += container->entry_count;
+        }
+    }
+    
+    if (weight_count > UINT32_MAX) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    size_t const weights_size =
+        (size_t)weight_count * sizeof(struct lxt_weight);
+    
+    // every variable links to at most one imported container; templates
+    // that import nothing have no room for any
+    size_t import_capacity = 0;
+    
+    if (builder->imports.count > 0 || builder->lines.count > 0) {
+        for (size_t i = 0; i < builder->ops.count; i++) {
+            struct lxt_op const * const op =
+                (struct lxt_op const *)builder->ops.items + i;
+            
+            if (op->kind == LXT_OP_VARIABLE) {
+                import_capacity += 1;
+            }
+        }
+    }
+    
+    size_t const imports_size = import_capacity * sizeof(struct lxt_import);
+    
+    uint32_t const container_capacity =
+        lxt_symbols_capacity((uint32_t)builder->containers.count);
+    uint32_t const generator_capacity =
+        lxt_symbols_capacity((uint32_t)builder->generators.count);
+    
+    size_t const container_symbols_size =
+        container_capacity * sizeof(struct lxt_symbol);
+    size_t const generator_symbols_size =
+        generator_capacity * sizeof(struct lxt_symbol);
+    
+    struct lxt_arena arena;
+    
+    if (lxt_arena_create(&arena,
+                         lxt_arena_size(sizeof(struct lxt_template)) +
+                         lxt_arena_size(containers_size) +
+                         lxt_arena_size(generators_size) +
+                         lxt_arena_size(entries_size) +
+                         lxt_arena_size(ops_size) +
+                         lxt_arena_size(weights_size) +
+                         lxt_arena_size(imports_size) +
+                         lxt_arena_size(container_symbols_size) +
+                         lxt_arena_size(generator_symbols_size)) != 0) {
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    // the template must be the first allocation, as releasing the
+    // template memory releases the entire arena
+    struct lxt_template * const result =
+        lxt_arena_alloc(&arena, sizeof(struct lxt_template));
+    
+    struct lxt_container * const containers =
+        lxt_arena_alloc(&arena, containers_size);
+    struct lxt_generator * const generators =
+        lxt_arena_alloc(&arena, generators_size);
+    struct lxt_span * const entries =
+        lxt_arena_alloc(&arena, entries_size);
+    struct lxt_op * const ops =
+        lxt_arena_alloc(&arena, ops_size);
+    struct lxt_weight * const weights =
+        lxt_arena_alloc(&arena, weights_size);
+    struct lxt_import * const imports =
+        lxt_arena_alloc(&arena, imports_size);
+    struct lxt_symbol * const container_symbols =
+        lxt_arena_alloc(&arena, container_symbols_size);
+    struct lxt_symbol * const generator_symbols =
+        lxt_arena_alloc(&arena, generator_symbols_size);
+    
+    if (containers_size > 0) {
+        memcpy(containers, builder->containers.items, containers_size);
+    }
+    
+    if (generators_size > 0) {
+        memcpy(generators, builder->generators.items, generators_size);
+    }
+    
+    if (entries_size > 0) {
+        memcpy(entries, builder->entries.items, entries_size);
+    }
+    
+    if (ops_size > 0) {
+        memcpy(ops, builder->ops.items, ops_size);
+    }
+    
+    for (uint32_t i = 0; i < container_capacity; i++) {
+        container_symbols[i].index = SYMBOL_NONE;
+    }
+    
+    for (uint32_t i = 0; i < generator_capacity; i++) {
+        generator_symbols[i].index = SYMBOL_NONE;
+    }
+    
+    for (uint32_t i = 0; i < builder->containers.count; i++) {
+        lxt_symbols_insert(container_symbols, container_capacity - 1,
+                           containers[i].entry, i,
+                           builder->pattern);
+    }
+    
+    for (uint32_t i = 0; i < builder->generators.count; i++) {
+        lxt_symbols_insert(generator_symbols, generator_capacity - 1,
+                           generators[i].entry, i,
+                           builder->pattern);
+    }
+    
+    result->pattern = builder->pattern;
+    result->containers = containers;
+    result->generators = generators;
+    result->entries = entries;
+    result->ops = ops;
+    result->weights = weights;
+    result->imports = imports;
+    result->literals = NULL;
+    result->container_symbols.slots = container_symbols;
+    result->container_symbols.mask = container_capacity - 1;
+    result->generator_symbols.slots = generator_symbols;
+    result->generator_symbols.mask = generator_capacity - 1;
+    result->container_count = (uint32_t)builder->containers.count;
+    result->generator_count = (uint32_t)builder->generators.count;
+    result->entry_count = (uint32_t)builder->entries.count;
+    result->op_count = (uint32_t)builder->ops.count;
+    result->weight_count = (uint32_t)weight_count;
+    result->import_count = 0;
+    result->literal_length = 0;
+    result->generator_weight_total = generators_weighted ?
+        (uint32_t)generator_total : 0;
+    
+    // from here on, the template may own containers read from files;
+    // releasing it releases those as well
+    enum lxt_error const error = lxt_link(ops, imports,
+                                          &result->import_count,
+                                          result, builder);
+    
+    if (error != LXT_ERROR_NONE) {
+        lxt_free(result);
+        
+        return error;
+    }
+    
+    if (lxt_mark_recursion(ops, result) != 0 ||
+        lxt_measure_generators(generators, result) != 0) {
+        lxt_free(result);
+        
+        return LXT_ERROR_OUT_OF_MEMORY;
+    }
+    
+    uint32_t weight_index = 0;
+    
+    if (generators_weighted) {
+        if (lxt_make_alias(weights, generator_weights,
+                           result->generator_count) != 0) {
+            lxt_free(result);
+            
+            return LXT_ERROR_OUT_OF_MEMORY;
+        }
+        
+        weight_index = result->generator_count;
+    }
+    
+    for (uint32_t i = 0; i < result->container_count; i++) {
+        struct lxt_container * const container = &containers[i];
+        
+        if (container->weight_total == 0) {
+            continue;
+        }
+        
+        if (lxt_make_alias(&weights[weight_index],
+                           &entry_weights[container->entry_index],
+                           container->entry_count) != 0) {
+            lxt_free(result);
+            
+            return LXT_ERROR_OUT_OF_MEMORY;
+        }
+        
+        container->weight_index = weight_index;
+        
+        weight_index += container->entry_count;
+    }
+    
+    *template = result;
+    
+    return LXT_ERROR_NONE;
+}
+
+void
+lxt_builder_free(struct lxt_builder * const builder)
+{
+    lxt_list_free(&builder->containers);
+    lxt_list_free(&builder->generators);
+    lxt_list_free(&builder->entries);
+    lxt_list_free(&builder->ops);
+    lxt_list_free(&builder->entry_weights);
+    lxt_list_free(&builder->generator_weights);
+    lxt_list_free(&builder->imports);
+    lxt_list_free(&builder->lines);
+}
+
+static
+int32_t
+lxt_make_span(struct lxt_span * const span,
+              struct lxt_builder const * const builder,
+              struct lxt_token const token)
+{
+    size_t const offset = (size_t)(token.start - builder->pattern);
+    
+    if (offset >= LXT_SPAN_LITERAL ||
+        token.length > LXT_SPAN_LITERAL - offset) {
+        // pattern is too large to be addressed by a span
+        return -1;
+    }
+    
+    span->offset = (uint32_t)offset;
+    span->length = (uint32_t)token.length;
+    
+    return 0;
+}
+
+static
+enum lxt_error
+lxt_link(struct lxt_op * const ops,
+         struct lxt_import * const imports,
+         uint32_t * const import_count,
+         struct lxt_template const * const template,
+         struct lxt_builder const * const builder)
+{
+    uint32_t * loaded = NULL;
+    
+    if (builder->lines.count > 0) {
+        loaded = malloc(builder->lines.count * sizeof(uint32_t));
+        
+        if (loaded == NULL) {
+            return LXT_ERROR_OUT_OF_MEMORY;
+        }
+        
+        for (size_t i = 0; i < builder->lines.count; i++) {
+            loaded[i] = SYMBOL_NONE;
+        }
+    }
+    
+    enum lxt_error error = LXT_ERROR_NONE;
+    
+    for (uint32_t i = 0; i < template->op_count; i++) {
+        struct lxt_op * const op = &ops[i];
+        
+        if (op->kind != LXT_OP_VARIABLE) {
+            continue;
+        }
+        
+        struct lxt_token const name = lxt_get_token(template, op->text);
+        
+        uint32_t const hash = lxt_token_hash(name);
+        
+        uint32_t index = lxt_symbols_find(template->generator_symbols,
+                                          name, hash,
+                                          template->pattern);
+        
+        if (index != SYMBOL_NONE) {
+            op->kind = LXT_OP_GENERATOR;
+            op->index = index;
+            
+            continue;
+        }
+        
+        index = lxt_symbols_find(template->container_symbols,
+                                 name, hash,
+                                 template->pattern);
+        
+        if (index == SYMBOL_NONE) {
+            error = lxt_link_import(op, imports, import_count, loaded,
+                                    name, hash, builder);
+            
+            if (error != LXT_ERROR_NONE) {
+                break;
+            }
+            
+            continue;
+        }
+        
+        op->kind = LXT_OP_CONTAINER;
+        op->index = index;
+    }
+    
+    free(loaded);
+    
+    return error;
+}
+
+static
+enum lxt_error
+lxt_link_import(struct lxt_op * const op,
+                struct lxt_import * const imports,
+                uint32_t * const import_count,
+                uint32_t * const loaded,
+                struct lxt_token const name,
+                uint32_t const hash,
+                struct lxt_builder const * const builder)
+{
+    struct lxt_span const * const lines =
+        (struct lxt_span const *)builder->lines.items;
+    
+    for (size_t i = 0; i < builder->lines.count; i++) {
+        struct lxt_token const lines_name = {
+            .start = builder->pattern + lines[i].offset,
+            .length = lines[i].length
+        };
+        
+        if (!lxt_token_equals(name, lines_name)) {
+            continue;
+        }
+        
+        if (builder->library == NULL) {
+            // reading files is up to the library, never the pattern
+            return LXT_ERROR_UNSUPPORTED;
+        }
+        
+        if (loaded[i] == SYMBOL_NONE) {
+            // the file is read the first time any variable needs it
+            struct lxt_template * file = NULL;
+            
+            bool owned = false;
+            
+            enum lxt_error const error =
+                lxt_library_find_lines(&file, &owned, builder->library,
+                                       name);
+            
+            if (error != LXT_ERROR_NONE) {
+                return error;
+            }
+            
+            loaded[i] = *import_count;
+            
+            imports[loaded[i]].template = file;
+            imports[loaded[i]].container = &file->containers[0];
+            imports[loaded[i]].owned = owned;
+            
+            *import_count += 1;
+        }
+        
+        op->kind = LXT_OP_IMPORT;
+        op->index = loaded[i];
+        
+        return LXT_ERROR_NONE;
+    }
+    
+    struct lxt_span const * const modules =
+        (struct lxt_span const *)builder->imports.items;
+    
+    for (size_t i = 0; i < builder->imports.count; i++) {
+        if (builder->library == NULL) {
+            // nothing to import from
+            break;
+        }
+        
+        struct lxt_token const module_name = {
+            .start = builder->pattern + modules[i].offset,
+            .length = modules[i].length
+        };
+        
+        struct lxt_template const * module = NULL;
+        
+        // the module is compiled the first time any template needs it
+        enum lxt_error const error =
+            lxt_library_find(&module, builder->library, module_name);
+        
+        if (error != LXT_ERROR_NONE) {
+            return error;
+        }
+        
+        struct lxt_container const * container = NULL;
+        
+        if (!lxt_find_container(&container, name, hash, module)) {
+            continue;
+        }
+        
+        uint32_t index = 0;
+        
+        while (index < *import_count &&
+               imports[index].container != container) {
+            index += 1;
+        }
+        
+        if (index == *import_count) {
+            imports[index].template = module;
+            imports[index].container = container;
+            imports[index].owned = false;
+            
+            *import_count += 1;
+        }
+        
+        op->kind = LXT_OP_IMPORT;
+        op->index = index;
+        
+        return LXT_ERROR_NONE;
+    }
+    
+    // variable is undefined
+    return LXT_ERROR_INVALID_TEMPLATE;
+}
+
+static
+int32_t
+lxt_mark_recursion(struct lxt_op * const ops,
+                   struct lxt_template const * const template)
+{
+    struct lxt_frame {
+        uint32_t generator;
+        uint32_t op;
+    };
+    
+    // the component of a generator while it is on the stack
+    uint32_t const ON_STACK = UINT32_MAX;
+    uint32_t const NO_GENERATOR = UINT32_MAX;
+    
+    uint32_t const count = template->generator_count;
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    struct lxt_frame * const frames = calloc(count, sizeof(struct lxt_frame));
+    // the order that each generator was visited in, starting from 1;
+    // 0 for generators not yet visited
+    uint32_t * const orders = calloc(count, sizeof(uint32_t));
+    uint32_t * const lowest = calloc(count, sizeof(uint32_t));
+    uint32_t * const components = calloc(count, sizeof(uint32_t));
+    uint32_t * const stack = calloc(count, sizeof(uint32_t));
+    
+    if (frames == NULL || orders == NULL || lowest == NULL ||
+        components == NULL || stack == NULL) {
+        free(frames);
+        free(orders);
+        free(lowest);
+        free(components);
+        free(stack);
+        
+        return -1;
+    }
+    
+    uint32_t order = 0;
+    uint32_t component = 0;
+    uint32_t stack_count = 0;
+    
+    for (uint32_t root = 0; root < count; root++) {
+        if (orders[root] != 0) {
+            continue;
+        }
+        
+        uint32_t depth = 0;
+        uint32_t next = root;
+        
+        while (true) {
+            if (next != NO_GENERATOR) {
+                // visit the next generator
+                order += 1;
+                
+                orders[next] = order;
+                lowest[next] = order;
+                components[next] = ON_STACK;
+                stack[stack_count++] = next;
+                
+                frames[depth++] = (struct lxt_frame) {
+                    .generator = next,
+                    .op = 0
+                };
+                
+                next = NO_GENERATOR;
+            }
+            
+            struct lxt_frame * const frame = &frames[depth - 1];
+            struct lxt_generator const * const generator =
+                &template->generators[frame->generator];
+            
+            if (frame->op < generator->op_count) {
+                struct lxt_op const * const op =
+                    &ops[generator->op_index + frame->op];
+                
+                if (op->kind == LXT_OP_GENERATOR) {
+                    if (orders[op->index] == 0) {
+                        // visit the resolved generator first, then come
+                        // back to this operation
+                        next = op->index;
+                        
+                        continue;
+                    }
+                    
+                    if (components[op->index] == ON_STACK &&
+                        lowest[op->index] < lowest[frame->generator]) {
+                        lowest[frame->generator] = lowest[op->index];
+                    }
+                }
+                
+                frame->op += 1;
+                
+                continue;
+            }
+            
+            uint32_t const visited = frame->generator;
+            
+            if (lowest[visited] == orders[visited]) {
+                // the generator is the root of a component; every
+                // generator above it on the stack belongs to it
+                uint32_t member;
+                
+                do {
+                    member = stack[--stack_count];
+                    
+                    components[member] = component;
+                } while (member != visited);
+                
+                component += 1;
+            }
+            
+            depth -= 1;
+            
+            if (depth == 0) {
+                break;
+            }
+        }
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        struct lxt_generator const * const generator =
+            &template->generators[i];
+        
+        for (uint32_t k = 0; k < generator->op_count; k++) {
+            struct lxt_op * const op = &ops[generator->op_index + k];
+            
+            if (op->kind == LXT_OP_GENERATOR &&
+                components[op->index] == components[i]) {
+                op->kind = LXT_OP_RECURSION;
+            }
+        }
+    }
+    
+    free(frames);
+    free(orders);
+    free(lowest);
+    free(components);
+    free(stack);
+    
+    return 0;
+}
+
+static
+int32_t
+lxt_make_alias(struct lxt_weight * const table,
+               uint32_t const * const weights,
+               uint32_t const count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    
+    // weights are scaled by the number of choices, such that a column
+    // holds exactly the total weight
+    uint64_t * const scaled = calloc(count, sizeof(uint64_t));
+    uint32_t * const small = calloc(count, sizeof(uint32_t));
+    uint32_t * const large = calloc(count, sizeof(uint32_t));
+    
+    if (scaled == NULL || small == NULL || large == NULL) {
+        free(scaled);
+        free(small);
+        free(large);
+        
+        return -1;
+    }
+    
+    uint64_t total = 0;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        total += weights[i];
+        
+        table[i].cumulative = (uint32_t)total;
+    }
+    
+    uint32_t small_count = 0;
+    uint32_t large_count = 0;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        scaled[i] = (uint64_t)weights[i] * count;
+        
+        // a column always keeps itself unless given an alias
+        table[i].threshold = UINT32_MAX;
+        table[i].alias = i;
+        
+        if (scaled[i] < total) {
+            small[small_count++] = i;
+        } else {
+            large[large_count++] = i;
+        }
+    }
+    
+    while (small_count > 0 && large_count > 0) {
+        uint32_t const less = small[--small_count];
+        uint32_t const more = large[large_count - 1];
+        
+        table[less].threshold = (uint32_t)((scaled[less] << 32) / total);
+        table[less].alias = more;
+        
+        // the larger choice makes up for what the column is missing
+        scaled[more] -= total - scaled[less];
+        
+        if (scaled[more] < total) {
+            large_count -= 1;
+            small[small_count++] = more;
+        }
+    }
+    
+    free(scaled);
+    free(small);
+    free(large);
+    
+    return 0;
+}
+
+static
+int32_t
+lxt_measure_generators(struct lxt_generator * const generators,
+                       struct lxt_template const * const template)
+{
+    // the state of each generator; unvisited, being measured or measured
+    enum { UNVISITED, MEASURING, MEASURED };
+    
+    struct lxt_frame {
+        uint32_t generator;
+        uint32_t op;
+    };
+    
+    uint32_t const count = template->generator_count;
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    struct lxt_frame * const stack = calloc(count, sizeof(struct lxt_frame));
+    uint8_t * const states = calloc(count, sizeof(uint8_t));
+    
+    if (stack == NULL || states == NULL) {
+        free(stack);
+        free(states);
+        
+        return -1;
+    }
+    
+    for (uint32_t root = 0; root < count; root++) {
+        if (states[root] != UNVISITED) {
+            continue;
+        }
+        
+        uint32_t depth = 0;
+        
+        stack[depth++] = (struct lxt_frame) { .generator = root, .op = 0 };
+        states[root] = MEASURING;
+        
+        while (depth > 0) {
+            struct lxt_frame * const frame = &stack[depth - 1];
+            struct lxt_generator * const generator =
+                &generators[frame->generator];
+            
+            if (frame->op == generator->op_count) {
+                states[frame->generator] = MEASURED;
+                
+                depth -= 1;
+                
+                continue;
+            }
+            
+            struct lxt_op const * const op =
+                &template->ops[generator->op_index + frame->op];
+            
+            uint64_t min = 0;
+            uint64_t max = 0;
+            uint64_t combinations = 1;
+            
+            if (op->kind == LXT_OP_TEXT) {
+                min = op->text.length;
+                max = op->text.length;
+            } else if (op->kind == LXT_OP_CONTAINER ||
+                       op->kind == LXT_OP_IMPORT) {
+                struct lxt_container const * container = NULL;
+                struct lxt_template const * owner = NULL;
+                
+                lxt_get_container(&container, &owner, op, template);
+                
+                for (uint32_t i = 0; i < container->entry_count; i++) {
+                    uint32_t const length =
+                        owner->entries[container->entry_index + i].length;
+                    
+                    if (i == 0 || length < min) {
+                        min = length;
+                    }
+                    
+                    if (length > max) {
+                        max = length;
+                    }
+                }
+                
+                if (container->entry_count > 0) {
+                    combinations = container->entry_count;
+                }
+            } else if (op->kind == LXT_OP_GENERATOR ||
+                       op->kind == LXT_OP_RECURSION) {
+                uint8_t const state = states[op->index];
+                
+                if (state == UNVISITED) {
+                    // measure the resolved generator first, then come back
+                    stack[depth++] = (struct lxt_frame) {
+                        .generator = op->index,
+                        .op = 0
+                    };
+                    
+                    states[op->index] = MEASURING;
+                    
+                    continue;
+                }
+                
+                if (state == MEASURING) {
+                    // recursive; may resolve any number of times
+                    max = LXT_LENGTH_UNBOUNDED;
+                    combinations = 0;
+                } else {
+                    min = generators[op->index].min_length;
+                    max = generators[op->index].max_length;
+                    combinations = generators[op->index].combinations;
+                }
+            }
+            
+            generator->min_length =
+                lxt_add_length(generator->min_length, min);
+            generator->max_length =
+                lxt_add_length(generator->max_length, max);
+            generator->combinations =
+                lxt_multiply_count(generator->combinations, combinations);
+            
+            frame->op += 1;
+        }
+    }
+    
+    free(stack);
+    free(states);
+    
+    return 0;
+}
+
+static
+uint64_t
+lxt_add_length(uint64_t const a,
+               uint64_t const b)
+{
+    if (a > LXT_LENGTH_UNBOUNDED - b) {
+        return LXT_LENGTH_UNBOUNDED;
+    }
+    
+    return a + b;
+}
+
+static
+uint64_t
+lxt_multiply_count(uint64_t const a,
+                   uint64_t const b)
+{
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    
+    if (a > UINT64_MAX / b) {
+        return UINT64_MAX;
+    }
+    
+    return a * b;
+}
+
+static
+uint32_t
+lxt_symbols_capacity(uint32_t const count)
+{
+    // keep the table at most half full, with at least one unused slot
+    // such that probing for a missing symbol always terminates
+    uint32_t capacity = 1;
+    
+    while (capacity < count * 2 + 1) {
+        capacity *= 2;
+    }
+    
+    return capacity;
+}
+
+static
+void
+lxt_symbols_insert(struct lxt_symbol * const slots,
+                   uint32_t const mask,
+                   struct lxt_span const name,
+                   uint32_t const index,
+                   char const * const pattern)
+{
+    struct lxt_token token;
+    
+    token.start = pattern + name.offset;
+    token.length = name.length;
+    
+    uint32_t const hash = lxt_token_hash(token);
+    
+    struct lxt_symbols const symbols = { slots, mask };
+    
+    if (lxt_symbols_find(symbols, token, hash, pattern) != SYMBOL_NONE) {
+        return;
+    }
+    
+    uint32_t slot = hash & mask;
+    
+    while (slots[slot].index != SYMBOL_NONE) {
+        slot = (slot + 1) & mask;
+    }
+    
+    slots[slot].name = name;
+    slots[slot].hash = hash;
+    slots[slot].index = index;
+}
+
+static
+uint32_t
+lxt_symbols_find(struct lxt_symbols const symbols,
+                 struct lxt_token const token,
+                 uint32_t const hash,
+                 char const * const pattern)
+{
+    uint32_t slot = hash & symbols.mask;
+    
+    while (symbols.slots[slot].index != SYMBOL_NONE) {
+        struct lxt_symbol const * const symbol = &symbols.slots[slot];
+        
+        if (symbol->hash == hash) {
+            struct lxt_token name;
+            
+            name.start = pattern + symbol->name.offset;
+            name.length = symbol->name.length;
+            
+            if (lxt_token_equals(token, name)) {
+                return symbol->index;
+            }
+        }
+        
+        slot = (slot + 1) & symbols.mask;
+    }
+    
+    return SYMBOL_NONE;
+}
@@ -1,35 +1,327 @@
 #pragma once
 
 #include "token.h" // lxt_token :completeness
+#include "arena.h" // lxt_list :completeness
+
+#include <lext/lext.h> // lxt_error
 
 #include <stddef.h> // size_t
-#include <stdint.h> // uint32_t, int32_t
+#include <stdint.h> // uint32_t, int32_t, UINT32_C
 #include <stdbool.h> // bool
 
-#define MAX_CONTAINERS (64)
-#define MAX_GENERATORS (64)
+/**
+ * Represents a tokenized string in the pattern of a template.
+ *
+ * Unlike a token, a span does not point to its string directly; instead
+ * it specifies an offset from the beginning of the pattern. This makes
+ * spans half the size of a token.
+ */
+struct lxt_span {
+    uint32_t offset;
+    uint32_t length;
+};
 
-#define MAX_CONTAINER_ENTRIES (128)
+/**
+ * Marks the offset of a span as an offset from the beginning of the
+ * literals of a template, rather than its pattern.
+ *
+ * Literals are text that an optimized template writes in one go, but that
+ * is not found in one piece in the pattern.
+ */
+#define LXT_SPAN_LITERAL (UINT32_C(1) << 31)
 
 struct lxt_container {
-    struct lxt_token entries[MAX_CONTAINER_ENTRIES];
-    struct lxt_token entry;
-    size_t entry_count;
+    struct lxt_span entry;
+    /**
+     * Index of the first entry of this container in the template entries.
+     *
+     * Entries of a container are always stored consecutively.
+     */
+    uint32_t entry_index;
+    uint32_t entry_count;
+    /**
+     * Index of the weight of the first entry of this container in the
+     * template weights.
+     *
+     * Only used if the entries are weighted.
+     */
+    uint32_t weight_index;
+    /**
+     * The sum of the weights of the entries of this container.
+     *
+     * The total is 0 if every entry is equally likely to be picked.
+     */
+    uint32_t weight_total;
+};
+
+/**
+ * Represents a weighted choice in an alias table.
+ *
+ * A choice is picked by first picking a column uniformly, and then either
+ * keeping the column or taking its alias. Choices also keep their
+ * cumulative weight, for picking in the same way as earlier versions did.
+ */
+struct lxt_weight {
+    /**
+     * The sum of the weight of this choice and every choice before it.
+     */
+    uint32_t cumulative;
+    /**
+     * The chance of keeping this column rather than its alias, as a
+     * fraction of 2^32.
+     */
+    uint32_t threshold;
+    uint32_t alias;
 };
 
 struct lxt_generator {
-    struct lxt_token entry;
-    struct lxt_token sequence;
+    struct lxt_span entry;
+    struct lxt_span sequence;
+    /**
+     * Index of the first operation of this generator in the template ops.
+     *
+     * Operations of a generator are always stored consecutively.
+     */
+    uint32_t op_index;
+    uint32_t op_count;
+    /**
+     * The minimum and maximum length of results of this generator.
+     *
+     * The maximum is LXT_LENGTH_UNBOUNDED if the generator is recursive.
+     */
+    uint64_t min_length;
+    uint64_t max_length;
+    /**
+     * The number of distinct combinations of entries that results of this
+     * generator are made from, saturating at UINT64_MAX.
+     *
+     * The count is 0 if the generator is recursive, as its combinations
+     * can not be counted.
+     */
+    uint64_t combinations;
+};
+
+/**
+ * Represents a container imported from a module of a library, or read from
+ * the lines of a file.
+ *
+ * The container belongs to the template of the module, which holds its
+ * entries; an imported container is never copied.
+ */
+struct lxt_import {
+    struct lxt_template const * template;
+    struct lxt_container const * container;
+    /**
+     * Whether the template of the container is owned by the importing
+     * template, and released along with it; only true for containers read
+     * from files by a library that copies them.
+     */
+    bool owned;
+};
+
+/**
+ * Represents the kind of an operation in a compiled sequence.
+ */
+enum lxt_op_kind {
+    /**
+     * Write the text of the operation.
+     *
+     * If the index of the operation is not 0, the text was folded from
+     * that many containers of a single entry (and any text following
+     * them); as many random numbers are then drawn before writing the
+     * text, exactly as picking from each container would.
+     */
+    LXT_OP_TEXT,
+    /**
+     * Write a random entry of the container at the index of the operation.
+     */
+    LXT_OP_CONTAINER,
+    /**
+     * Resolve the generator at the index of the operation.
+     */
+    LXT_OP_GENERATOR,
+    /**
+     * Resolve the generator at the index of the operation, unless that
+     * generator is already being resolved.
+     *
+     * Generators that can resolve themselves, directly or through other
+     * generators, are recursive; every operation that resolves a generator
+     * of the same recursive cycle is a recursion operation.
+     */
+    LXT_OP_RECURSION,
+    /**
+     * Resolve the variable named by the text of the operation.
+     *
+     * Variables only exist until a template is built, at which point
+     * they are linked to either a container or generator operation.
+     */
+    LXT_OP_VARIABLE,
+    /**
+     * Write a random entry of the imported container at the index of
+     * the operation.
+     */
+    LXT_OP_IMPORT,
+    /**
+     * Write the text of the operation as the only entry of a container;
+     * a random number is drawn first, exactly as picking would.
+     *
+     * Unlike text, a result that is cut off by this operation is not
+     * stopped until the next operation.
+     */
+    LXT_OP_ENTRY,
+    /**
+     * Run the only operation of the generator at the index of the
+     * operation, unless beyond the maximum depth, without resolving the
+     * generator itself.
+     *
+     * The operation of the generator is always a text or entry operation.
+     */
+    LXT_OP_INLINE
+};
+
+/**
+ * Represents an operation in a compiled sequence.
+ *
+ * A sequence is compiled into a flat list of operations that can be run
+ * without having to parse the sequence again. Text between variables
+ * is compiled into a single text operation.
+ */
+struct lxt_op {
+    uint32_t kind;
+    uint32_t index;
+    struct lxt_span text;
+};
+
+/**
+ * The most picks that a folded text operation can hold.
+ */
+#define MAX_PICKS (2)
+
+/**
+ * Represents a slot in a symbol table.
+ *
+ * The name is stored in the slot itself so that probing never has to look
+ * up the generator or container that the symbol points to.
+ */
+struct lxt_symbol {
+    struct lxt_span name;
+    uint32_t hash;
+    /**
+     * Index of the generator or container named by this symbol.
+     *
+     * The index of an unused slot is SYMBOL_NONE.
+     */
+    uint32_t index;
+};
+
+#define SYMBOL_NONE (UINT32_MAX)
+
+/**
+ * Represents an open-addressed hash table of symbols.
+ *
+ * The capacity of the table is always a power of two, such that the slot
+ * of a hash is found by masking it.
+ */
+struct lxt_symbols {
+    struct lxt_symbol const * slots;
+    uint32_t mask;
 };
 
+/**
+ * Represents a compiled template.
+ *
+ * The template is allocated as a single arena, with the template itself
+ * placed first and followed by each of its arrays:
+ *
+ *     [template|containers|generators|entries|ops|weights|imports|symbols]
+ *
+ * An optimized template places its literals last.
+ */
 struct lxt_template {
-    struct lxt_container containers[MAX_CONTAINERS];
-    struct lxt_generator generators[MAX_GENERATORS];
-    uint32_t * seed;
-    size_t container_count;
-    size_t generator_count;
+    char const * pattern;
+    struct lxt_container const * containers;
+    struct lxt_generator const * generators;
+    struct lxt_span const * entries;
+    struct lxt_op const * ops;
+    /**
+     * The alias tables of weighted generators and container entries.
+     *
+     * If generators are weighted, their table comes first.
+     */
+    struct lxt_weight const * weights;
+    /**
+     * The containers imported from modules of a library, if any.
+     *
+     * The modules must outlive the template.
+     */
+    struct lxt_import const * imports;
+    /**
+     * The text of spans marked as literals, if any; see LXT_SPAN_LITERAL.
+     */
+    char const * literals;
+    struct lxt_symbols container_symbols;
+    struct lxt_symbols generator_symbols;
+    uint32_t container_count;
+    uint32_t generator_count;
+    uint32_t entry_count;
+    uint32_t op_count;
+    uint32_t weight_count;
+    uint32_t import_count;
+    uint32_t literal_length;
+    /**
+     * The sum of the weights of generators.
+     *
+     * The total is 0 if every generator is equally likely to be picked.
+     */
+    uint32_t generator_weight_total;
+    /**
+     * The image file that the template was loaded from, if any.
+     *
+     * A template loaded from an image does not own an arena; its arrays
+     * point directly into the image instead.
+     */
+    void * image;
+    size_t image_length;
+    bool image_mapped;
+};
+
+/**
+ * Represents a template while it is being parsed.
+ *
+ * Items are staged in growable lists until the final size of the template
+ * is known, at which point they are moved into an arena.
+ */
+struct lxt_builder {
+    char const * pattern;
+    /**
+     * The library that modules are imported from, if any.
+     */
+    struct lxt_library * library;
+    struct lxt_list containers;
+    struct lxt_list generators;
+    struct lxt_list entries;
+    struct lxt_list ops;
+    /**
+     * The weight of each entry and generator, in order.
+     */
+    struct lxt_list entry_weights;
+    struct lxt_list generator_weights;
+    /**
+     * The names of imported modules, in order.
+     */
+    struct lxt_list imports;
+    /**
+     * The names of containers read from lines files, in order.
+     */
+    struct lxt_list lines;
 };
 
+/**
+ * Get a token pointing to the string of a span in a template.
+ */
+struct lxt_token lxt_get_token(struct lxt_template const *,
+                               struct lxt_span);
+
 /**
  * Get a pointer to a generator by name.
  *
@@ -37,20 +329,138 @@ struct lxt_template {
  */
 void lxt_get_generator(struct lxt_generator const **,
                        struct lxt_template const *,
-                       char const * name);
+                       char const * name,
+                       struct lxt_rng * rng);
+
+/**
+ * Get the container that a container or import operation picks from.
+ *
+ * The owner is set to the template holding the entries of the container;
+ * for imported containers, the template of their module.
+ */
+void lxt_get_container(struct lxt_container const **,
+                       struct lxt_template const ** owner,
+                       struct lxt_op const *,
+                       struct lxt_template const *);
+
+/**
+ * Pick a random choice from an alias table of weighted choices.
+ *
+ * Takes a single random number, except for xorshift32 generators, which
+ * pick by cumulative weight such that seeds keep reproducing the results
+ * of earlier versions.
+ */
+uint32_t lxt_pick(struct lxt_weight const *,
+                  uint32_t count,
+                  uint32_t total,
+                  struct lxt_rng *);
 
+/**
+ * Find a generator by name.
+ *
+ * The hash must be the hash of the name token, as given by `lxt_token_hash`.
+ */
 bool lxt_find_generator(struct lxt_generator const **,
                         struct lxt_token,
+                        uint32_t hash,
                         struct lxt_template const *);
+/**
+ * Find a container by name.
+ *
+ * The hash must be the hash of the name token, as given by `lxt_token_hash`.
+ */
 bool lxt_find_container(struct lxt_container const **,
                         struct lxt_token,
+                        uint32_t hash,
                         struct lxt_template const *);
 
-int32_t lxt_append_container(struct lxt_template *,
-                             struct lxt_token);
-int32_t lxt_append_container_entry(struct lxt_template *,
-                                   struct lxt_token);
-int32_t lxt_append_generator(struct lxt_template *,
+int32_t lxt_append_container(struct lxt_builder *,
                              struct lxt_token);
-int32_t lxt_append_sequence(struct lxt_template *,
+int32_t lxt_append_container_entry(struct lxt_builder *,
+                                   struct lxt_token,
+                                   uint32_t weight);
+int32_t lxt_append_generator(struct lxt_builder *,
+                             struct lxt_token,
+                             uint32_t weight);
+/**
+ * Append the name of a module to import containers from.
+ */
+int32_t lxt_append_import(struct lxt_builder *,
+                          struct lxt_token);
+/**
+ * Append the name of a container whose entries are the lines of a file.
+ */
+int32_t lxt_append_lines(struct lxt_builder *,
+                         struct lxt_token);
+int32_t lxt_append_sequence(struct lxt_builder *,
                             struct lxt_token);
+/**
+ * Append an operation to the sequence of the generator at a given index.
+ *
+ * Operations must be appended in order of generators.
+ */
+int32_t lxt_append_op(struct lxt_builder *,
+                      size_t generator_index,
+                      enum lxt_op_kind,
+                      struct lxt_token);
+
+/**
+ * Fold runs of duplicate entries of each container into a single weighted
+ * entry.
+ *
+ * Only consecutive duplicates are folded, so that seeded picks are the
+ * same as if every duplicate was kept. The weights of each container are
+ * totaled in the process; the template is invalid if a total does not fit
+ * in 32 bits.
+ */
+enum lxt_error lxt_fold_entries(struct lxt_builder *);
+
+/**
+ * Move the parsed contents of a builder into a newly allocated template.
+ *
+ * Variables are linked to their containers or generators in the process,
+ * or else to a container read from a file or imported from a module; the
+ * template is invalid if any variable can not be linked. Files and modules
+ * are looked up in the library of the builder, and read or compiled, only
+ * once a variable needs them. Operations that close a recursive cycle are
+ * then marked as recursion operations, and each generator is measured.
+ * Alias tables are built for weighted generators and containers.
+ *
+ * The template is released using `free`.
+ */
+enum lxt_error lxt_build(struct lxt_template **,
+                         struct lxt_builder const *);
+void lxt_builder_free(struct lxt_builder *);
+
+/**
+ * Rewrite the operations of a template such that results are generated
+ * using as few operations as possible, reallocating the template.
+ *
+ * Containers of a single entry are written as entry operations, and any
+ * run of them, along with the text that follows, is folded into a single
+ * literal; empty containers and generators are removed, and generators of
+ * a single text or entry operation are inlined into their callers.
+ * Results are the same as those of the template before optimizing, for
+ * any random number generator, and so are the random numbers drawn.
+ *
+ * Whether a generator is resolved depends on the maximum depth, which is
+ * only known when generating; so an inlined operation is kept apart from
+ * the literals around it, and generators of more than one operation are
+ * never inlined.
+ */
+enum lxt_error lxt_optimize(struct lxt_template **);
+
+/**
+ * Read an entire file into the image of a template; either mapped or
+ * allocated.
+ *
+ * A file is only mapped if allowed; a mapping reflects any later changes to
+ * the file, so files that may change while in use must not be mapped.
+ */
+enum lxt_error lxt_read_image(struct lxt_template *,
+                              char const * filename,
+                              bool map);
+/**
+ * Release the image that a template was loaded from, if any.
+ */
+void lxt_release_image(struct lxt_template *);
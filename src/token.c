@@ -1,7 +1,9 @@
 #include "token.h" // lxt_token, lxt_token_*
 #include "cursor.h" // lxt_cursor_spaces
+#include "scan.h" // lxt_class_is, LXT_CLASS_IDENTIFIER, LXT_CLASS_SPACE
 
 #include <stddef.h> // size_t
+#include <stdint.h> // uint32_t, uint64_t, UINT32_MAX
 #include <stdbool.h> // bool
 #include <string.h> // strncmp
 
@@ -15,6 +17,55 @@ lxt_token_trim(struct lxt_token * const token)
     lxt_token_trim_trailing(token);
 }
 
+bool
+lxt_token_weight(struct lxt_token * const token,
+                 uint32_t * const weight)
+{
+    *weight = 1;
+    
+    size_t digits = 0;
+    
+    while (digits < token->length &&
+           token->start[token->length - 1 - digits] >= '0' &&
+           token->start[token->length - 1 - digits] <= '9') {
+        digits += 1;
+    }
+    
+    // a weight needs at least some text, a space and a star before it
+    if (digits == 0 || token->length < digits + 3) {
+        return true;
+    }
+    
+    size_t const star = token->length - 1 - digits;
+    
+    if (token->start[star] != '*' ||
+        !lxt_class_is(token->start[star - 1], LXT_CLASS_SPACE)) {
+        return true;
+    }
+    
+    uint64_t value = 0;
+    
+    for (size_t i = star + 1; i < token->length; i++) {
+        value = value * 10 + (uint64_t)(token->start[i] - '0');
+        
+        if (value > UINT32_MAX) {
+            return false;
+        }
+    }
+    
+    if (value == 0) {
+        return false;
+    }
+    
+    token->length = star;
+    
+    lxt_token_trim(token);
+    
+    *weight = (uint32_t)value;
+    
+    return true;
+}
+
 bool
 lxt_token_equals(struct lxt_token const token,
                  struct lxt_token const other)
@@ -30,6 +81,20 @@ lxt_token_equals(struct lxt_token const token,
     return true;
 }
 
+uint32_t
+lxt_token_hash(struct lxt_token const token)
+{
+    // 32-bit FNV-1a
+    uint32_t hash = 2166136261UL;
+    
+    for (size_t i = 0; i < token.length; i++) {
+        hash ^= (unsigned char)token.start[i];
+        hash *= 16777619UL;
+    }
+    
+    return hash;
+}
+
 bool
 lxt_token_validates(struct lxt_token token,
                     enum lxt_kind const kind)
@@ -54,15 +119,7 @@ lxt_token_validates(struct lxt_token token,
 bool
 lxt_token_character(char const character)
 {
-    bool const is_numerical =
-        (character >= '0' &&
-         character <= '9');
-    
-    bool const is_alphabetical =
-        (character >= 'A' && character <= 'Z') ||
-        (character >= 'a' && character <= 'z');
-    
-    return is_numerical || is_alphabetical || character == '_';
+    return lxt_class_is(character, LXT_CLASS_IDENTIFIER);
 }
 
 bool
@@ -138,6 +195,7 @@ lxt_token_trim_leading(struct lxt_token * const token)
     }
     
     size_t const leading = lxt_cursor_spaces(token->start,
+                                             token->length,
                                              LXT_CURSOR_DIRECTION_FORWARD);
     
     token->start = token->start + leading;
@@ -158,6 +216,7 @@ lxt_token_trim_trailing(struct lxt_token * const token)
     }
     
     size_t const trailing = lxt_cursor_spaces(token->start + token->length - 1,
+                                              token->length,
                                               LXT_CURSOR_DIRECTION_REVERSE);
     
     if (token->length >= trailing) {
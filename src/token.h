@@ -1,10 +1,16 @@
 #pragma once
 
 #include <stddef.h> // size_t
+#include <stdint.h> // uint32_t
 #include <stdbool.h> // bool
 
 #define VARIABLE_CHARACTER '@'
 #define COMMENT_CHARACTER '#'
+// a comment starting with this directive imports a module of a library
+#define IMPORT_DIRECTIVE "#import"
+// a comment starting with this directive declares a container whose entries
+// are the lines of a file of a library
+#define LINES_DIRECTIVE "#lines"
 
 /**
  * Represents a tokenized string in a template.
@@ -57,12 +63,31 @@ enum lxt_kind {
  */
 void lxt_token_trim(struct lxt_token *);
 
+/**
+ * Split a weight off the end of a token.
+ *
+ * A weight is written as `*` followed by a number, and is separated from
+ * the text before it by whitespace; for example, `common *3`. The token is
+ * trimmed to the text before the weight. If there is no weight, the token is
+ * left unchanged and the weight is 1.
+ *
+ * Returns false if the weight is zero or does not fit in 32 bits.
+ */
+bool lxt_token_weight(struct lxt_token *, uint32_t * weight);
+
 /**
  * Determine whether a token equals another token.
  */
 bool lxt_token_equals(struct lxt_token,
                       struct lxt_token other);
 
+/**
+ * Get the hash of a token.
+ *
+ * Equal tokens always have equal hashes.
+ */
+uint32_t lxt_token_hash(struct lxt_token);
+
 /**
  * Determine whether a token identifier consist of only valid characters.
  */
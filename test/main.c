@@ -1,7 +1,9 @@
 #include <lext/lext.h> // lxt_*
 
 #include <assert.h> // assert
-#include <string.h> // strcmp
+#include <stdbool.h> // bool
+#include <stdio.h> // sprintf, tmpfile, ftell, fopen, fputs, fclose, remove
+#include <string.h> // strcmp, strncmp, strlen, memcmp, memcpy
 
 static
 void
@@ -46,6 +48,13 @@ test_invalid_template(void)
                     LXT_OPTS_NONE);
 
     assert(error == LXT_ERROR_INVALID_TEMPLATE);
+
+    // undefined variable
+    error = lxt_gen(buffer, sizeof(buffer),
+                    "container (entry) sequence <@undefined>",
+                    LXT_OPTS_NONE);
+
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
 }
 
 static
@@ -151,6 +160,19 @@ test_various(void)
     assert(error == LXT_ERROR_NONE);
     assert(strcmp(buffer, "a, 1<2, (a)") == 0);
     
+    // should parse entries, sequences and comments longer than a block
+    char large_buffer[128];
+    
+    error = lxt_gen(large_buffer, sizeof(large_buffer),
+                    "# a comment that is a fair bit longer than 32 characters\n"
+                    "container (an entry that is longer than 32 characters)"
+                    "sequence <@container, and a sequence of 32 or more>",
+                    LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(large_buffer, "an entry that is longer than 32 characters, "
+                                "and a sequence of 32 or more") == 0);
+    
     // should skip variables leading to infinite recursion
     error = lxt_gen(buffer, sizeof(buffer),
                     "container (entry) sequence <@sequence a>",
@@ -160,12 +182,2147 @@ test_various(void)
     assert(strcmp(buffer, " a") == 0);
 }
 
+static
+void
+test_large_template(void)
+{
+    enum lxt_error error;
+    char buffer[64];
+    char pattern[8192];
+    
+    size_t length = 0;
+    
+    // should allow more than 128 entries in a container
+    length += (size_t)sprintf(pattern + length, "numbers (");
+    
+    for (uint32_t i = 0; i < 1000; i++) {
+        length += (size_t)sprintf(pattern + length, "%u, ", i);
+    }
+    
+    length += (size_t)sprintf(pattern + length, "last)");
+    
+    // should allow more than 64 containers
+    for (uint32_t i = 0; i < 100; i++) {
+        length += (size_t)sprintf(pattern + length, " c%u (c%u)", i, i);
+    }
+    
+    sprintf(pattern + length, " sequence <@c99 @numbers>");
+    
+    uint32_t seed = 1;
+    
+    error = lxt_gen(buffer, sizeof(buffer), pattern, (struct lxt_opts) {
+        .generator = NULL,
+        .seed = &seed
+    });
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strncmp(buffer, "c99 ", 4) == 0);
+    
+    // should allow generators in templates without containers
+    error = lxt_gen(buffer, sizeof(buffer),
+                    "sequence <text>",
+                    LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "text") == 0);
+}
+
+static
+void
+test_compiled(void)
+{
+    enum lxt_error error;
+    char buffer[64];
+    
+    struct lxt_template * template = NULL;
+    
+    // should not compile invalid template
+    error = lxt_compile(&template, "conta iner (entry) sequence <@container>");
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    assert(template == NULL);
+    
+    error = lxt_compile(&template, "letter (a, b, c) sequence <@letter>");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(template != NULL);
+    
+    // should generate identically to uncompiled patterns
+    for (uint32_t i = 0; i < 8; i++) {
+        char expected[64];
+        
+        uint32_t seed = i + 1;
+        uint32_t expected_seed = seed;
+        
+        error = lxt_gen_compiled(buffer, sizeof(buffer), template,
+                                 (struct lxt_opts) {
+            .generator = NULL,
+            .seed = &seed
+        });
+        
+        assert(error == LXT_ERROR_NONE);
+        
+        error = lxt_gen(expected, sizeof(expected),
+                        "letter (a, b, c) sequence <@letter>",
+                        (struct lxt_opts) {
+            .generator = NULL,
+            .seed = &expected_seed
+        });
+        
+        assert(error == LXT_ERROR_NONE);
+        assert(strcmp(buffer, expected) == 0);
+        assert(seed == expected_seed);
+    }
+    
+    lxt_free(template);
+}
+
+static
+void
+test_batch(void)
+{
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template,
+                        "letter (a, b, c) "
+                        "long (a result that is longer than any buffer "
+                        "a batch starts out with; forcing the batch to "
+                        "grow while generating a result, which in turn "
+                        "should not change or cut off any result at all) "
+                        "short <@letter@letter> "
+                        "long <@long @long>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_batch batch = LXT_BATCH_EMPTY;
+    
+    uint32_t seed = 1;
+    
+    error = lxt_gen_batch(&batch, 100, template, (struct lxt_opts) {
+        .generator = NULL,
+        .seed = &seed
+    });
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(batch.count == 100);
+    assert(batch.offsets[0] == 0);
+    
+    // should generate the same results as generating one at a time
+    uint32_t expected_seed = 1;
+    
+    for (size_t i = 0; i < batch.count; i++) {
+        char expected[512];
+        
+        error = lxt_gen_compiled(expected, sizeof(expected), template,
+                                 (struct lxt_opts) {
+            .generator = NULL,
+            .seed = &expected_seed
+        });
+        
+        assert(error == LXT_ERROR_NONE);
+        
+        size_t const length = (size_t)(batch.offsets[i + 1] -
+                                       batch.offsets[i]);
+        
+        assert(length == strlen(expected));
+        assert(memcmp(batch.data + batch.offsets[i], expected, length) == 0);
+    }
+    
+    assert(seed == expected_seed);
+    
+    // should append to existing results
+    error = lxt_gen_batch(&batch, 10, template, (struct lxt_opts) {
+        .generator = "short",
+        .seed = &seed
+    });
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(batch.count == 110);
+    assert(batch.offsets[110] - batch.offsets[109] == 2);
+    
+    lxt_batch_clear(&batch);
+    
+    assert(batch.count == 0);
+    
+    lxt_batch_free(&batch);
+    lxt_free(template);
+}
+
+static
+bool
+batch_equals(struct lxt_batch const * const batch,
+             size_t const index,
+             struct lxt_batch const * const other,
+             size_t const other_index)
+{
+    int64_t const length = batch->offsets[index + 1] - batch->offsets[index];
+    int64_t const other_length = (other->offsets[other_index + 1] -
+                                  other->offsets[other_index]);
+    
+    if (length != other_length) {
+        return false;
+    }
+    
+    return memcmp(batch->data + batch->offsets[index],
+                  other->data + other->offsets[other_index],
+                  (size_t)length) == 0;
+}
+
+static
+void
+test_batch_parallel(void)
+{
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template,
+                        "letter (a, b, c, d, e, f, g, h) "
+                        "digit (0, 1, 2, 3, 4, 5, 6, 7, 8, 9) "
+                        "word <@letter@letter@letter@letter> "
+                        "number <@digit@digit@digit>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    uint32_t seed = 42;
+    
+    struct lxt_opts const options = {
+        .generator = NULL,
+        .seed = &seed
+    };
+    
+    struct lxt_batch single = LXT_BATCH_EMPTY;
+    struct lxt_batch multiple = LXT_BATCH_EMPTY;
+    struct lxt_batch ranges = LXT_BATCH_EMPTY;
+    
+    error = lxt_gen_batch_parallel(&single, 0, 3000, template, options, 1);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(single.count == 3000);
+    assert(seed == 42);
+    
+    error = lxt_gen_batch_parallel(&multiple, 0, 3000, template, options, 4);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(multiple.count == 3000);
+    
+    // should generate ranges separately, in any order
+    error = lxt_gen_batch_parallel(&ranges, 0, 1500, template, options, 0);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_gen_batch_parallel(&ranges, 1500, 1500, template, options, 3);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(ranges.count == 3000);
+    
+    // should generate identical results regardless of number of jobs
+    bool all_equal = true;
+    
+    for (size_t i = 0; i < single.count; i++) {
+        all_equal = all_equal && batch_equals(&single, i, &multiple, i);
+        all_equal = all_equal && batch_equals(&single, i, &ranges, i);
+    }
+    
+    assert(all_equal);
+    
+    // should not generate identical results for every index
+    assert(!batch_equals(&single, 0, &single, 1) ||
+           !batch_equals(&single, 1, &single, 2));
+    
+    lxt_batch_free(&single);
+    lxt_batch_free(&multiple);
+    lxt_batch_free(&ranges);
+    lxt_free(template);
+}
+
+static
+uint32_t
+custom_next(void * const context)
+{
+    (void)context;
+    
+    return 0;
+}
+
+static
+void
+test_rng(void)
+{
+    struct lxt_rng rng;
+    
+    // should match the reference implementation of PCG32
+    lxt_rng_init(&rng, 42, 54);
+    
+    assert(lxt_rng_next(&rng) == 0xa15c02b7);
+    assert(lxt_rng_next(&rng) == 0x7b47f409);
+    assert(lxt_rng_next(&rng) == 0xba1d3330);
+    
+    // should jump ahead to the same state as stepping
+    struct lxt_rng stepped;
+    struct lxt_rng jumped;
+    
+    lxt_rng_init(&stepped, 7, 0);
+    lxt_rng_init(&jumped, 7, 0);
+    
+    for (uint32_t i = 0; i < 1000; i++) {
+        lxt_rng_next(&stepped);
+    }
+    
+    lxt_rng_advance(&jumped, 1000);
+    
+    assert(lxt_rng_next(&stepped) == lxt_rng_next(&jumped));
+    
+    // should split into identical generators for identical streams
+    struct lxt_rng first;
+    struct lxt_rng second;
+    
+    assert(lxt_rng_split(&first, &rng, 3) == LXT_ERROR_NONE);
+    assert(lxt_rng_split(&second, &rng, 3) == LXT_ERROR_NONE);
+    assert(lxt_rng_next(&first) == lxt_rng_next(&second));
+    
+    assert(lxt_rng_split(&second, &rng, 4) == LXT_ERROR_NONE);
+    assert(lxt_rng_next(&first) != lxt_rng_next(&second));
+    
+    // should never draw outside of bounds
+    for (uint32_t bound = 1; bound < 1000; bound += 7) {
+        assert(lxt_rng_bounded(&rng, bound) < bound);
+    }
+    
+    // should reproduce results of a seed
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template,
+                        "letter (a, b, c, d, e, f, g, h) "
+                        "word <@letter@letter@letter@letter>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    char seeded[16];
+    char generated[16];
+    
+    uint32_t seed = 42;
+    
+    lxt_rng_init_xorshift32(&rng, 42);
+    
+    lxt_gen_compiled(seeded, sizeof(seeded), template, (struct lxt_opts) {
+        .generator = NULL,
+        .seed = &seed,
+        .rng = NULL
+    });
+    
+    lxt_gen_compiled(generated, sizeof(generated), template, (struct lxt_opts) {
+        .generator = NULL,
+        .seed = NULL,
+        .rng = &rng
+    });
+    
+    assert(strcmp(seeded, generated) == 0);
+    assert(seed == (uint32_t)rng.state);
+    
+    // should not split custom generators
+    lxt_rng_init_custom(&rng, custom_next, NULL);
+    
+    struct lxt_batch batch = LXT_BATCH_EMPTY;
+    
+    error = lxt_gen_batch_parallel(&batch, 0, 10, template, (struct lxt_opts) {
+        .generator = NULL,
+        .seed = NULL,
+        .rng = &rng
+    }, 1);
+    
+    assert(error == LXT_ERROR_UNSUPPORTED);
+    
+    // should generate from custom generators
+    lxt_gen_compiled(generated, sizeof(generated), template, (struct lxt_opts) {
+        .generator = NULL,
+        .seed = NULL,
+        .rng = &rng
+    });
+    
+    assert(strcmp(generated, "aaaa") == 0);
+    
+    lxt_batch_free(&batch);
+    lxt_free(template);
+}
+
+static
+int32_t
+failing_write(void * const context,
+              char const * const data,
+              size_t const length)
+{
+    (void)context;
+    (void)data;
+    (void)length;
+    
+    return -1;
+}
+
+static
+void
+test_sink(void)
+{
+    enum lxt_error error;
+    
+    // a result much larger than the internal block of a sink
+    char pattern[16384];
+    
+    size_t length = (size_t)sprintf(pattern,
+                                    "letter (a, b, c) "
+                                    "long <");
+    
+    for (size_t i = 0; i < 1200; i++) {
+        length += (size_t)sprintf(pattern + length, "@letter-- ");
+    }
+    
+    sprintf(pattern + length, ">");
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template, pattern);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    uint32_t seed = 7;
+    uint32_t batch_seed = 7;
+    
+    struct lxt_buffer buffer = LXT_BUFFER_EMPTY;
+    struct lxt_sink sink;
+    
+    lxt_sink_buffer(&sink, &buffer);
+    
+    error = lxt_gen_sink(&sink, template, (struct lxt_opts) {
+        .generator = NULL,
+        .seed = &seed,
+        .rng = NULL
+    });
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(buffer.length == 1200 * 4 - 1);
+    
+    // should generate the same result as a batch, with the same seed
+    struct lxt_batch batch = LXT_BATCH_EMPTY;
+    
+    error = lxt_gen_batch(&batch, 1, template, (struct lxt_opts) {
+        .generator = NULL,
+        .seed = &batch_seed,
+        .rng = NULL
+    });
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(batch.offsets[1] == (int64_t)buffer.length);
+    assert(memcmp(batch.data, buffer.data, buffer.length) == 0);
+    assert(seed == batch_seed);
+    
+    // should write to files
+    FILE * const file = tmpfile();
+    
+    if (file != NULL) {
+        seed = 7;
+        
+        lxt_sink_file(&sink, file);
+        
+        error = lxt_gen_sink(&sink, template, (struct lxt_opts) {
+            .generator = NULL,
+            .seed = &seed,
+            .rng = NULL
+        });
+        
+        assert(error == LXT_ERROR_NONE);
+        assert(ftell(file) == (long)buffer.length);
+        
+        fclose(file);
+    }
+    
+    // should fail if the sink fails
+    sink.write = failing_write;
+    sink.context = NULL;
+    
+    error = lxt_gen_sink(&sink, template, LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_WRITE_FAILED);
+    
+    lxt_batch_free(&batch);
+    lxt_buffer_free(&buffer);
+    lxt_free(template);
+}
+
+static
+void
+test_measure(void)
+{
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template,
+                        "letter (a, bb, ccc) "
+                        "empty () "
+                        "word <@letter-@letter@empty> "
+                        "phrase <@word and @word> "
+                        "ping <ping @pong> "
+                        "pong <pong @ping>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_bounds bounds;
+    
+    error = lxt_measure(&bounds, template, "word");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(bounds.min == 3 && bounds.max == 7);
+    
+    error = lxt_measure(&bounds, template, "phrase");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(bounds.min == 11 && bounds.max == 19);
+    
+    // should be unbounded when recursive
+    error = lxt_measure(&bounds, template, "ping");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(bounds.min >= 5 && bounds.max == LXT_LENGTH_UNBOUNDED);
+    
+    // should cover every generator when not specifying one
+    error = lxt_measure(&bounds, template, NULL);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(bounds.min == 3 && bounds.max == LXT_LENGTH_UNBOUNDED);
+    
+    // should generate results within bounds
+    uint32_t seed = 1;
+    
+    for (uint32_t i = 0; i < 100; i++) {
+        char buffer[32];
+        
+        lxt_gen_compiled(buffer, sizeof(buffer), template, (struct lxt_opts) {
+            .generator = "phrase",
+            .seed = &seed,
+            .rng = NULL
+        });
+        
+        assert(strlen(buffer) >= 11 && strlen(buffer) <= 19);
+    }
+    
+    // should list each generator
+    assert(lxt_generator_count(template) == 4);
+    
+    struct lxt_generator_info info;
+    
+    error = lxt_generator_at(&info, template, 1);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strncmp(info.name, "phrase", info.name_length) == 0);
+    assert(info.bounds.min == 11 && info.bounds.max == 19);
+    
+    error = lxt_generator_at(&info, template, 4);
+    
+    assert(error == LXT_ERROR_GENERATOR_NOT_FOUND);
+    
+    lxt_free(template);
+}
+
+static
+void
+test_compile_length(void)
+{
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    
+    // should only compile the given length of a pattern
+    char const * const pattern = "letter (a) word <@letter@letter> word2 <b>";
+    
+    error = lxt_compile_length(&template, pattern, 32);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(lxt_generator_count(template) == 1);
+    
+    char buffer[8];
+    
+    lxt_gen_compiled(buffer, sizeof(buffer), template, LXT_OPTS_NONE);
+    
+    assert(strcmp(buffer, "aa") == 0);
+    
+    lxt_free(template);
+    
+    // should not read beyond a pattern that is not null-terminated,
+    // for example when ending in whitespace
+    char const unterminated[] = {
+        'w', ' ', '<', 'x', ' ', ' ', '>', ' ', ' '
+    };
+    
+    error = lxt_compile_length(&template, unterminated, sizeof(unterminated));
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    lxt_gen_compiled(buffer, sizeof(buffer), template, LXT_OPTS_NONE);
+    
+    assert(strcmp(buffer, "x") == 0);
+    
+    lxt_free(template);
+}
+
+static
+void
+test_image(void)
+{
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template,
+                        "# a comment that is left out of the image\n"
+                        "letter (a, b, c, d) "
+                        "word <@letter@letter@letter> "
+                        "phrase <@word and @word> "
+                        "# another comment");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_buffer image = LXT_BUFFER_EMPTY;
+    struct lxt_sink sink;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_template * loaded = NULL;
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    // should generate identical results
+    uint32_t seed = 3;
+    uint32_t loaded_seed = 3;
+    
+    bool all_equal = true;
+    
+    for (uint32_t i = 0; i < 100; i++) {
+        char buffer[32];
+        char loaded_buffer[32];
+        
+        lxt_gen_compiled(buffer, sizeof(buffer), template, (struct lxt_opts) {
+            .generator = i % 2 == 0 ? "phrase" : NULL,
+            .seed = &seed,
+            .rng = NULL
+        });
+        
+        lxt_gen_compiled(loaded_buffer, sizeof(loaded_buffer), loaded,
+                         (struct lxt_opts) {
+            .generator = i % 2 == 0 ? "phrase" : NULL,
+            .seed = &loaded_seed,
+            .rng = NULL
+        });
+        
+        all_equal = all_equal && strcmp(buffer, loaded_buffer) == 0;
+    }
+    
+    assert(all_equal);
+    
+    struct lxt_bounds bounds;
+    
+    error = lxt_measure(&bounds, loaded, "phrase");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(bounds.min == 11 && bounds.max == 11);
+    
+    lxt_free(loaded);
+    
+    // should not load damaged images
+    error = lxt_load(&loaded, image.data, image.length - 8);
+    
+    assert(error == LXT_ERROR_INVALID_IMAGE);
+    assert(loaded == NULL);
+    
+    image.data[0] = 'X';
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_INVALID_IMAGE);
+    
+    lxt_buffer_free(&image);
+    lxt_free(template);
+}
+
+static
+bool
+damage_ops(struct lxt_buffer * const image,
+           uint32_t const (* const ops)[2],
+           uint32_t const (* const damaged)[2],
+           size_t const count)
+{
+    // operations are stored as kind, index and text span; sections (and
+    // every operation in them) are aligned to 8 bytes
+    size_t const op_size = sizeof(uint32_t) * 4;
+    
+    for (size_t offset = 0;
+         offset + op_size * count <= image->length;
+         offset += 8) {
+        bool matches = true;
+        
+        for (size_t i = 0; i < count && matches; i++) {
+            uint32_t op[2];
+            
+            memcpy(op, image->data + offset + op_size * i, sizeof(op));
+            
+            matches = op[0] == ops[i][0] && op[1] == ops[i][1];
+        }
+        
+        if (matches) {
+            for (size_t i = 0; i < count; i++) {
+                memcpy(image->data + offset + op_size * i, damaged[i],
+                       sizeof(damaged[i]));
+            }
+            
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static
+void
+test_damaged_image(void)
+{
+    // operation kinds, as numbered by templates
+    enum {
+        OP_TEXT = 0,
+        OP_CONTAINER = 1,
+        OP_GENERATOR = 2,
+        OP_RECURSION = 3,
+        OP_ENTRY = 6
+    };
+    
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template, "a (x, y) b <@a> g <@b@b>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_buffer image = LXT_BUFFER_EMPTY;
+    struct lxt_sink sink;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_template * loaded = NULL;
+    
+    // should not load generators that resolve themselves
+    uint32_t const ops[][2] = {
+        { OP_CONTAINER, 0 },
+        { OP_GENERATOR, 0 },
+        { OP_GENERATOR, 0 }
+    };
+    
+    uint32_t const resolving_itself[][2] = {
+        { OP_CONTAINER, 0 },
+        { OP_GENERATOR, 1 },
+        { OP_GENERATOR, 1 }
+    };
+    
+    assert(damage_ops(&image, ops, resolving_itself, 3));
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_INVALID_IMAGE);
+    assert(loaded == NULL);
+    
+    lxt_buffer_free(&image);
+    
+    // should not load combinations of generators that can recurse
+    image = LXT_BUFFER_EMPTY;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    uint32_t const recursing[][2] = {
+        { OP_CONTAINER, 0 },
+        { OP_RECURSION, 0 },
+        { OP_RECURSION, 0 }
+    };
+    
+    assert(damage_ops(&image, ops, recursing, 3));
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_INVALID_IMAGE);
+    assert(loaded == NULL);
+    
+    lxt_buffer_free(&image);
+    lxt_free(template);
+    
+    // should load generators that recurse
+    error = lxt_compile(&template, "a (x, y) b <@a@g> g <@b@b>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    image = LXT_BUFFER_EMPTY;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    lxt_free(loaded);
+    lxt_buffer_free(&image);
+    lxt_free(template);
+    
+    // should not load text that folds more picks than text can hold
+    error = lxt_compile(&template, "a (x, y) b (z) g <@a.@b->");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    image = LXT_BUFFER_EMPTY;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    uint32_t const folded[][2] = {
+        { OP_CONTAINER, 0 },
+        { OP_TEXT, 0 },
+        { OP_TEXT, 1 }
+    };
+    
+    uint32_t const overfolded[][2] = {
+        { OP_CONTAINER, 0 },
+        { OP_TEXT, 0 },
+        { OP_TEXT, 3 }
+    };
+    
+    assert(damage_ops(&image, folded, overfolded, 3));
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_INVALID_IMAGE);
+    assert(loaded == NULL);
+    
+    lxt_buffer_free(&image);
+    lxt_free(template);
+    
+    // should not load entries that fold any picks
+    error = lxt_compile(&template, "a (x) b (y, z) g <@a@b>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    image = LXT_BUFFER_EMPTY;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    uint32_t const entry[][2] = {
+        { OP_ENTRY, 0 },
+        { OP_CONTAINER, 1 }
+    };
+    
+    uint32_t const folded_entry[][2] = {
+        { OP_ENTRY, 1 },
+        { OP_CONTAINER, 1 }
+    };
+    
+    assert(damage_ops(&image, entry, folded_entry, 2));
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_INVALID_IMAGE);
+    assert(loaded == NULL);
+    
+    lxt_buffer_free(&image);
+    lxt_free(template);
+}
+
+static
+void
+test_recursion(void)
+{
+    enum lxt_error error;
+    char buffer[64];
+    
+    struct lxt_opts options = LXT_OPTS_NONE;
+    
+    options.generator = "a";
+    
+    // should stop resolving generators that are already being resolved
+    error = lxt_gen(buffer, sizeof(buffer),
+                    "a <x@b> b <y@a>",
+                    options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "xy") == 0);
+    
+    // should skip generators beyond the maximum depth
+    options.max_depth = 2;
+    
+    error = lxt_gen(buffer, sizeof(buffer),
+                    "a <1@b> b <2@c> c <3>",
+                    options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "12") == 0);
+    
+    // should resolve generators nested deeper than the call stack allows
+    static char pattern[128 * 1024];
+    
+    size_t length = 0;
+    
+    for (int32_t i = 0; i < 5000; i++) {
+        length += (size_t)sprintf(pattern + length,
+                                  "g%d <@g%d> ", i, i + 1);
+    }
+    
+    sprintf(pattern + length, "g5000 <deep>");
+    
+    options.generator = "g0";
+    options.max_depth = 6000;
+    
+    error = lxt_gen(buffer, sizeof(buffer), pattern, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "deep") == 0);
+    
+    // should not reach the end of the chain within the default depth
+    options.max_depth = 0;
+    
+    error = lxt_gen(buffer, sizeof(buffer), pattern, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "") == 0);
+}
+
+static
+void
+test_weights(void)
+{
+    enum lxt_error error;
+    char buffer[8];
+    
+    struct lxt_template * template = NULL;
+    
+    // should pick entries in proportion to their weights
+    error = lxt_compile(&template, "c (x *3, y) g <@c>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_rng rng;
+    
+    lxt_rng_init(&rng, 12345, 0);
+    
+    struct lxt_opts options = LXT_OPTS_NONE;
+    
+    options.rng = &rng;
+    
+    uint32_t picks = 0;
+    
+    for (uint32_t i = 0; i < 40000; i++) {
+        lxt_gen_compiled(buffer, sizeof(buffer), template, options);
+        
+        if (strcmp(buffer, "x") == 0) {
+            picks += 1;
+        }
+    }
+    
+    assert(picks > 29000 && picks < 31000);
+    
+    lxt_free(template);
+    
+    // should pick generators in proportion to their weights
+    error = lxt_compile(&template, "a *9 <x> b <y>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    picks = 0;
+    
+    for (uint32_t i = 0; i < 40000; i++) {
+        lxt_gen_compiled(buffer, sizeof(buffer), template, options);
+        
+        if (strcmp(buffer, "x") == 0) {
+            picks += 1;
+        }
+    }
+    
+    assert(picks > 35000 && picks < 37000);
+    
+    lxt_free(template);
+    
+    // should fold duplicate entries into weights, picking exactly as
+    // before when seeded
+    char expected[8];
+    char folded[8];
+    
+    uint32_t seed = 1;
+    uint32_t folded_seed = 1;
+    
+    options = LXT_OPTS_NONE;
+    
+    for (uint32_t i = 0; i < 100; i++) {
+        options.seed = &seed;
+        
+        lxt_gen(expected, sizeof(expected), "c (a, a, b) g <@c>", options);
+        
+        options.seed = &folded_seed;
+        
+        lxt_gen(folded, sizeof(folded), "c (a *2, b) g <@c>", options);
+        
+        assert(strcmp(expected, folded) == 0);
+        assert(seed == folded_seed);
+    }
+    
+    // should keep picking as before for duplicates that are not adjacent
+    char spread[8];
+    
+    seed = 1;
+    folded_seed = 1;
+    
+    for (uint32_t i = 0; i < 100; i++) {
+        options.seed = &seed;
+        
+        lxt_gen(expected, sizeof(expected), "c (a, b, x) g <@c>", options);
+        
+        options.seed = &folded_seed;
+        
+        lxt_gen(spread, sizeof(spread), "c (a, b, a) g <@c>", options);
+        
+        assert(strcmp(expected, "x") == 0 ?
+               strcmp(spread, "a") == 0 :
+               strcmp(expected, spread) == 0);
+        assert(seed == folded_seed);
+    }
+    
+    // should only read a weight separated by whitespace
+    options = LXT_OPTS_NONE;
+    
+    error = lxt_gen(buffer, sizeof(buffer), "c (a*3) g <@c>", options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "a*3") == 0);
+    
+    error = lxt_gen(buffer, sizeof(buffer), "c (2 * 3) g <@c>", options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "2 * 3") == 0);
+    
+    // should keep a literal weight when given an explicit one
+    error = lxt_gen(buffer, sizeof(buffer), "c (a *3 *1) g <@c>", options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "a *3") == 0);
+    
+    // should not allow weights of zero
+    error = lxt_gen(buffer, sizeof(buffer), "c (a *0) g <@c>", options);
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    // should not allow weights of containers to overflow
+    error = lxt_gen(buffer, sizeof(buffer),
+                    "c (a *4294967295, b) g <@c>", options);
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    // should keep weights when saved to an image
+    error = lxt_compile(&template, "c (x *3, y, x) a *2 <@c> b <@c@c>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_buffer image = LXT_BUFFER_EMPTY;
+    struct lxt_sink sink;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_template * loaded = NULL;
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_rng loaded_rng;
+    
+    lxt_rng_init(&rng, 7, 0);
+    lxt_rng_init(&loaded_rng, 7, 0);
+    
+    for (uint32_t i = 0; i < 100; i++) {
+        options.rng = &rng;
+        
+        lxt_gen_compiled(expected, sizeof(expected), template, options);
+        
+        options.rng = &loaded_rng;
+        
+        lxt_gen_compiled(folded, sizeof(folded), loaded, options);
+        
+        assert(strcmp(expected, folded) == 0);
+    }
+    
+    lxt_free(loaded);
+    lxt_buffer_free(&image);
+    lxt_free(template);
+}
+
+static
+void
+test_unique(void)
+{
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    struct lxt_batch batch = LXT_BATCH_EMPTY;
+    
+    // should generate every combination exactly once
+    static char pattern[1024];
+    
+    size_t length = (size_t)sprintf(pattern, "a (00");
+    
+    for (int32_t i = 1; i < 100; i++) {
+        length += (size_t)sprintf(pattern + length, ", %02d", i);
+    }
+    
+    sprintf(pattern + length, ") g <@a@a>");
+    
+    error = lxt_compile(&template, pattern);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    uint32_t seed = 1;
+    
+    struct lxt_opts options = LXT_OPTS_NONE;
+    
+    options.seed = &seed;
+    
+    // generate in two ranges, asking for more than there are
+    error = lxt_gen_unique(&batch, 0, 4000, template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_gen_unique(&batch, 4000, 8000, template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(batch.count == 10000);
+    assert(seed == 1);
+    
+    static bool seen[10000];
+    
+    for (size_t i = 0; i < batch.count; i++) {
+        char const * const result = batch.data + batch.offsets[i];
+        
+        assert(batch.offsets[i + 1] - batch.offsets[i] == 4);
+        
+        int32_t const number = (result[0] - '0') * 1000 +
+                               (result[1] - '0') * 100 +
+                               (result[2] - '0') * 10 +
+                               (result[3] - '0');
+        
+        assert(!seen[number]);
+        
+        seen[number] = true;
+    }
+    
+    lxt_batch_free(&batch);
+    lxt_free(template);
+    
+    // should take combinations of every generator when none is specified
+    error = lxt_compile(&template, "a (x, y, z) b (1, 2) g1 <@a> g2 <@b>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_gen_unique(&batch, 0, 10, template, LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(batch.count == 5);
+    
+    lxt_batch_free(&batch);
+    lxt_free(template);
+    
+    // should not enumerate recursive generators
+    error = lxt_compile(&template, "a (x) g <@a@h> h <@g>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    options = LXT_OPTS_NONE;
+    options.generator = "g";
+    
+    error = lxt_gen_unique(&batch, 0, 10, template, options);
+    
+    assert(error == LXT_ERROR_UNSUPPORTED);
+    
+    lxt_batch_free(&batch);
+    lxt_free(template);
+}
+
+static
+void
+test_count(void)
+{
+    enum lxt_error error;
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template,
+                        "letter (a, b, c) digit (1, 2) "
+                        "pair <@letter@digit> "
+                        "word <@pair-@pair> "
+                        "loop <@letter@again> again <@loop>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    // should count every combination of entries
+    uint64_t count = 0;
+    
+    error = lxt_count(&count, template, "pair");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(count == 6);
+    
+    error = lxt_count(&count, template, "word");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(count == 36);
+    
+    // should not count recursive generators
+    error = lxt_count(&count, template, "loop");
+    
+    assert(error == LXT_ERROR_UNSUPPORTED);
+    
+    error = lxt_count(&count, template, NULL);
+    
+    assert(error == LXT_ERROR_UNSUPPORTED);
+    
+    // should generate each combination by its index
+    char buffer[16];
+    
+    struct lxt_opts options = LXT_OPTS_NONE;
+    
+    options.generator = "pair";
+    
+    error = lxt_gen_at(buffer, sizeof(buffer), 0, template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "a1") == 0);
+    
+    error = lxt_gen_at(buffer, sizeof(buffer), 4, template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "b2") == 0);
+    
+    error = lxt_gen_at(buffer, sizeof(buffer), 6, template, options);
+    
+    assert(error == LXT_ERROR_OUT_OF_RANGE);
+    
+    options.generator = "word";
+    
+    static bool seen[36];
+    
+    for (uint64_t i = 0; i < 36; i++) {
+        error = lxt_gen_at(buffer, sizeof(buffer), i, template, options);
+        
+        assert(error == LXT_ERROR_NONE);
+        assert(strlen(buffer) == 5);
+        
+        uint32_t const number = (uint32_t)(buffer[0] - 'a') * 12 +
+                                (uint32_t)(buffer[1] - '1') * 6 +
+                                (uint32_t)(buffer[3] - 'a') * 2 +
+                                (uint32_t)(buffer[4] - '1');
+        
+        assert(!seen[number]);
+        
+        seen[number] = true;
+    }
+    
+    lxt_free(template);
+    
+    // should count exactly beyond 64 bits
+    static char pattern[2048];
+    
+    size_t length = (size_t)sprintf(pattern,
+                                    "d (0, 1, 2, 3, 4, 5, 6, 7, 8, 9) n <");
+    
+    for (int32_t i = 0; i < 30; i++) {
+        length += (size_t)sprintf(pattern + length, "@d");
+    }
+    
+    sprintf(pattern + length, "> g <@n@n>");
+    
+    error = lxt_compile(&template, pattern);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_count(&count, template, "g");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(count == UINT64_MAX);
+    
+    struct lxt_buffer exact = LXT_BUFFER_EMPTY;
+    
+    error = lxt_count_exact(&exact, template, "g");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(exact.length == 61);
+    assert(exact.data[0] == '1');
+    
+    for (size_t i = 1; i < exact.length; i++) {
+        assert(exact.data[i] == '0');
+    }
+    
+    lxt_buffer_free(&exact);
+    
+    // should count every generator together
+    error = lxt_count_exact(&exact, template, NULL);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(exact.length == 61);
+    assert(memcmp(exact.data + 30, "1000000000000000000000000000000",
+                  31) == 0);
+    
+    lxt_buffer_free(&exact);
+    lxt_free(template);
+}
+
+static
+void
+test_library(void)
+{
+    enum lxt_error error;
+    
+    struct lxt_library * library = NULL;
+    
+    error = lxt_library_create(&library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    char const * const names = "first (Ann, Bo) last (Lee) unused <@first>";
+    char const * const places = "#import names\n"
+                                "town (Oslo) home <@first>";
+    char const * const loop = "#import loop\nself <@missing>";
+    
+    lxt_library_add(library, "names", names, strlen(names));
+    lxt_library_add(library, "places", places, strlen(places));
+    lxt_library_add(library, "loop", loop, strlen(loop));
+    
+    char const * const pattern = "#import names\n"
+                                 "#import places\n"
+                                 "last (Kim) "
+                                 "person <@first @last of @town>";
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile_library(&template, pattern, strlen(pattern),
+                                library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    // should pick imported containers, preferring those of the template
+    char buffer[32];
+    
+    bool picked_first = false;
+    bool picked_second = false;
+    
+    for (uint64_t i = 0; i < 2; i++) {
+        error = lxt_gen_at(buffer, sizeof(buffer), i, template,
+                           LXT_OPTS_NONE);
+        
+        assert(error == LXT_ERROR_NONE);
+        
+        picked_first = picked_first || strcmp(buffer, "Ann Kim of Oslo") == 0;
+        picked_second = picked_second || strcmp(buffer, "Bo Kim of Oslo") == 0;
+    }
+    
+    assert(picked_first && picked_second);
+    
+    struct lxt_bounds bounds;
+    
+    error = lxt_measure(&bounds, template, "person");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(bounds.min == 14 && bounds.max == 15);
+    
+    // should share the compiled module between templates
+    struct lxt_template * other = NULL;
+    
+    error = lxt_compile_library(&other, places, strlen(places), library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), other,
+                             (struct lxt_opts) {
+        .generator = "home",
+        .seed = NULL,
+        .rng = NULL
+    });
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "Ann") == 0 || strcmp(buffer, "Bo") == 0);
+    
+    // should not save templates that import containers
+    struct lxt_buffer image = LXT_BUFFER_EMPTY;
+    struct lxt_sink sink;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_UNSUPPORTED);
+    
+    lxt_buffer_free(&image);
+    lxt_free(other);
+    
+    // should not compile without the imported module
+    error = lxt_compile(&other, pattern);
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    char const * const unknown = "#import people\nseq <@first>";
+    
+    error = lxt_compile_library(&other, unknown, strlen(unknown), library);
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    // should not compile modules that import themselves
+    char const * const cycle = "#import loop\nseq <@missing>";
+    
+    error = lxt_compile_library(&other, cycle, strlen(cycle), library);
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    // should only compile modules that are used
+    char const * const lazy = "#import loop\nletter (a) seq <@letter>";
+    
+    error = lxt_compile_library(&other, lazy, strlen(lazy), library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    lxt_free(other);
+    lxt_free(template);
+    lxt_library_free(library);
+}
+
+/**
+ * Write a pattern to a file, replacing the file.
+ */
+static
+void
+write_pattern(char const * const filename,
+              char const * const pattern)
+{
+    FILE * const file = fopen(filename, "wb");
+    
+    assert(file != NULL);
+    
+    fputs(pattern, file);
+    fclose(file);
+}
+
+static
+void
+test_compile_generator(void)
+{
+    enum lxt_error error;
+    char buffer[32];
+    
+    // only the generator and what it uses is compiled; the rest of the
+    // pattern is invalid, but never parsed
+    char const * const pattern = "noise (a, b) bad name (x) "
+                                 "g <@word @other> "
+                                 "word (hi) "
+                                 "other <@word!> "
+                                 "unused <@missing>";
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template, pattern);
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    error = lxt_compile_generator(&template, pattern, strlen(pattern),
+                                  NULL, "g");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(lxt_generator_count(template) == 2);
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), template,
+                             LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "hi hi!") == 0);
+    
+    lxt_free(template);
+    
+    struct lxt_opts options = LXT_OPTS_NONE;
+    
+    // should still validate the whole pattern when generating by name
+    options.generator = "g";
+    
+    error = lxt_gen(buffer, sizeof(buffer), pattern, options);
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    // should not compile without a generator
+    error = lxt_compile_generator(&template, pattern, strlen(pattern),
+                                  NULL, NULL);
+    
+    assert(error == LXT_ERROR_GENERATOR_NOT_FOUND);
+    assert(template == NULL);
+    
+    // should compile the whole pattern if the generator is not defined
+    error = lxt_compile_generator(&template, pattern, strlen(pattern),
+                                  NULL, "none");
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    // should generate exactly the results of the whole template
+    char const * const valid = "a (x, y, z) b (1, 2 *3) "
+                               "g <@a@b> h <@b@a> gh <@g-@h>";
+    
+    struct lxt_template * whole = NULL;
+    
+    error = lxt_compile(&whole, valid);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_compile_generator(&template, valid, strlen(valid), NULL,
+                                  "gh");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(lxt_generator_count(template) == 3);
+    
+    uint32_t seed = 42;
+    uint32_t whole_seed = 42;
+    
+    options.generator = "gh";
+    
+    for (uint32_t i = 0; i < 16; i++) {
+        char expected[32];
+        
+        options.seed = &whole_seed;
+        
+        error = lxt_gen_compiled(expected, sizeof(expected), whole, options);
+        
+        assert(error == LXT_ERROR_NONE);
+        
+        options.seed = &seed;
+        
+        error = lxt_gen_compiled(buffer, sizeof(buffer), template, options);
+        
+        assert(error == LXT_ERROR_NONE);
+        assert(strcmp(buffer, expected) == 0);
+        assert(seed == whole_seed);
+    }
+    
+    lxt_free(template);
+    lxt_free(whole);
+    
+    // should skip over entries, but keep those that follow a generator
+    // with the container they belong to
+    char const * const spread = "word (a, b(c), d<e>) "
+                                "g <@word>, f) "
+                                "h <@word@word>";
+    
+    error = lxt_compile_generator(&template, spread, strlen(spread), NULL,
+                                  "g");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    uint64_t count = 0;
+    
+    error = lxt_count(&count, template, "g");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(count == 4);
+    
+    lxt_free(template);
+    
+    // should only compile the modules that are used
+    struct lxt_library * library = NULL;
+    
+    error = lxt_library_create(&library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    char const * const names = "first (Ann)";
+    char const * const broken = "bad name (x)";
+    
+    lxt_library_add(library, "names", names, strlen(names));
+    lxt_library_add(library, "broken", broken, strlen(broken));
+    
+    char const * const imports = "#import names\n"
+                                 "#import broken\n"
+                                 "person <@first> other <@last>";
+    
+    error = lxt_compile_generator(&template, imports, strlen(imports),
+                                  library, "person");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), template,
+                             LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "Ann") == 0);
+    
+    lxt_free(template);
+    
+    error = lxt_compile_generator(&template, imports, strlen(imports),
+                                  library, "other");
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    lxt_library_free(library);
+}
+
+static
+void
+test_registry(void)
+{
+    enum lxt_error error;
+    
+    char const * const filename = "lext_test_registry.lxt";
+    
+    write_pattern(filename, "word (first) seq <@word>");
+    
+    struct lxt_registry * registry = NULL;
+    
+    error = lxt_registry_create(&registry);
+    
+    if (error == LXT_ERROR_UNSUPPORTED) {
+        // no atomic operations on this platform
+        remove(filename);
+        
+        return;
+    }
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_registry_add(registry, "words", filename);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_reader * reader = NULL;
+    
+    error = lxt_reader_create(&reader, registry);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(lxt_reader_acquire(reader, "missing") == NULL);
+    
+    struct lxt_template const * const first =
+        lxt_reader_acquire(reader, "words");
+    
+    assert(first != NULL);
+    
+    // should publish a new version once the file changes
+    write_pattern(filename, "word (second) seq <@word>");
+    
+    error = lxt_registry_poll(registry);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    // should keep the previous version valid until released
+    char buffer[16];
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), first, LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "first") == 0);
+    
+    lxt_reader_release(reader);
+    
+    struct lxt_template const * const second =
+        lxt_reader_acquire(reader, "words");
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), second, LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "second") == 0);
+    
+    lxt_reader_release(reader);
+    
+    // should keep the current version if the file fails to compile
+    write_pattern(filename, "word (broken) seq <@missing>");
+    
+    error = lxt_registry_poll(registry);
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer),
+                             lxt_reader_acquire(reader, "words"),
+                             LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "second") == 0);
+    
+    // should not watch without an interval to wait between polls
+    error = lxt_registry_watch(registry, 0);
+    
+    assert(error == LXT_ERROR_OUT_OF_RANGE ||
+           error == LXT_ERROR_UNSUPPORTED);
+    
+    lxt_reader_free(reader);
+    lxt_registry_free(registry);
+    
+    remove(filename);
+}
+
+static
+void
+test_lines(void)
+{
+    enum lxt_error error;
+    char buffer[32];
+    
+    char const * const filename = "lext_test_lines.txt";
+    
+    write_pattern(filename, "Ann\r\nBo\n\n  Cy  \nAnn");
+    
+    struct lxt_template * template = NULL;
+    
+    // should never read files unless added to a library
+    error = lxt_compile(&template, "#lines names\n"
+                                   "greeting <@names>");
+    
+    assert(error == LXT_ERROR_UNSUPPORTED);
+    
+    error = lxt_compile(&template, "#lines names lext_test_lines.txt\n"
+                                   "greeting <@names>");
+    
+    assert(error == LXT_ERROR_INVALID_TEMPLATE);
+    
+    struct lxt_library * library = NULL;
+    
+    error = lxt_library_create(&library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_library_add_lines(library, "names", filename);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    char const * const pattern = "#lines names\n"
+                                 "greeting <Hi, @names and @names!>";
+    
+    error = lxt_compile_library(&template, pattern, strlen(pattern),
+                                library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    // should pick from every line that is not blank, trimmed of whitespace
+    uint64_t count = 0;
+    
+    error = lxt_count(&count, template, "greeting");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(count == 16);
+    
+    struct lxt_bounds bounds;
+    
+    error = lxt_measure(&bounds, template, "greeting");
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(bounds.min == 14 && bounds.max == 16);
+    
+    error = lxt_gen_at(buffer, sizeof(buffer), 11, template, LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "Hi, Ann and Cy!") == 0);
+    
+    // should never be saved as part of an image
+    struct lxt_buffer image = LXT_BUFFER_EMPTY;
+    struct lxt_sink sink;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    assert(lxt_save(template, &sink) == LXT_ERROR_UNSUPPORTED);
+    
+    lxt_buffer_free(&image);
+    lxt_free(template);
+    
+    // should prefer containers defined in the pattern
+    char const * const defined = "#lines names\n"
+                                 "names (Dee) greeting <@names>";
+    
+    error = lxt_compile_library(&template, defined, strlen(defined),
+                                library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), template,
+                             LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "Dee") == 0);
+    
+    lxt_free(template);
+    
+    // should only read files that are in the library
+    char const * const unknown = "#lines others\n"
+                                 "greeting <@others>";
+    
+    error = lxt_compile_library(&template, unknown, strlen(unknown),
+                                library);
+    
+    assert(error == LXT_ERROR_UNSUPPORTED);
+    
+    // should only read files that are used
+    error = lxt_library_add_lines(library, "missing", "lext_test_missing");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    char const * const unused = "#lines missing\n"
+                                "greeting <Hi>";
+    
+    error = lxt_compile_library(&template, unused, strlen(unused), library);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    lxt_free(template);
+    
+    char const * const missing = "#lines missing\n"
+                                 "greeting <@missing>";
+    
+    error = lxt_compile_library(&template, missing, strlen(missing),
+                                library);
+    
+    assert(error == LXT_ERROR_READ_FAILED);
+    
+    lxt_library_free(library);
+    
+    // should recompile templates of a registry when their lines change
+    char const * const registered = "lext_test_lines.lxt";
+    
+    write_pattern(registered, "#lines names\n"
+                              "greeting <@names>");
+    
+    struct lxt_registry * registry = NULL;
+    
+    error = lxt_registry_create(&registry);
+    
+    if (error == LXT_ERROR_UNSUPPORTED) {
+        // no atomic operations on this platform
+        remove(filename);
+        remove(registered);
+        
+        return;
+    }
+    
+    error = lxt_registry_add_lines(registry, "names", filename);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_registry_add(registry, "greetings", registered);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_reader * reader = NULL;
+    
+    error = lxt_reader_create(&reader, registry);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_template const * const first =
+        lxt_reader_acquire(reader, "greetings");
+    
+    write_pattern(filename, "Eve");
+    
+    error = lxt_registry_poll(registry);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    // should keep reading the previous lines, even though the file changed
+    error = lxt_gen_at(buffer, sizeof(buffer), 2, first, LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "Cy") == 0);
+    
+    lxt_reader_release(reader);
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer),
+                             lxt_reader_acquire(reader, "greetings"),
+                             LXT_OPTS_NONE);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "Eve") == 0);
+    
+    lxt_reader_free(reader);
+    lxt_registry_free(registry);
+    
+    remove(filename);
+    remove(registered);
+}
+
+static
+void
+test_ctx(void)
+{
+    enum lxt_error error;
+    char expected[64];
+    char generated[64];
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template,
+                        "letter (a, b, c, d) digit (1, 2, 3) "
+                        "word <@letter@digit@letter> "
+                        "line <@word @word>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_rng rng;
+    struct lxt_rng ctx_rng;
+    
+    lxt_rng_init(&rng, 42, 3);
+    
+    ctx_rng = rng;
+    
+    struct lxt_ctx * ctx = NULL;
+    
+    error = lxt_ctx_create(&ctx, &ctx_rng);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_opts options = LXT_OPTS_NONE;
+    
+    options.generator = "line";
+    options.rng = &rng;
+    
+    // should generate the same results as the same generator without a
+    // context, ignoring the generator of the options
+    for (int32_t i = 0; i < 100; i++) {
+        error = lxt_gen_compiled(expected, sizeof(expected), template,
+                                 options);
+        
+        assert(error == LXT_ERROR_NONE);
+        
+        error = lxt_gen_ctx(ctx, generated, sizeof(generated), template,
+                            options);
+        
+        assert(error == LXT_ERROR_NONE);
+        assert(strcmp(expected, generated) == 0);
+    }
+    
+    // should generate the same results into a batch and a sink
+    struct lxt_batch batch = LXT_BATCH_EMPTY;
+    struct lxt_batch ctx_batch = LXT_BATCH_EMPTY;
+    
+    error = lxt_gen_batch(&batch, 50, template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_gen_batch_ctx(ctx, &ctx_batch, 50, template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(ctx_batch.count == 50);
+    assert(ctx_batch.offsets[50] == batch.offsets[50]);
+    assert(memcmp(ctx_batch.data, batch.data,
+                  (size_t)batch.offsets[50]) == 0);
+    
+    struct lxt_buffer buffer = LXT_BUFFER_EMPTY;
+    struct lxt_sink sink;
+    
+    lxt_sink_buffer(&sink, &buffer);
+    
+    error = lxt_gen_compiled(expected, sizeof(expected), template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    error = lxt_gen_sink_ctx(ctx, &sink, template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(buffer.length == strlen(expected));
+    assert(memcmp(buffer.data, expected, buffer.length) == 0);
+    
+    // should start over once the generator of the context is re-seeded
+    lxt_rng_init(lxt_ctx_rng(ctx), 42, 3);
+    lxt_rng_init(&rng, 42, 3);
+    
+    lxt_gen_compiled(expected, sizeof(expected), template, options);
+    lxt_gen_ctx(ctx, generated, sizeof(generated), template, options);
+    
+    assert(strcmp(expected, generated) == 0);
+    
+    lxt_free(template);
+    
+    // should keep frames grown for deeply nested generators
+    static char pattern[32 * 1024];
+    
+    size_t length = 0;
+    
+    for (int32_t i = 0; i < 1000; i++) {
+        length += (size_t)sprintf(pattern + length,
+                                  "g%d <@g%d> ", i, i + 1);
+    }
+    
+    sprintf(pattern + length, "g1000 <deep>");
+    
+    error = lxt_compile(&template, pattern);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    options.generator = "g0";
+    options.max_depth = 2000;
+    
+    for (int32_t i = 0; i < 3; i++) {
+        error = lxt_gen_ctx(ctx, generated, sizeof(generated), template,
+                            options);
+        
+        assert(error == LXT_ERROR_NONE);
+        assert(strcmp(generated, "deep") == 0);
+    }
+    
+    lxt_ctx_free(ctx);
+    lxt_buffer_free(&buffer);
+    lxt_batch_free(&ctx_batch);
+    lxt_batch_free(&batch);
+    lxt_free(template);
+}
+
+static
+void
+test_optimize(void)
+{
+    enum lxt_error error;
+    char buffer[32];
+    
+    struct lxt_template * template = NULL;
+    
+    error = lxt_compile(&template,
+                        "a (x) b (y) none () "
+                        "empty <> "
+                        "word <abc> "
+                        "folded <@a@b@none-@a@empty@b> "
+                        "line <@word @word>");
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_rng rng;
+    struct lxt_rng expected;
+    
+    lxt_rng_init(&rng, 5, 0);
+    
+    expected = rng;
+    
+    struct lxt_opts options = LXT_OPTS_NONE;
+    
+    options.generator = "folded";
+    options.rng = &rng;
+    
+    // should draw once for each container of a single entry, as if each
+    // were picked from
+    error = lxt_gen_compiled(buffer, sizeof(buffer), template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "xy-xy") == 0);
+    
+    lxt_rng_advance(&expected, 4);
+    
+    assert(rng.state == expected.state);
+    
+    // should stop drawing where a result is cut off; at the pick that
+    // follows a pick that fills the buffer
+    error = lxt_gen_compiled(buffer, 2, template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "x") == 0);
+    
+    lxt_rng_advance(&expected, 2);
+    
+    assert(rng.state == expected.state);
+    
+    // should skip inlined generators beyond the maximum depth
+    options.generator = "line";
+    options.max_depth = 1;
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, " ") == 0);
+    
+    options.max_depth = 0;
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), template, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "abc abc") == 0);
+    
+    // should keep folded text in images
+    struct lxt_buffer image = LXT_BUFFER_EMPTY;
+    struct lxt_sink sink;
+    
+    lxt_sink_buffer(&sink, &image);
+    
+    error = lxt_save(template, &sink);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    struct lxt_template * loaded = NULL;
+    
+    error = lxt_load(&loaded, image.data, image.length);
+    
+    assert(error == LXT_ERROR_NONE);
+    
+    options.generator = "folded";
+    
+    error = lxt_gen_compiled(buffer, sizeof(buffer), loaded, options);
+    
+    assert(error == LXT_ERROR_NONE);
+    assert(strcmp(buffer, "xy-xy") == 0);
+    
+    lxt_free(loaded);
+    lxt_buffer_free(&image);
+    lxt_free(template);
+}
+
 int32_t
 main(void)
 {
     test_various();
     test_invalid_template();
     test_truncation();
+    test_compiled();
+    test_large_template();
+    test_batch();
+    test_batch_parallel();
+    test_rng();
+    test_sink();
+    test_measure();
+    test_compile_length();
+    test_image();
+    test_damaged_image();
+    test_recursion();
+    test_weights();
+    test_unique();
+    test_count();
+    test_library();
+    test_compile_generator();
+    test_registry();
+    test_lines();
+    test_ctx();
+    test_optimize();
     
     return 0;
 }